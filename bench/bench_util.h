@@ -0,0 +1,61 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// 基准测试公用工具：计时、延迟分位数统计、页缓存驱逐
+namespace bench {
+
+inline double nowMicros() {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 一组延迟样本（微秒）
+struct LatencyStats {
+    std::vector<double> samples;
+    
+    void add(double micros) { samples.push_back(micros); }
+    
+    double percentile(double p) {
+        if (samples.empty()) return 0.0;
+        std::sort(samples.begin(), samples.end());
+        size_t idx = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+        return samples[idx];
+    }
+    
+    double mean() const {
+        if (samples.empty()) return 0.0;
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+        return sum / samples.size();
+    }
+};
+
+// 将文件从操作系统页缓存中驱逐（无需 root 权限，仅对干净页有效）
+inline bool evictFromPageCache(const std::string& path) {
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    fdatasync(fd);
+    int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+    return rc == 0;
+#endif
+}
+
+}  // namespace bench
+
+#endif
@@ -0,0 +1,243 @@
+// 协议编解码基准：一屏历史消息按原来的制表符分隔行协议与现在的二进制批次分别编码、解码，
+// 比较吞吐量与每条消息的字节数。二进制解码分两种：只取视图，和拷贝成 Message
+//
+// 用法: ./bench_codec [--messages N] [--passes P] [--content-bytes B]
+
+#include "protocol.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 改动前 protocol.cpp 的行协议实现
+static void legacyEscaped(std::string& out, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            case '\n': out += "\\n"; break;
+            default: out += c;
+        }
+    }
+}
+
+static void legacyAppendMessage(std::string& out, const MessageView& msg) {
+    out += "MSG\t";
+    out += std::to_string(msg.id);
+    out += '\t';
+    legacyEscaped(out, msg.sender.data, msg.sender.size);
+    out += '\t';
+    legacyEscaped(out, msg.receiver.data, msg.receiver.size);
+    out += msg.isGroup ? "\t1\t" : "\t0\t";
+    legacyEscaped(out, msg.timestamp.data, msg.timestamp.size);
+    out += '\t';
+    legacyEscaped(out, msg.content.data, msg.content.size);
+    out += '\n';
+}
+
+static bool legacySplitLine(const char* data, size_t size, std::vector<std::string>& fields) {
+    fields.clear();
+    fields.push_back(std::string());
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+        if (c == '\t') {
+            fields.push_back(std::string());
+        } else if (c == '\\') {
+            if (++i >= size) return false;
+            switch (data[i]) {
+                case '\\': fields.back() += '\\'; break;
+                case 't': fields.back() += '\t'; break;
+                case 'r': fields.back() += '\r'; break;
+                case 'n': fields.back() += '\n'; break;
+                default: return false;
+            }
+        } else {
+            fields.back() += c;
+        }
+    }
+    return true;
+}
+
+static size_t legacyDecode(const std::string& stream, std::vector<Message>& out) {
+    out.clear();
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (start < stream.size()) {
+        size_t end = stream.find('\n', start);
+        if (end == std::string::npos) break;
+        if (legacySplitLine(stream.data() + start, end - start, fields) && fields.size() == 7) {
+            Message msg;
+            msg.id = std::atoi(fields[1].c_str());
+            msg.sender = fields[2];
+            msg.receiver = fields[3];
+            msg.isGroup = fields[4] == "1";
+            msg.timestamp = fields[5];
+            msg.content = fields[6];
+            out.push_back(msg);
+        }
+        start = end + 1;
+    }
+    return out.size();
+}
+
+// 与服务端 HISTORY 相同：按 kBatchBytes 切分为多帧
+static void binaryEncode(const std::vector<MessageView>& views, std::string& out) {
+    out.clear();
+    size_t i = 0;
+    do {
+        protocol::MessageBatchWriter writer(out, protocol::OP_MESSAGES);
+        while (i < views.size() && writer.bodySize() < protocol::kBatchBytes) writer.add(views[i++]);
+        writer.finish(i < views.size());
+    } while (i < views.size());
+}
+
+// 只取视图，累加内容长度防止被优化掉
+static size_t binaryDecodeViews(const std::string& stream, size_t& sink) {
+    const char* data = stream.data();
+    size_t size = stream.size();
+    size_t count = 0;
+    const char* body;
+    size_t bodySize, frameSize;
+    while (protocol::peekFrame(data, size, protocol::kMaxResponseBytes, body, bodySize, frameSize) ==
+           protocol::FRAME_OK) {
+        protocol::MessageBatchReader batch(body + 1, bodySize - 1);
+        protocol::WireMessage msg;
+        while (batch.next(msg)) {
+            sink += msg.content.size + (size_t)msg.id;
+            ++count;
+        }
+        data += frameSize;
+        size -= frameSize;
+    }
+    return count;
+}
+
+static size_t binaryDecodeCopies(const std::string& stream, std::vector<Message>& out) {
+    out.clear();
+    const char* data = stream.data();
+    size_t size = stream.size();
+    const char* body;
+    size_t bodySize, frameSize;
+    while (protocol::peekFrame(data, size, protocol::kMaxResponseBytes, body, bodySize, frameSize) ==
+           protocol::FRAME_OK) {
+        protocol::MessageBatchReader batch(body + 1, bodySize - 1);
+        protocol::WireMessage msg;
+        while (batch.next(msg)) out.push_back(protocol::toMessage(msg));
+        data += frameSize;
+        size -= frameSize;
+    }
+    return out.size();
+}
+
+struct Result {
+    const char* name;
+    bench::LatencyStats stats;
+};
+
+static void report(Result& r, int messages, size_t bytes) {
+    double p50 = r.stats.percentile(50);
+    double seconds = p50 / 1e6;
+    std::printf("%-26s %10.1f %10.1f %14.0f %10.1f\n", r.name, p50, r.stats.percentile(99),
+                seconds > 0 ? messages / seconds : 0.0, seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+    int messages = 10000;
+    int passes = 30;
+    int contentBytes = 40;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--messages") && i + 1 < argc) messages = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--passes") && i + 1 < argc) passes = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--content-bytes") && i + 1 < argc) contentBytes = std::atoi(argv[++i]);
+        else {
+            std::printf("用法: %s [--messages N] [--passes P] [--content-bytes B]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (messages < 1 || passes < 1 || contentBytes < 0) {
+        std::printf("参数必须为正数\n");
+        return 1;
+    }
+
+    // 一段群聊：少数发送者轮流发言，id 连续，时间间隔几秒
+    const char* senders[] = { "alice", "bob", "carol", "dave" };
+    std::vector<Message> source(messages);
+    long long start = 1700000000;
+    for (int i = 0; i < messages; ++i) {
+        Message& msg = source[i];
+        msg.id = 100000 + i;
+        msg.sender = senders[(i / 3) % 4];
+        msg.receiver = "project-group";
+        msg.content.assign((size_t)contentBytes, (char)('a' + i % 26));
+        if (i % 50 == 0 && contentBytes > 0) msg.content[0] = '\n';     // 偶尔需要转义
+        char buffer[20];
+        protocol::formatTimestamp(start + (long long)i * 7, buffer);
+        msg.timestamp = buffer;
+        msg.isGroup = true;
+    }
+    std::vector<MessageView> views;
+    for (const auto& msg : source) views.push_back(viewOf(msg));
+
+    Result legacyEncode = { "text line encode", bench::LatencyStats() };
+    Result legacyDecodeResult = { "text line decode (copy)", bench::LatencyStats() };
+    Result encode = { "binary encode", bench::LatencyStats() };
+    Result decodeViews = { "binary decode (view)", bench::LatencyStats() };
+    Result decodeCopies = { "binary decode (copy)", bench::LatencyStats() };
+
+    std::string legacyStream, binaryStream;
+    std::vector<Message> decoded;
+    size_t sink = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        double t0 = bench::nowMicros();
+        legacyStream.clear();
+        for (const auto& view : views) legacyAppendMessage(legacyStream, view);
+        legacyEncode.stats.add(bench::nowMicros() - t0);
+
+        t0 = bench::nowMicros();
+        sink += legacyDecode(legacyStream, decoded);
+        legacyDecodeResult.stats.add(bench::nowMicros() - t0);
+
+        t0 = bench::nowMicros();
+        binaryEncode(views, binaryStream);
+        encode.stats.add(bench::nowMicros() - t0);
+
+        t0 = bench::nowMicros();
+        size_t count = binaryDecodeViews(binaryStream, sink);
+        decodeViews.stats.add(bench::nowMicros() - t0);
+        if (count != source.size()) {
+            std::printf("视图解码条数不符: %zu\n", count);
+            return 1;
+        }
+
+        t0 = bench::nowMicros();
+        sink += binaryDecodeCopies(binaryStream, decoded);
+        decodeCopies.stats.add(bench::nowMicros() - t0);
+    }
+
+    // 往返校验，避免测到错误的实现
+    for (size_t i = 0; i < source.size(); ++i) {
+        const Message& a = source[i];
+        const Message& b = decoded[i];
+        if (a.id != b.id || a.sender != b.sender || a.receiver != b.receiver || a.content != b.content ||
+            a.timestamp != b.timestamp || a.isGroup != b.isGroup) {
+            std::printf("第 %zu 条往返不一致\n", i);
+            return 1;
+        }
+    }
+
+    std::printf("%d 条消息 x %d 轮，内容 %d 字节\n", messages, passes, contentBytes);
+    std::printf("%-26s %10s %10s %14s %10s\n", "method", "p50_us", "p99_us", "msgs/s", "MB/s");
+    report(legacyEncode, messages, legacyStream.size());
+    report(legacyDecodeResult, messages, legacyStream.size());
+    report(encode, messages, binaryStream.size());
+    report(decodeViews, messages, binaryStream.size());
+    report(decodeCopies, messages, binaryStream.size());
+    std::printf("bytes/message: text %.1f, binary %.1f (%.0f%%)\n", (double)legacyStream.size() / messages,
+                (double)binaryStream.size() / messages, 100.0 * binaryStream.size() / legacyStream.size());
+    std::printf("(checksum %zu)\n", sink);
+    return 0;
+}
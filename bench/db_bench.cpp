@@ -0,0 +1,193 @@
+// Database 全方法基准：生成指定规模的测试库，逐个方法计时，
+// 以表格输出到终端，同时写出 JSON 结果便于比较
+//
+// 用法: ./bench_db [--db 路径] [--users N] [--groups G] [--group-size S]
+//                  [--messages M] [--iterations K] [--json 路径|-] [--reseed]
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "database.h"
+#include "bench_util.h"
+#include "seed.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct OpResult {
+    std::string name;
+    int iterations;
+    double totalMicros;
+    double p50, p90, p99, max;
+};
+
+static bool fileExists(const std::string& path) {
+    std::ifstream f(path.c_str());
+    return f.good();
+}
+
+// 执行 iterations 次操作，第 i 次调用 op(i)
+static OpResult runOp(const std::string& name, int iterations, const std::function<void(int)>& op) {
+    bench::LatencyStats stats;
+    double start = bench::nowMicros();
+    for (int i = 0; i < iterations; ++i) {
+        double t0 = bench::nowMicros();
+        op(i);
+        stats.add(bench::nowMicros() - t0);
+    }
+
+    OpResult r;
+    r.name = name;
+    r.iterations = iterations;
+    r.totalMicros = bench::nowMicros() - start;
+    r.p50 = stats.percentile(50);
+    r.p90 = stats.percentile(90);
+    r.p99 = stats.percentile(99);
+    r.max = stats.percentile(100);
+    return r;
+}
+
+static double opsPerSec(const OpResult& r) {
+    return r.totalMicros > 0 ? r.iterations / (r.totalMicros / 1e6) : 0.0;
+}
+
+static void printTable(const std::vector<OpResult>& results) {
+    printf("\n%-22s %8s %12s %10s %10s %10s %10s\n", "method", "iters", "ops/s", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    printf("------------------------------------------------------------------------------------------\n");
+    for (const auto& r : results) {
+        printf("%-22s %8d %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+               r.name.c_str(), r.iterations, opsPerSec(r), r.p50, r.p90, r.p99, r.max);
+    }
+}
+
+static void writeJson(std::ostream& out, const bench::SeedConfig& cfg, const std::vector<OpResult>& results) {
+    out << "{\n";
+    out << "  \"dataset\": {\"users\": " << cfg.users << ", \"friends_per_user\": " << cfg.friendsPerUser
+        << ", \"groups\": " << cfg.groups << ", \"group_size\": " << cfg.groupSize
+        << ", \"messages\": " << cfg.messages << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const OpResult& r = results[i];
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "    {\"method\": \"%s\", \"iterations\": %d, \"ops_per_sec\": %.1f, "
+                 "\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}",
+                 r.name.c_str(), r.iterations, opsPerSec(r), r.p50, r.p90, r.p99, r.max);
+        out << line << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = "bench_db.db";
+    std::string jsonPath = "bench_db.json";
+    int iterations = 200;
+    bool reseed = false;
+    bench::SeedConfig cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) path = argv[++i];
+        else if (!strcmp(argv[i], "--users") && i + 1 < argc) cfg.users = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--groups") && i + 1 < argc) cfg.groups = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--group-size") && i + 1 < argc) cfg.groupSize = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && i + 1 < argc) cfg.messages = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--reseed")) reseed = true;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--db 路径] [--users N] [--groups G] [--group-size S]"
+                      << " [--messages M] [--iterations K] [--json 路径|-] [--reseed]" << std::endl;
+            return 1;
+        }
+    }
+    if (cfg.users < 2) cfg.users = 2;
+    if (iterations < 1) iterations = 1;
+
+    Database* db = Database::getInstance();
+    DatabaseOptions opts = DatabaseOptions::fromEnvironment();
+    opts.path = path;
+
+    if (reseed || !fileExists(path)) {
+        std::remove(path.c_str());
+        if (!db->initialize(opts)) return 1;
+        db->close();
+        std::cout << "生成测试数据: " << cfg.users << " 用户, " << cfg.groups << " 群组, "
+                  << cfg.messages << " 条消息..." << std::endl;
+        double t0 = bench::nowMicros();
+        if (!bench::seedDatabase(path, cfg)) {
+            std::cerr << "生成测试数据失败" << std::endl;
+            return 1;
+        }
+        std::cout << "完成，用时 " << (bench::nowMicros() - t0) / 1e6 << " 秒" << std::endl;
+    }
+
+    if (!db->initialize(opts)) return 1;
+
+    std::mt19937 rng(cfg.seed);
+    std::vector<int> userIdx(iterations), groupIdx(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        userIdx[i] = (int)(rng() % cfg.users);
+        groupIdx[i] = cfg.groups > 0 ? (int)(rng() % cfg.groups) : 0;
+    }
+    auto user = [&](int i) { return bench::userName(userIdx[i]); };
+    auto peer = [&](int i) { return bench::userName(bench::friendOf(userIdx[i], 0, cfg.users)); };
+    auto group = [&](int i) { return bench::groupName(groupIdx[i]); };
+    // 写操作使用独立命名空间，避免与测试数据冲突，并保证可重复运行
+    std::string tag = std::to_string((long long)bench::nowMicros());
+    auto fresh = [&](const char* prefix, int i) { return std::string(prefix) + tag + "_" + std::to_string(i); };
+
+    std::vector<OpResult> results;
+
+    results.push_back(runOp("createUser", iterations, [&](int i) { db->createUser(fresh("bu", i), "123"); }));
+    results.push_back(runOp("userExists", iterations, [&](int i) { db->userExists(user(i)); }));
+    results.push_back(runOp("validateUser", iterations, [&](int i) { db->validateUser(user(i), "123"); }));
+    results.push_back(runOp("getUserId", iterations, [&](int i) { db->getUserId(user(i)); }));
+    results.push_back(runOp("verifySystemPassword", iterations, [&](int) { db->verifySystemPassword("admin123"); }));
+    results.push_back(runOp("addFriend", iterations, [&](int i) { db->addFriend(fresh("bu", i), user(i)); }));
+    results.push_back(runOp("getFriends", iterations, [&](int i) { db->getFriends(user(i)); }));
+    results.push_back(runOp("createGroup", iterations, [&](int i) { db->createGroup(fresh("bg", i), user(i)); }));
+    results.push_back(runOp("joinGroup", iterations, [&](int i) { db->joinGroup(fresh("bu", i), group(i)); }));
+    results.push_back(runOp("getUserGroups", iterations, [&](int i) { db->getUserGroups(user(i)); }));
+    results.push_back(runOp("getGroupMembers", iterations, [&](int i) { db->getGroupMembers(group(i)); }));
+    results.push_back(runOp("isGroupCreator", iterations, [&](int i) { db->isGroupCreator(user(i), group(i)); }));
+    results.push_back(runOp("saveMessage(private)", iterations, [&](int i) { db->saveMessage(user(i), peer(i), "bench 消息", false); }));
+    results.push_back(runOp("saveMessage(group)", iterations, [&](int i) { db->saveMessage(user(i), group(i), "bench 消息", true); }));
+    results.push_back(runOp("getMessages(private)", iterations, [&](int i) { db->getMessages(user(i), peer(i), false); }));
+    results.push_back(runOp("getMessages(group)", iterations, [&](int i) { db->getMessages(user(i), group(i), true); }));
+    results.push_back(runOp("visitMessages(private)", iterations, [&](int i) {
+        db->visitMessages(user(i), peer(i), false, [](const MessageView&) { return true; });
+    }));
+    results.push_back(runOp("visitConversation(private)", iterations, [&](int i) {
+        db->visitConversation(user(i), peer(i), false, [](const MessageView&) { return true; });
+    }));
+    // 在少数几个会话间反复切换，数据库未变化时直接命中缓存
+    results.push_back(runOp("visitConversation(re-entry)", iterations, [&](int i) {
+        db->visitConversation(user(i % 8), peer(i % 8), false, [](const MessageView&) { return true; });
+    }));
+    results.push_back(runOp("getRecentChats", iterations, [&](int i) { db->getRecentChats(user(i)); }));
+    // 最近聊天列表首页：子查询带 LIMIT，排序器只保留前 21 行
+    results.push_back(runOp("getRecentChats(page)", iterations, [&](int i) { db->getRecentChats(user(i), 20, 0); }));
+    results.push_back(runOp("removeFromGroup", iterations, [&](int i) { db->removeFromGroup(fresh("bu", i), group(i)); }));
+    results.push_back(runOp("deleteUserData", iterations, [&](int i) { db->deleteUserData(fresh("bu", i)); }));
+
+    db->close();
+
+    printTable(results);
+
+    if (jsonPath == "-") {
+        writeJson(std::cout, cfg, results);
+    } else {
+        std::ofstream out(jsonPath.c_str());
+        if (!out) {
+            std::cerr << "无法写入 " << jsonPath << std::endl;
+            return 1;
+        }
+        writeJson(out, cfg, results);
+        std::cout << "\nJSON 结果已写入 " << jsonPath << std::endl;
+    }
+    return 0;
+}
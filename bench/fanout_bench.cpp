@@ -0,0 +1,134 @@
+// 群消息读扩散/写扩散对比：相同的数据集分别以两种模式各建一个库，
+// 比较群内发言 (saveMessage) 与成员打开最近聊天列表 (getRecentChats) 的延迟
+//
+// 用法: ./bench_fanout [--members N] [--groups G] [--messages M] [--iterations K]
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "database.h"
+#include "bench_util.h"
+#include "seed.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+struct ModeResult {
+    const char* name;
+    bench::LatencyStats send;
+    bench::LatencyStats recent;
+    long long inboxRows;
+};
+
+static long long countRows(const std::string& path, const char* table) {
+    sqlite3* conn;
+    long long rows = 0;
+    if (sqlite3_open(path.c_str(), &conn) == SQLITE_OK) {
+        sqlite3_stmt* stmt;
+        std::string sql = std::string("SELECT COUNT(*) FROM ") + table;
+        if (sqlite3_prepare_v2(conn, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) rows = sqlite3_column_int64(stmt, 0);
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_close(conn);
+    return rows;
+}
+
+static void removeDatabase(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+// fanoutMinMembers = 0 为读扩散，1 为所有群都写扩散
+static bool runMode(ModeResult& result, const std::string& path, int fanoutMinMembers,
+                    const bench::SeedConfig& cfg, int iterations) {
+    Database* db = Database::getInstance();
+    DatabaseOptions opts = DatabaseOptions::fromEnvironment();
+    opts.path = path;
+    opts.fanoutMinMembers = fanoutMinMembers;
+    opts.shmRing = false;
+    opts.prefetchCount = 0;
+    opts.slowLogPath = "";
+
+    removeDatabase(path);
+    if (!db->initialize(opts)) return false;
+    db->close();
+    if (!bench::seedDatabase(path, cfg)) return false;
+    if (!db->initialize(opts)) return false;
+
+    // 写扩散模式下每个群的第一条发言完成切换，不计入结果
+    for (int g = 0; g < cfg.groups; ++g) {
+        db->saveMessage(bench::userName(0), bench::groupName(g), "warmup", true);
+    }
+
+    for (int i = 0; i < iterations; ++i) {
+        std::string sender = bench::userName(i % cfg.users);
+        std::string group = bench::groupName(i % cfg.groups);
+        double t0 = bench::nowMicros();
+        db->saveMessage(sender, group, "bench 消息", true);
+        result.send.add(bench::nowMicros() - t0);
+    }
+    for (int i = 0; i < iterations; ++i) {
+        std::string user = bench::userName((i * 7919) % cfg.users);
+        double t0 = bench::nowMicros();
+        db->getRecentChats(user, 20, 0);
+        result.recent.add(bench::nowMicros() - t0);
+    }
+    db->close();
+
+    result.inboxRows = countRows(path, "group_inbox");
+    removeDatabase(path);
+    return true;
+}
+
+static void report(ModeResult& r) {
+    std::printf("%-14s %12.1f %12.1f %14.1f %14.1f %12lld\n", r.name,
+                r.send.percentile(50), r.send.percentile(99),
+                r.recent.percentile(50), r.recent.percentile(99), r.inboxRows);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 200;
+    bench::SeedConfig cfg;
+    // 默认：每个用户都在全部群中，群聊消息占多数
+    cfg.users = 2000;
+    cfg.friendsPerUser = 2;
+    cfg.groups = 10;
+    cfg.groupSize = 2000;
+    cfg.messages = 100000;
+    cfg.groupMessageRatio = 0.8;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--members") && i + 1 < argc) cfg.users = cfg.groupSize = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--groups") && i + 1 < argc) cfg.groups = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && i + 1 < argc) cfg.messages = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else {
+            std::cerr << "用法: " << argv[0] << " [--members N] [--groups G] [--messages M] [--iterations K]" << std::endl;
+            return 1;
+        }
+    }
+    if (cfg.users < 3) cfg.users = cfg.groupSize = 3;
+    if (cfg.groups < 1) cfg.groups = 1;
+    if (iterations < 1) iterations = 1;
+
+    std::cout << cfg.groups << " 个群 x " << cfg.groupSize << " 成员，历史消息 " << cfg.messages
+              << " 条，每项 " << iterations << " 次" << std::endl;
+
+    ModeResult readMode = { "read fan-out", bench::LatencyStats(), bench::LatencyStats(), 0 };
+    ModeResult writeMode = { "write fan-out", bench::LatencyStats(), bench::LatencyStats(), 0 };
+    if (!runMode(readMode, "bench_fanout_read.db", 0, cfg, iterations) ||
+        !runMode(writeMode, "bench_fanout_write.db", 1, cfg, iterations)) {
+        std::cerr << "生成测试数据失败" << std::endl;
+        return 1;
+    }
+
+    std::printf("\n%-14s %12s %12s %14s %14s %12s\n", "mode", "send_p50", "send_p99",
+                "recent_p50", "recent_p99", "inbox_rows");
+    report(readMode);
+    report(writeMode);
+    std::printf("(微秒；recent 为 getRecentChats 首页 20 条)\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+// 超大群基准：生成一个 10 万成员的群，测量批量导入、成员计数、分页成员列表、
+// 成员打开最近聊天列表和群内发言，并与逐条 joinGroup、COUNT(*)、整群读取、
+// 旧的 GROUP BY 聚合查询对比
+//
+// 用法: ./bench_group [--db 路径] [--members N] [--messages M] [--iterations K]
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "database.h"
+#include "bench_util.h"
+#include "seed.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char* const kGroup = "biggroup";
+
+struct Row {
+    std::string name;
+    int iterations;
+    double p50, p99;
+};
+
+static Row measure(const std::string& name, int iterations, const std::function<void(int)>& op) {
+    bench::LatencyStats stats;
+    for (int i = 0; i < iterations; ++i) {
+        double t0 = bench::nowMicros();
+        op(i);
+        stats.add(bench::nowMicros() - t0);
+    }
+    Row row = { name, iterations, stats.percentile(50), stats.percentile(99) };
+    return row;
+}
+
+// 改动前 getRecentChats 中群聊部分的聚合查询
+static const char* const kLegacyGroupSql =
+    "SELECT m.receiver, m.content, MAX(m.timestamp), 1 FROM messages m "
+    "INNER JOIN group_members gm ON m.receiver = gm.group_name "
+    "WHERE gm.username = ? AND m.is_group = 1 GROUP BY m.receiver ORDER BY 3 DESC";
+
+static void runSql(sqlite3* conn, const char* sql, const std::string& param) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) != SQLITE_OK) return;
+    if (!param.empty()) sqlite3_bind_text(stmt, 1, param.c_str(), -1, SQLITE_TRANSIENT);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {}
+    sqlite3_finalize(stmt);
+}
+
+// 用独立连接在一个事务中写入群聊历史消息
+static void seedGroupHistory(const std::string& path, int members, int messages) {
+    sqlite3* conn;
+    if (sqlite3_open(path.c_str(), &conn) != SQLITE_OK) return;
+    sqlite3_exec(conn, "BEGIN", 0, 0, 0);
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(conn, "INSERT INTO messages (sender, receiver, content, is_group, timestamp) VALUES (?, ?, ?, 1, ?)",
+                       -1, &stmt, NULL);
+    time_t start = time(NULL) - 30 * 24 * 3600;
+    for (int i = 0; i < messages; ++i) {
+        std::string sender = bench::userName((int)((i * 7919LL) % members));
+        time_t ts = start + (time_t)((double)i / messages * 30 * 24 * 3600);
+        char tsBuf[20];
+        std::strftime(tsBuf, sizeof(tsBuf), "%Y-%m-%d %H:%M:%S", std::gmtime(&ts));
+        sqlite3_bind_text(stmt, 1, sender.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, kGroup, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, "large group history", -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, tsBuf, -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(conn, "COMMIT", 0, 0, 0);
+    sqlite3_close(conn);
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = "bench_group.db";
+    int members = 100000;
+    int messages = 200000;
+    int iterations = 200;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) path = argv[++i];
+        else if (!strcmp(argv[i], "--members") && i + 1 < argc) members = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && i + 1 < argc) messages = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else {
+            std::cerr << "用法: " << argv[0] << " [--db 路径] [--members N] [--messages M] [--iterations K]" << std::endl;
+            return 1;
+        }
+    }
+    if (members < 10) members = 10;
+    if (iterations < 1) iterations = 1;
+
+    Database* db = Database::getInstance();
+    DatabaseOptions opts = DatabaseOptions::fromEnvironment();
+    opts.path = path;
+    opts.shmRing = false;
+    opts.prefetchCount = 0;
+    opts.slowLogPath = "";
+
+    std::remove(path.c_str());
+    if (!db->initialize(opts)) return 1;
+    db->close();
+    bench::SeedConfig cfg;
+    cfg.users = members;
+    cfg.friendsPerUser = 1;
+    cfg.groups = 0;
+    cfg.messages = 0;
+    if (!bench::seedDatabase(path, cfg)) {
+        std::cerr << "生成测试数据失败" << std::endl;
+        return 1;
+    }
+    if (!db->initialize(opts)) return 1;
+
+    std::vector<std::string> names;
+    names.reserve(members);
+    for (int i = 0; i < members; ++i) names.push_back(bench::userName(i));
+
+    // 导入：一个事务 + 复用语句，对比逐条 joinGroup（各自一个隐式事务）
+    db->createGroup(kGroup, names[0]);
+    double t0 = bench::nowMicros();
+    int added = db->importGroupMembers(kGroup, names);
+    double importMs = (bench::nowMicros() - t0) / 1000.0;
+
+    int joinSample = members < 2000 ? members : 2000;
+    db->createGroup("joingroup", names[0]);
+    t0 = bench::nowMicros();
+    for (int i = 0; i < joinSample; ++i) db->joinGroup(names[i], "joingroup");
+    double joinMs = (bench::nowMicros() - t0) / 1000.0;
+
+    std::cout << members << " 人的群，群聊历史 " << messages << " 条" << std::endl;
+    std::printf("importGroupMembers: %d 人 %.1f ms (%.0f 人/秒)\n", added, importMs, added / (importMs / 1000.0));
+    std::printf("逐条 joinGroup:     %d 人 %.1f ms (%.0f 人/秒)\n", joinSample, joinMs, joinSample / (joinMs / 1000.0));
+
+    db->close();
+    seedGroupHistory(path, members, messages);
+    if (!db->initialize(opts)) return 1;
+
+    sqlite3* raw;
+    sqlite3_open(path.c_str(), &raw);
+    auto member = [&](int i) { return names[(int)((i * 104729LL) % members)]; };
+    int fullIterations = iterations < 10 ? iterations : 10;
+
+    std::vector<Row> rows;
+    rows.push_back(measure("getGroupMemberCount", iterations, [&](int) { db->getGroupMemberCount(kGroup); }));
+    rows.push_back(measure("COUNT(*) group_members", fullIterations, [&](int) {
+        runSql(raw, "SELECT COUNT(*) FROM group_members WHERE group_name = 'biggroup'", "");
+    }));
+    rows.push_back(measure("getGroupMembers(page 50)", iterations, [&](int i) {
+        db->getGroupMembers(kGroup, member(i), 50);
+    }));
+    rows.push_back(measure("getGroupMembers(all)", fullIterations, [&](int) { db->getGroupMembers(kGroup); }));
+    rows.push_back(measure("getRecentChats(page)", iterations, [&](int i) { db->getRecentChats(member(i), 20, 0); }));
+    rows.push_back(measure("legacy GROUP BY recent", fullIterations, [&](int i) {
+        runSql(raw, kLegacyGroupSql, member(i));
+    }));
+    rows.push_back(measure("saveMessage(group)", iterations, [&](int i) {
+        db->saveMessage(member(i), kGroup, "bench 消息", true);
+    }));
+    rows.push_back(measure("visitConversation(group)", iterations, [&](int i) {
+        db->visitConversation(member(i), kGroup, true, [](const MessageView&) { return true; });
+    }));
+    sqlite3_close(raw);
+    db->close();
+
+    std::printf("\n%-28s %8s %12s %12s\n", "operation", "iters", "p50(us)", "p99(us)");
+    std::printf("--------------------------------------------------------------\n");
+    for (const auto& r : rows) {
+        std::printf("%-28s %8d %12.1f %12.1f\n", r.name.c_str(), r.iterations, r.p50, r.p99);
+    }
+
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+    return 0;
+}
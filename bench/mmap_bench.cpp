@@ -0,0 +1,132 @@
+// 内存映射与页缓存参数基准：比较不同打开参数下冷/热历史记录加载延迟
+//
+// 用法: ./bench_mmap [--db 路径] [--users N] [--messages M] [--queries Q] [--reseed]
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "database.h"
+#include "bench_util.h"
+#include "seed.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchConfig {
+    const char* name;
+    long long mmapSize;
+    int cacheSizeKb;
+    int tempStore;
+    bool warmup;
+};
+
+static bool fileExists(const std::string& path) {
+    std::ifstream f(path.c_str());
+    return f.good();
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = "bench_mmap.db";
+    int users = 200;
+    int messages = 200000;
+    int queries = 30;
+    bool reseed = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) path = argv[++i];
+        else if (!strcmp(argv[i], "--users") && i + 1 < argc) users = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && i + 1 < argc) messages = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--queries") && i + 1 < argc) queries = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--reseed")) reseed = true;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--db 路径] [--users N] [--messages M] [--queries Q] [--reseed]" << std::endl;
+            return 1;
+        }
+    }
+    if (users < 2) users = 2;
+
+    Database* db = Database::getInstance();
+    DatabaseOptions base;
+    base.path = path;
+
+    if (reseed || !fileExists(path)) {
+        std::remove(path.c_str());
+        if (!db->initialize(base)) return 1;
+        db->close();
+        std::cout << "生成测试数据: " << users << " 用户, " << messages << " 条消息..." << std::endl;
+        bench::SeedConfig seedCfg;
+        seedCfg.users = users;
+        seedCfg.messages = messages;
+        seedCfg.groups = 0;
+        if (!bench::seedDatabase(path, seedCfg)) {
+            std::cerr << "生成测试数据失败" << std::endl;
+            return 1;
+        }
+    }
+
+    const BenchConfig configs[] = {
+        { "sqlite-default",     0,                   0,         0, false },
+        { "cache-64M",          0,                   64 * 1024, 2, false },
+        { "mmap-256M",          256LL * 1024 * 1024, 0,         0, false },
+        { "mmap+cache",         256LL * 1024 * 1024, 64 * 1024, 2, false },
+        { "mmap+cache+warmup",  256LL * 1024 * 1024, 64 * 1024, 2, true  },
+    };
+
+    // 固定的查询会话序列，保证各配置可比
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(0, users - 1);
+    std::vector<std::pair<std::string, std::string> > pairs;
+    for (int i = 0; i < queries; ++i) {
+        int a = pick(rng);
+        pairs.push_back(std::make_pair(bench::userName(a), bench::userName(bench::friendOf(a, 0, users))));
+    }
+
+    printf("\n%-20s %10s %12s %12s %12s %12s\n", "config", "open(ms)", "cold p50", "cold p99", "warm p50", "warm p99");
+    printf("--------------------------------------------------------------------------------\n");
+
+    for (const auto& cfg : configs) {
+        DatabaseOptions opts = base;
+        opts.mmapSize = cfg.mmapSize;
+        opts.cacheSizeKb = cfg.cacheSizeKb;
+        opts.tempStore = cfg.tempStore;
+        opts.warmup = cfg.warmup;
+
+        bench::LatencyStats open, cold, warm;
+
+        // 冷启动：每次都驱逐页缓存并重新打开，测量首次加载历史记录
+        for (const auto& p : pairs) {
+            db->close();
+            bench::evictFromPageCache(path);
+
+            double t0 = bench::nowMicros();
+            if (!db->initialize(opts)) return 1;
+            double t1 = bench::nowMicros();
+            db->getMessages(p.first, p.second, false);
+            double t2 = bench::nowMicros();
+
+            open.add(t1 - t0);
+            cold.add(t2 - t1);
+        }
+
+        // 热态：同一连接上重复加载
+        for (const auto& p : pairs) {
+            db->getMessages(p.first, p.second, false);
+        }
+        for (const auto& p : pairs) {
+            double t0 = bench::nowMicros();
+            db->getMessages(p.first, p.second, false);
+            warm.add(bench::nowMicros() - t0);
+        }
+
+        printf("%-20s %10.2f %10.0fus %10.0fus %10.0fus %10.0fus\n", cfg.name,
+               open.mean() / 1000.0, cold.percentile(50), cold.percentile(99),
+               warm.percentile(50), warm.percentile(99));
+    }
+
+    db->close();
+    return 0;
+}
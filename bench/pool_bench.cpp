@@ -0,0 +1,208 @@
+// 线程池基准：单一全局队列与工作窃取调度器对比。
+// 每轮模拟一次推送扇出：S 个连接各提交一个任务，任务再拆成 F 个子任务，各编码一个 PUSH 帧。
+// 全局队列的子任务回到同一把锁下的队列；工作窃取时子任务进入当前线程自己的队列，空闲线程再来窃取。
+// 亲和模式以连接编号为提示，同一连接每轮落在同一个线程上
+//
+// 用法: ./bench_pool [--threads T] [--sessions S] [--fanout F] [--messages M] [--rounds R]
+
+#include "protocol.h"
+#include "scheduler.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 对照组：所有线程共用一把锁和一个队列
+class GlobalQueuePool {
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()> > tasks;
+    std::vector<std::thread> threads;
+    bool stopping;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+public:
+    explicit GlobalQueuePool(int count) : stopping(false) {
+        for (int i = 0; i < count; ++i) threads.push_back(std::thread(&GlobalQueuePool::run, this));
+    }
+    ~GlobalQueuePool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+    void submit(std::function<void()> task, int) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+};
+
+// 一轮任务的完成计数；两种线程池都用它等待，主线程不参与执行
+class Latch {
+private:
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining;
+
+public:
+    explicit Latch(int count) : remaining(count) {}
+    void countDown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) done.notify_all();
+    }
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+};
+
+struct Workload {
+    int sessions;
+    int fanout;
+    std::vector<MessageView> views;
+    std::atomic<size_t> sink;
+};
+
+static void encodeFrame(Workload& load) {
+    std::string out;
+    protocol::MessageBatchWriter batch(out, protocol::OP_PUSH);
+    for (const auto& view : load.views) batch.add(view);
+    batch.finish(false);
+    load.sink.fetch_add(out.size(), std::memory_order_relaxed);
+}
+
+struct Result {
+    const char* name;
+    bench::LatencyStats rounds;
+    Scheduler::Stats pool;
+    bool hasPoolStats;
+};
+
+template <typename Pool>
+static void runRounds(Pool& pool, Workload& load, int rounds, bool useAffinity, Result& result) {
+    for (int round = 0; round < rounds; ++round) {
+        Latch latch(load.sessions * load.fanout);
+        double t0 = bench::nowMicros();
+        for (int s = 0; s < load.sessions; ++s) {
+            int hint = useAffinity ? s : Scheduler::kNoAffinity;
+            pool.submit([&pool, &load, &latch]() {
+                for (int f = 0; f < load.fanout; ++f) {
+                    pool.submit([&load, &latch]() {
+                        encodeFrame(load);
+                        latch.countDown();
+                    }, Scheduler::kNoAffinity);
+                }
+            }, hint);
+        }
+        latch.wait();
+        result.rounds.add(bench::nowMicros() - t0);
+    }
+}
+
+static void report(Result& r, const Workload& load) {
+    double p50 = r.rounds.percentile(50);
+    double mean = r.rounds.mean();
+    double tasks = (double)load.sessions * (1 + load.fanout);
+    std::printf("%-24s %10.1f %10.1f %12.0f", r.name, p50, r.rounds.percentile(99), mean > 0 ? tasks / mean * 1e6 : 0.0);
+    if (r.hasPoolStats) {
+        std::printf(" %8llu %8llu %8llu %7llu %9llu/%llu", r.pool.queueP50, r.pool.queueP99, r.pool.runP50, r.pool.stolen,
+                    r.pool.affinityHits, r.pool.affinityTasks);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int rounds = 200;
+    int messages = 4;
+    Workload load;
+    load.sessions = 1000;
+    load.fanout = 4;
+    load.sink = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--sessions") && i + 1 < argc) load.sessions = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--fanout") && i + 1 < argc) load.fanout = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--messages") && i + 1 < argc) messages = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::atoi(argv[++i]);
+        else {
+            std::printf("用法: %s [--threads T] [--sessions S] [--fanout F] [--messages M] [--rounds R]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || load.sessions < 1 || load.fanout < 1 || messages < 1 || rounds < 1) {
+        std::printf("参数必须为正数\n");
+        return 1;
+    }
+
+    // 推送帧里的几条群消息
+    const std::string senders[] = { "alice", "bob" };
+    const std::string group = "project-group";
+    const std::string timestamp = "2024-06-01 12:00:00";
+    std::vector<std::string> contents;
+    for (int i = 0; i < messages; ++i) contents.push_back(std::string(40, (char)('a' + i % 26)));
+    for (int i = 0; i < messages; ++i) {
+        MessageView view;
+        view.id = 500000 + i;
+        view.sender = protocol::textOf(senders[i % 2]);
+        view.receiver = protocol::textOf(group);
+        view.content = protocol::textOf(contents[i]);
+        view.timestamp = protocol::textOf(timestamp);
+        view.isGroup = true;
+        load.views.push_back(view);
+    }
+
+    Result global = { "global queue", bench::LatencyStats(), Scheduler::Stats(), false };
+    Result stealing = { "work stealing", bench::LatencyStats(), Scheduler::Stats(), true };
+    Result affinity = { "work stealing+affinity", bench::LatencyStats(), Scheduler::Stats(), true };
+    {
+        GlobalQueuePool pool(threads);
+        runRounds(pool, load, rounds, false, global);
+    }
+    {
+        Scheduler pool;
+        pool.start(threads);
+        runRounds(pool, load, rounds, false, stealing);
+        stealing.pool = pool.stats();
+        pool.resetStats();
+        runRounds(pool, load, rounds, true, affinity);
+        affinity.pool = pool.stats();
+    }
+
+    std::printf("%d 线程，每轮 %d 个连接 x %d 个子任务，每帧 %d 条消息，%d 轮\n", threads, load.sessions, load.fanout,
+                messages, rounds);
+    std::printf("%-24s %10s %10s %12s %8s %8s %8s %7s %11s\n", "pool", "round_p50", "round_p99", "tasks/s", "queue50",
+                "queue99", "run50", "stolen", "affinity");
+    report(global, load);
+    report(stealing, load);
+    report(affinity, load);
+    std::printf("(checksum %zu)\n", load.sink.load());
+    return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef BENCH_SEED_H
+#define BENCH_SEED_H
+
+#include <sqlite3.h>
+#include <ctime>
+#include <random>
+#include <string>
+
+// 基准测试数据生成：通过独立连接在单个事务中批量写入
+namespace bench {
+
+struct SeedConfig {
+    int users;
+    int friendsPerUser;
+    int groups;
+    int groupSize;
+    int messages;
+    double groupMessageRatio;   // 群聊消息所占比例
+    unsigned seed;
+
+    SeedConfig()
+        : users(1000), friendsPerUser(10), groups(50), groupSize(20),
+          messages(100000), groupMessageRatio(0.2), seed(42) {}
+};
+
+inline std::string userName(int i) {
+    return "user" + std::to_string(i);
+}
+
+inline std::string groupName(int i) {
+    return "group" + std::to_string(i);
+}
+
+// 第 k 个好友：每个用户只和编号相邻的少数人往来，保证会话足够集中
+inline int friendOf(int user, int k, int users) {
+    return (user + 1 + k) % users;
+}
+
+inline bool seedDatabase(const std::string& path, const SeedConfig& cfg) {
+    sqlite3* conn;
+    if (sqlite3_open(path.c_str(), &conn) != SQLITE_OK) return false;
+
+    sqlite3_exec(conn, "BEGIN", 0, 0, 0);
+    sqlite3_stmt* stmt;
+
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO users (username, password) VALUES (?, '123')", -1, &stmt, NULL);
+    for (int i = 0; i < cfg.users; ++i) {
+        std::string name = userName(i);
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO friendships (user1, user2) VALUES (?, ?)", -1, &stmt, NULL);
+    for (int i = 0; i < cfg.users; ++i) {
+        std::string a = userName(i);
+        for (int k = 0; k < cfg.friendsPerUser && k < cfg.users - 1; ++k) {
+            std::string b = userName(friendOf(i, k, cfg.users));
+            // 与 Database::addFriend 一致，好友关系双向存储
+            sqlite3_bind_text(stmt, 1, a.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, b.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, b.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, a.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_stmt* groupStmt;
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO groups (name, creator) VALUES (?, ?)", -1, &groupStmt, NULL);
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO group_members (group_name, username) VALUES (?, ?)", -1, &stmt, NULL);
+    for (int g = 0; g < cfg.groups; ++g) {
+        std::string name = groupName(g);
+        int first = (int)((long long)g * cfg.users / (cfg.groups > 0 ? cfg.groups : 1));
+        std::string creator = userName(first % cfg.users);
+        sqlite3_bind_text(groupStmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(groupStmt, 2, creator.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(groupStmt);
+        sqlite3_reset(groupStmt);
+
+        for (int m = 0; m < cfg.groupSize && m < cfg.users; ++m) {
+            std::string member = userName((first + m) % cfg.users);
+            sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, member.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+    }
+    sqlite3_finalize(groupStmt);
+    sqlite3_finalize(stmt);
+
+    std::mt19937 rng(cfg.seed);
+    std::uniform_int_distribution<int> pickUser(0, cfg.users - 1);
+    std::uniform_int_distribution<int> pickFriend(0, cfg.friendsPerUser > 0 ? cfg.friendsPerUser - 1 : 0);
+    std::uniform_int_distribution<int> pickGroup(0, cfg.groups > 0 ? cfg.groups - 1 : 0);
+    std::uniform_int_distribution<int> pickMember(0, cfg.groupSize > 0 ? cfg.groupSize - 1 : 0);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    time_t start = time(NULL) - 90 * 24 * 3600;
+
+    sqlite3_prepare_v2(conn, "INSERT INTO messages (sender, receiver, content, is_group, timestamp) VALUES (?, ?, ?, ?, ?)", -1, &stmt, NULL);
+    for (int i = 0; i < cfg.messages; ++i) {
+        std::string sender, receiver;
+        bool isGroup = cfg.groups > 0 && coin(rng) < cfg.groupMessageRatio;
+        if (isGroup) {
+            int g = pickGroup(rng);
+            int first = (int)((long long)g * cfg.users / cfg.groups);
+            sender = userName((first + pickMember(rng)) % cfg.users);
+            receiver = groupName(g);
+        } else {
+            int a = pickUser(rng);
+            sender = userName(a);
+            receiver = userName(friendOf(a, pickFriend(rng), cfg.users));
+        }
+        std::string content = "benchmark message #" + std::to_string(i) + " 这是一条用于测试的消息";
+
+        time_t ts = start + (time_t)((double)i / cfg.messages * 90 * 24 * 3600);
+        char tsBuf[20];
+        std::strftime(tsBuf, sizeof(tsBuf), "%Y-%m-%d %H:%M:%S", std::gmtime(&ts));
+
+        sqlite3_bind_text(stmt, 1, sender.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, receiver.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, content.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, isGroup ? 1 : 0);
+        sqlite3_bind_text(stmt, 5, tsBuf, -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    int rc = sqlite3_exec(conn, "COMMIT", 0, 0, 0);
+    sqlite3_close(conn);
+    return rc == SQLITE_OK;
+}
+
+}  // namespace bench
+
+#endif
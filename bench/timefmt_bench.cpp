@@ -0,0 +1,160 @@
+// 消息时间格式化基准：10k 行一次渲染，比较每行都取当前时间的旧实现
+// 与按天缓存、写入调用方缓冲区的 TimeFormatter，同时统计每次渲染的堆分配次数
+//
+// 用法: ./bench_timefmt [--rows N] [--passes P]
+
+#include "chat.h"
+#include "timefmt.h"
+#include "bench_util.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+// 统计全部堆分配
+static std::atomic<long long> allocations(0);
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// 改动前 Chat::formatMessageTime 的实现：每行都调用 getCurrentTime()
+static std::string legacyCurrentTime() {
+    auto now = std::chrono::system_clock::now();
+    auto t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&t);
+    char buffer[20];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    return std::string(buffer);
+}
+
+static std::string legacyFormatMessageTime(const std::string& timestamp) {
+    if (timestamp.length() >= 19) {
+        std::string msgDate = timestamp.substr(0, 10);
+        std::string todayDate = legacyCurrentTime().substr(0, 10);
+        if (msgDate == todayDate) {
+            return timestamp.substr(11, 8);
+        } else {
+            std::string month = timestamp.substr(5, 2);
+            std::string day = timestamp.substr(8, 2);
+            std::string time = timestamp.substr(11, 8);
+            return month + "-" + day + " " + time;
+        }
+    }
+    return timestamp;
+}
+
+struct PassResult {
+    const char* name;
+    bench::LatencyStats stats;
+    long long allocationsPerPass;
+};
+
+static void report(PassResult& r, int rows) {
+    double p50 = r.stats.percentile(50);
+    std::printf("%-28s %10.1f %10.1f %10.1f %12.1f %12lld\n", r.name, p50, r.stats.percentile(99),
+                r.stats.mean(), p50 * 1000.0 / rows, r.allocationsPerPass);
+}
+
+int main(int argc, char* argv[]) {
+    int rows = 10000;
+    int passes = 50;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--rows") && i + 1 < argc) rows = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--passes") && i + 1 < argc) passes = std::atoi(argv[++i]);
+        else {
+            std::printf("用法: %s [--rows N] [--passes P]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // 时间戳分布在最近三天内，约三分之一是今天
+    std::vector<std::string> timestamps;
+    std::time_t now = std::time(NULL);
+    for (int i = 0; i < rows; ++i) {
+        std::time_t t = now - (std::time_t)((long long)i * 3 * 86400 / rows);
+        struct tm local = *std::localtime(&t);
+        char buffer[20];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        timestamps.push_back(buffer);
+    }
+
+    std::vector<std::string> messageContent(rows, "bench 消息内容");
+    std::vector<MessageView> views(rows);
+    for (int i = 0; i < rows; ++i) {
+        MessageView& v = views[i];
+        v.id = i + 1;
+        v.sender.data = "alice";
+        v.sender.size = 5;
+        v.receiver.data = "bob";
+        v.receiver.size = 3;
+        v.content.data = messageContent[i].data();
+        v.content.size = (int)messageContent[i].size();
+        v.timestamp.data = timestamps[i].data();
+        v.timestamp.size = (int)timestamps[i].size();
+        v.isGroup = false;
+    }
+
+    PassResult legacy = { "legacy formatMessageTime", bench::LatencyStats(), 0 };
+    PassResult cached = { "TimeFormatter (buffer)", bench::LatencyStats(), 0 };
+    PassResult lines = { "Chat::formatMessageLine", bench::LatencyStats(), 0 };
+    size_t sink = 0;
+
+    TimeFormatter formatter;
+    Chat chat("alice");
+    for (int pass = 0; pass < passes; ++pass) {
+        long long before = allocations.load();
+        double t0 = bench::nowMicros();
+        for (int i = 0; i < rows; ++i) {
+            sink += legacyFormatMessageTime(timestamps[i]).size();
+        }
+        double elapsed = bench::nowMicros() - t0;
+        legacy.allocationsPerPass = allocations.load() - before;
+        legacy.stats.add(elapsed);
+
+        before = allocations.load();
+        t0 = bench::nowMicros();
+        formatter.refresh();
+        char buffer[TimeFormatter::kBufferSize];
+        for (int i = 0; i < rows; ++i) {
+            sink += formatter.formatMessageTime(timestamps[i].data(), timestamps[i].size(), buffer);
+        }
+        elapsed = bench::nowMicros() - t0;
+        cached.allocationsPerPass = allocations.load() - before;
+        cached.stats.add(elapsed);
+
+        // 整行拼接（聊天窗口实际的渲染路径），每行只分配结果字符串本身
+        before = allocations.load();
+        t0 = bench::nowMicros();
+        for (int i = 0; i < rows; ++i) {
+            sink += chat.formatMessageLine(views[i]).size();
+        }
+        elapsed = bench::nowMicros() - t0;
+        lines.allocationsPerPass = allocations.load() - before;
+        lines.stats.add(elapsed);
+    }
+
+    std::printf("%d 行 x %d 轮\n", rows, passes);
+    std::printf("%-28s %10s %10s %10s %12s %12s\n", "method", "p50_us", "p99_us", "mean_us", "ns/row", "allocs/pass");
+    report(legacy, rows);
+    report(cached, rows);
+    report(lines, rows);
+    std::printf("(checksum %zu)\n", sink);
+    return 0;
+}
@@ -37,9 +37,57 @@ echo "开始编译..."
 echo "编译 database.cpp..."
 g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/database.cpp -o obj/database.o
 
+echo "编译 cache.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/cache.cpp -o obj/cache.o
+
+echo "编译 prefetch.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/prefetch.cpp -o obj/prefetch.o
+
+echo "编译 profiler.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/profiler.cpp -o obj/profiler.o
+
+echo "编译 metrics.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/metrics.cpp -o obj/metrics.o
+
+echo "编译 notifier.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/notifier.cpp -o obj/notifier.o
+
+echo "编译 watcher.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/watcher.cpp -o obj/watcher.o
+
+echo "编译 ring.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/ring.cpp -o obj/ring.o
+
+echo "编译 terminal.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/terminal.cpp -o obj/terminal.o
+
+echo "编译 reactor.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/reactor.cpp -o obj/reactor.o
+
+echo "编译 protocol.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/protocol.cpp -o obj/protocol.o
+
+echo "编译 uring.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/uring.cpp -o obj/uring.o
+
+echo "编译 scheduler.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/scheduler.cpp -o obj/scheduler.o
+
+echo "编译 server.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/server.cpp -o obj/server.o
+
+echo "编译 client.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/client.cpp -o obj/client.o
+
+echo "编译 session.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/session.cpp -o obj/session.o
+
 echo "编译 user.cpp..."
 g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/user.cpp -o obj/user.o
 
+echo "编译 timefmt.cpp..."
+g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/timefmt.cpp -o obj/timefmt.o
+
 echo "编译 chat.cpp..."
 g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-8 -c src/chat.cpp -o obj/chat.o
 
@@ -52,7 +100,7 @@ g++ -std=c++11 -Wall -Wextra -Iinclude -fexec-charset=UTF-8 -finput-charset=UTF-
 # 链接生成可执行文件
 echo
 echo "链接生成可执行文件..."
-g++ obj/sqlite3.o obj/database.o obj/user.o obj/chat.o obj/ui.o obj/main.o -o oicq
+g++ obj/sqlite3.o obj/database.o obj/cache.o obj/prefetch.o obj/profiler.o obj/metrics.o obj/notifier.o obj/watcher.o obj/ring.o obj/terminal.o obj/reactor.o obj/protocol.o obj/uring.o obj/scheduler.o obj/server.o obj/client.o obj/session.o obj/user.o obj/timefmt.o obj/chat.o obj/ui.o obj/main.o -o oicq
 
 if [ $? -eq 0 ]; then
     echo
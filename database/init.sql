@@ -44,11 +44,59 @@ CREATE TABLE IF NOT EXISTS messages (
     timestamp DATETIME DEFAULT CURRENT_TIMESTAMP
 );
 
+-- 群成员数：由下方触发器随 group_members 增删维护，读取时只需一次主键查找
+CREATE TABLE IF NOT EXISTS group_member_counts (
+    group_name TEXT PRIMARY KEY,
+    members INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_group_members_insert AFTER INSERT ON group_members
+BEGIN
+    INSERT INTO group_member_counts (group_name, members) VALUES (NEW.group_name, 1)
+    ON CONFLICT(group_name) DO UPDATE SET members = members + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_group_members_delete AFTER DELETE ON group_members
+BEGIN
+    UPDATE group_member_counts SET members = members - 1 WHERE group_name = OLD.group_name;
+END;
+
+-- 升级前创建的库：计数表为空时按现有成员补齐一次，之后由触发器维护
+INSERT INTO group_member_counts (group_name, members)
+SELECT group_name, COUNT(*) FROM group_members
+WHERE NOT EXISTS (SELECT 1 FROM group_member_counts)
+GROUP BY group_name;
+
+-- 写扩散的群组：成员数达到 OICQ_FANOUT_MIN_MEMBERS 后在下一次发言时加入，此后一直保持
+CREATE TABLE IF NOT EXISTS group_fanout (
+    group_name TEXT PRIMARY KEY,
+    enabled_at DATETIME DEFAULT CURRENT_TIMESTAMP
+);
+
+-- 写扩散收件箱：每个成员在每个写扩散群中一行，指向该群最新的消息，
+-- 最近聊天列表只需按 username 做一次主键范围读取
+CREATE TABLE IF NOT EXISTS group_inbox (
+    username TEXT NOT NULL,
+    group_name TEXT NOT NULL,
+    message_id INTEGER NOT NULL,
+    PRIMARY KEY (username, group_name)
+) WITHOUT ROWID;
+
 -- 系统配置表 (用于存储管理员密码等)
 CREATE TABLE IF NOT EXISTS system_config (
     key TEXT PRIMARY KEY,
     value TEXT NOT NULL
 );
 
+-- 索引：热点查询必须走索引检索 (SEARCH)，由 make check-plans 检查
+-- 私聊记录与最近聊天 (sender = ? [AND receiver = ?])
+CREATE INDEX IF NOT EXISTS idx_messages_sender ON messages(sender, receiver, timestamp);
+-- 群聊记录与最近聊天 (receiver = ? AND is_group = ?)
+CREATE INDEX IF NOT EXISTS idx_messages_receiver ON messages(receiver, is_group, timestamp);
+-- 反向好友关系 (删除用户时 user2 = ?)
+CREATE INDEX IF NOT EXISTS idx_friendships_user2 ON friendships(user2);
+-- 用户所在群组 (username = ?)
+CREATE INDEX IF NOT EXISTS idx_group_members_username ON group_members(username, group_name);
+
 -- 插入默认管理员密码
 INSERT OR IGNORE INTO system_config (key, value) VALUES ('admin_password', 'admin123');
\ No newline at end of file
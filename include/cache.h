@@ -0,0 +1,94 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "message.h"
+
+// 缓存条目的有效性标记：本连接的累计修改行数与 PRAGMA data_version（其它连接的提交）都未变化时，
+// 数据库中的消息一定没有变化，条目可直接使用
+struct CacheStamp {
+    long long dataVersion;
+    long long totalChanges;
+
+    bool operator==(const CacheStamp& other) const {
+        return dataVersion == other.dataVersion && totalChanges == other.totalChanges;
+    }
+};
+
+// 查找结果
+enum CacheState {
+    CACHE_FRESH,            // 命中且数据库未变化，无需查询
+    CACHE_STALE,            // 命中且只有本连接写入过，只需增量读取 maxId 之后的消息
+    CACHE_MISSING           // 未缓存，或其它连接提交过（可能删除了消息），需要重新读取整个窗口
+};
+
+// 命中率与内存占用
+struct MessageCacheStats {
+    long long hits;
+    long long deltaHits;
+    long long misses;
+    long long evictions;
+    long long prefetches;       // 后台预取写入的会话数
+    long long prefetchHits;     // 预取的会话随后被打开的次数
+    long long entries;
+    long long bytes;
+};
+
+// 最近查看过的会话的消息窗口：每个会话保留最新的 window 条消息及其最大 id，
+// 按最近使用顺序淘汰，总内存不超过 maxBytes。由 Database 持有，内部加锁
+class MessageCache {
+private:
+    struct Entry {
+        std::string key;
+        std::deque<Message> messages;   // 按时间升序，超出窗口时从头部丢弃
+        long long maxId;
+        long long bytes;
+        CacheStamp stamp;
+        bool prefetched;                // 预取写入且尚未被打开过
+    };
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries;           // 头部为最近使用
+    std::map<std::string, std::list<Entry>::iterator> index;
+    size_t window;
+    long long maxBytes;
+    long long totalBytes;
+    MessageCacheStats stats;
+
+    static long long messageBytes(const Message& msg);
+    void storeLocked(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp);
+    void trim(Entry& entry);
+    void evict();
+
+public:
+    MessageCache();
+
+    // maxBytes 为 0 时关闭缓存
+    void configure(size_t window, long long maxBytes);
+    bool enabled() const { return maxBytes > 0 && window > 0; }
+    size_t getWindow() const { return window; }
+
+    // 查找会话并移到 LRU 头部；命中时返回条目中的最大 id
+    CacheState lookup(const std::string& key, const CacheStamp& stamp, long long& maxId);
+    // 整个窗口替换条目内容
+    void store(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp);
+    // 后台预取：条目已存在时不覆盖（前台读到的内容不会更旧）
+    void storePrefetched(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp);
+    bool contains(const std::string& key) const;
+    // 追加增量读取的消息（id 升序）并更新标记
+    void append(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp);
+    // 在缓存锁内按时间顺序访问条目，条目不存在时返回 false；访问器中不能再访问缓存
+    bool visit(const std::string& key, const std::function<bool(const MessageView&)>& visitor);
+    // 删除消息后缓存内容不再可信
+    void clear();
+
+    MessageCacheStats getStats() const;
+};
+
+#endif
@@ -4,10 +4,15 @@
 #include <string>
 #include <vector>
 #include "database.h"
+#include "timefmt.h"
 
 class Chat {
 private:
     std::string currentUser;
+    TimeFormatter timeFormatter;    // 每批渲染前 refresh() 一次
+    
+    static const int kRecentPageSize = 20;  // 最近聊天列表每页条数
+    static const int kMemberPageSize = 50;  // 群成员列表每页人数
     
 public:
     Chat(const std::string& username);
@@ -17,6 +22,8 @@ public:
     void showRecentChats();
     void selectAndEnterChat();
     void interactiveChat(const std::string& target, bool isGroup);
+    // 分页浏览群成员，按用户名顺序翻页，不一次读出整个群
+    void showGroupMembers(const std::string& groupName);
     
     // 消息操作
     bool sendMessage(const std::string& receiver, const std::string& content, bool isGroup = false);
@@ -24,12 +31,15 @@ public:
     
     // 显示功能
     void displayMessages(const std::vector<Message>& messages);
-    void displayRecentChatsList();
+    void displayMessage(const MessageView& msg);
+    // 调用方需在本批渲染开始时调用过 timeFormatter.refresh()
+    std::string formatMessageLine(const MessageView& msg);
+    // 显示第 page 页（从 0 开始）并返回该页内容，hasMore 表示是否还有下一页
+    std::vector<Database::RecentChat> displayRecentChatsList(int page, bool& hasMore);
     void clearScreen();
     std::string getCurrentTime();
     std::string formatTimeDisplay(const std::string& timestamp);
     std::string formatMessageTime(const std::string& timestamp);
-    std::string getLastMessageTime(const std::string& target, bool isGroup);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "database.h"
+#include "message.h"
+#include "protocol.h"
+
+// oicqd 的阻塞式客户端：请求按顺序得到应答，等待应答期间收到的 PUSH 帧暂存起来，
+// 由 readPush() 取走。一个 ChatClient 只应在一个线程上使用。仅支持 POSIX 套接字
+class ChatClient {
+private:
+    int fd;
+    std::string input;
+    size_t inputStart;              // input 中已处理的字节数，下次接收前再前移
+    std::deque<Message> pushes;
+    std::string lastError;
+
+    bool sendRequest(const protocol::Request& request);
+    // 读取下一帧；正文视图在下一次读取前有效。timeoutMs < 0 表示一直等待
+    bool readFrame(const char*& body, size_t& size, int timeoutMs);
+    // 读取下一个非 PUSH 帧，期间的推送放入队列
+    bool readReply(const char*& body, size_t& size);
+    void queuePushes(const char* body, size_t size);
+    // 发送请求并读取单帧应答，应答为 OK / PONG / BYE 时返回 true，否则把原因记入 lastError
+    bool call(const protocol::Request& request);
+    bool failWith(const char* body, size_t size);
+
+public:
+    ChatClient();
+    ~ChatClient();
+
+    bool connectTcp(const std::string& host, int port);
+    bool connectUnix(const std::string& path);
+    // "地址:端口"，或含 '/' 的 Unix 套接字路径；只有端口时连接 127.0.0.1
+    bool connect(const std::string& address);
+    // 交出连接描述符，此后由调用方负责关闭
+    int release();
+    void disconnect();
+    bool isConnected() const { return fd >= 0; }
+    // 供调用方和标准输入一起 poll
+    int socketFd() const { return fd; }
+    const std::string& error() const { return lastError; }
+
+    bool ping();
+    bool registerUser(const std::string& username, const std::string& password);
+    bool login(const std::string& username, const std::string& password);
+    bool addFriend(const std::string& username);
+    bool createGroup(const std::string& groupName);
+    bool joinGroup(const std::string& groupName);
+    bool send(const std::string& target, bool isGroup, const std::string& content);
+    // afterId 为 0 时取最新一屏，否则取该 id 之后的全部消息
+    bool history(const std::string& target, bool isGroup, long long afterId, std::vector<Message>& messages);
+    bool recent(int limit, int offset, std::vector<Database::RecentChat>& chats, bool* hasMore = nullptr);
+    bool watch(const std::string& target, bool isGroup);
+    bool unwatch();
+    void quit();
+
+    // 取一条推送；队列为空时最多等待 timeoutMs 毫秒（0 表示只读取已到达的数据）
+    bool readPush(Message& msg, int timeoutMs);
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+// 无栈协程（C++11）：协程体写在一个成员函数里，用 CO_BEGIN / CO_AWAIT / CO_END 包裹。
+// 挂起时记下所在行号并从函数返回，下次调用时由 switch 跳回该行重新检查等待条件。
+// 协程帧就是对象本身：跨越挂起点的状态必须放在成员变量里，函数内的局部变量在挂起后失效；
+// CO_AWAIT 不能写在协程体内嵌套的 switch 中，同一行也只能有一个 CO_AWAIT
+class Coroutine {
+private:
+    int line;
+
+public:
+    Coroutine() : line(0) {}
+    bool isDone() const { return line < 0; }
+    // 供下面的宏使用
+    int& resumePoint() { return line; }
+};
+
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define CO_FALLTHROUGH __attribute__((fallthrough))
+#else
+#define CO_FALLTHROUGH ((void)0)
+#endif
+
+#define CO_BEGIN(co) switch ((co).resumePoint()) { case 0:
+
+// condition 不成立时挂起，恢复后从这里重新检查
+#define CO_AWAIT(co, condition)                     \
+    do {                                            \
+        (co).resumePoint() = __LINE__;              \
+        CO_FALLTHROUGH;                             \
+        case __LINE__:                              \
+        if (!(condition)) return;                   \
+    } while (0)
+
+// 提前结束协程
+#define CO_RETURN(co)                               \
+    do {                                            \
+        (co).resumePoint() = -1;                    \
+        return;                                     \
+    } while (0)
+
+#define CO_END(co) } (co).resumePoint() = -1
+
+#endif
@@ -4,30 +4,136 @@
 #include <sqlite3.h>
 #include <string>
 #include <vector>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "message.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "profiler.h"
+#include "notifier.h"
+#include "watcher.h"
+#include "ring.h"
 
-struct Message {
-    int id;
-    std::string sender;
-    std::string receiver;
-    std::string content;
-    std::string timestamp;
-    bool isGroup;
+// 数据库打开参数，在 initialize 时以 PRAGMA 形式生效
+struct DatabaseOptions {
+    std::string path;           // 数据库文件路径
+    std::string initScript;     // 初始化SQL脚本路径
+    long long mmapSize;         // PRAGMA mmap_size，单位字节，0 表示关闭内存映射
+    int cacheSizeKb;            // PRAGMA cache_size，单位 KiB，0 表示使用 SQLite 默认值
+    int tempStore;              // PRAGMA temp_store: 0=默认 1=文件 2=内存
+    bool warmup;                // 打开后预读各索引中最新行所在的页，默认只有 oicqd 开启
+    std::string journalMode;    // PRAGMA journal_mode，空串表示不修改
+    int busyTimeoutMs;          // 遇到 SQLITE_BUSY 时最长等待时间
+    bool profile;               // 记录每条语句的耗时和扫描行数，默认关闭
+    double slowQueryMs;         // 慢查询阈值
+    std::string slowLogPath;    // 慢查询日志（开启 profile 时），不含目录时放在数据库文件旁，空串表示不写日志
+    bool shmRing;               // 通过 /dev/shm 通知环与本机其它进程交换新消息通知，默认只有 oicq 开启
+    long long messageCacheBytes; // 会话消息缓存的内存上限，0 表示关闭
+    int messageCacheWindow;     // 每个会话缓存（及显示）的最新消息条数
+    int prefetchCount;          // 最近聊天列表中后台预取的会话数，0 表示不预取
+    int fanoutMinMembers;       // 群成员数达到该值后改为写扩散（写入时更新成员收件箱），0 表示始终读扩散
+    
+    DatabaseOptions();
+    // 读取 OICQ_DB_PATH / OICQ_MMAP_SIZE / OICQ_CACHE_SIZE_KB / OICQ_TEMP_STORE / OICQ_WARMUP
+    //      OICQ_JOURNAL_MODE / OICQ_BUSY_TIMEOUT_MS / OICQ_PROFILE / OICQ_SLOW_QUERY_MS / OICQ_SLOW_LOG
+    //      OICQ_SHM_RING / OICQ_MSG_CACHE_BYTES / OICQ_MSG_CACHE_WINDOW
+    //      OICQ_PREFETCH_COUNT / OICQ_FANOUT_MIN_MEMBERS
+    static DatabaseOptions fromEnvironment();
+    // 以 defaults 为基础，环境变量覆盖其中的项；供各程序设置自己的默认值
+    static DatabaseOptions fromEnvironment(const DatabaseOptions& defaults);
 };
 
+// 行访问器：返回 false 可提前终止遍历
+typedef std::function<bool(const MessageView&)> MessageVisitor;
+typedef std::function<bool(const TextView&)> NameVisitor;
+
 class Database {
 private:
     sqlite3* db;
     static Database* instance;
+    DatabaseOptions options;
+    long long busyWaits;        // 因锁冲突而等待的次数
+    QueryProfiler profiler;
+    MessageNotifier notifier;
+    std::mutex pendingMutex;
+    std::vector<long long> pendingMessageIds;   // 已插入但尚未通知的消息 rowid
+    ChangeWatcher watcher;
+    long long lastDataVersion;                  // 上次检查时的 PRAGMA data_version
+    long long lastExternalId;                   // 已通知过的最大消息 id
+    SharedRing ring;
+    std::thread ringThread;
+    std::atomic<bool> ringStopping;
+    unsigned long long ringCursor;              // 本进程在通知环中的读取位置
+    MessageCache messageCache;
+    Prefetcher prefetcher;
     
     Database();
+    static int busyHandler(void* self, int attempts);
+    static void updateHook(void* self, int op, const char* dbName, const char* table, sqlite3_int64 rowid);
+    static void rollbackHook(void* self);
+    void publishCommittedMessages();
+    long long maxMessageId();
+    void tailRing();
     bool executeSQL(const std::string& sql);
+    bool applyOptions();
+    void warmupIndexes();
+    CacheStamp cacheStamp();
+    // 会话最新的 limit 条消息，按时间升序
+    bool fetchLatestMessages(sqlite3* conn, const std::string& user1, const std::string& user2, bool isGroup,
+                             int limit, std::vector<Message>& messages);
+    void prefetchConversation(sqlite3* conn, const PrefetchTarget& target);
+    // 写扩散：已切换的群，或成员数达到阈值、将在本次发言时切换的群
+    bool isFanoutGroup(const std::string& groupName);
+    bool wantsWriteFanout(const std::string& groupName);
+    // 在一个事务中写入群消息并把所有成员的收件箱指向它
+    bool saveFanoutMessage(const std::string& sender, const std::string& groupName, const std::string& content);
+    // 群内最新消息的 id，没有消息时返回 0
+    long long latestGroupMessageId(const std::string& groupName);
+    // 群的最新消息被删除后，把成员收件箱改指向剩余的最新消息
+    void repointInbox(const std::string& groupName);
+    
+    // 逐行驱动已绑定参数的语句，结束后负责 finalize
+    bool stepRows(sqlite3_stmt* stmt, const std::function<bool(sqlite3_stmt*)>& onRow);
+    static TextView columnView(sqlite3_stmt* stmt, int col);
+    static int bindConversation(sqlite3_stmt* stmt, const std::string& user1,
+                                const std::string& user2, bool isGroup);
+    static MessageView messageView(sqlite3_stmt* stmt, bool isGroup);
     
 public:
     static Database* getInstance();
     ~Database();
     
-    bool initialize();
+    bool initialize(const DatabaseOptions& opts = DatabaseOptions());
     void close();
+    const DatabaseOptions& getOptions() const { return options; }
+    
+    // 并发诊断
+    int lastErrorCode() const { return db ? sqlite3_errcode(db) : SQLITE_MISUSE; }
+    long long getBusyWaits() const { return busyWaits; }
+    
+    // 页缓存命中/未命中次数 (SQLITE_DBSTATUS_CACHE_HIT / CACHE_MISS)
+    bool getCacheStats(long long& hits, long long& misses);
+    // 会话消息缓存的命中次数与内存占用
+    MessageCacheStats getMessageCacheStats() const { return messageCache.getStats(); }
+    
+    // 语句级性能统计
+    QueryProfiler& getProfiler() { return profiler; }
+    
+    // 新消息通知：本进程写入的消息提交后唤醒对应会话的订阅者
+    MessageNotifier& getNotifier() { return notifier; }
+    // PRAGMA data_version：其它连接提交后变化，可廉价判断是否需要重新查询
+    long long dataVersion();
+    // 其它进程提交后增量读取新消息并通知订阅者；data_version 未变化时不查询消息表。
+    // 与其它查询一样只在持有连接的线程上调用
+    void checkExternalChanges();
+    // 开始接收其它进程的新消息：优先读取共享通知环，不可用时监视数据库文件；都不支持时返回 false。
+    // 文件监视线程不访问连接，只调用 wake 唤醒持有连接的线程，由它调用 checkExternalChanges()
+    bool startChangeWatcher(const std::function<void()>& wake);
+    // 停止文件监视，wake 引用的对象销毁前调用；通知环不受影响
+    void stopChangeWatcher() { watcher.stop(); }
+    bool isWatchingChanges() const { return ringThread.joinable() || watcher.isActive(); }
     
     // 用户相关操作
     bool createUser(const std::string& username, const std::string& password);
@@ -39,14 +145,46 @@ public:
     // 好友关系操作
     bool addFriend(const std::string& username, const std::string& friendName);
     std::vector<std::string> getFriends(const std::string& username);
+    bool visitFriends(const std::string& username, const NameVisitor& visitor);
+    // 只查 UNIQUE(user1, user2) 索引，供服务端在转发前校验权限
+    bool areFriends(const std::string& user1, const std::string& user2);
     
     // 群组操作
     bool createGroup(const std::string& groupName, const std::string& creator);
     bool joinGroup(const std::string& username, const std::string& groupName);
     bool removeFromGroup(const std::string& username, const std::string& groupName);
+    // 批量成员变更的逐人结果
+    enum MembershipOutcome {
+        MEMBER_ADDED,           // 已加入
+        MEMBER_ALREADY,         // 原本就在群中
+        MEMBER_REMOVED,         // 已移出
+        MEMBER_ABSENT,          // 原本就不在群中
+        MEMBER_NO_USER,         // 用户不存在
+        MEMBER_FAILED           // 写入失败，该用户的部分写入已撤销
+    };
+    struct MembershipResult {
+        std::string username;
+        MembershipOutcome outcome;
+    };
+    // 批量加入/移出：单个事务、复用同一条预编译语句，每人一个保存点，results 与 usernames 一一对应。
+    // 群不存在或事务提交失败时返回 false（提交失败时全部记为 MEMBER_FAILED）
+    bool joinGroupBulk(const std::string& groupName, const std::vector<std::string>& usernames,
+                       std::vector<MembershipResult>& results);
+    bool removeFromGroupBulk(const std::string& groupName, const std::vector<std::string>& usernames,
+                             std::vector<MembershipResult>& results);
+    // 批量导入成员（joinGroupBulk 的简化形式），返回新加入的人数，失败时返回 -1
+    int importGroupMembers(const std::string& groupName, const std::vector<std::string>& usernames);
     std::vector<std::string> getUserGroups(const std::string& username);
     std::vector<std::string> getGroupMembers(const std::string& groupName);
+    bool visitGroupMembers(const std::string& groupName, const NameVisitor& visitor);
+    // 按用户名分页：返回 afterUsername 之后的至多 limit 人（首页传空串），走 (group_name, username) 索引定位
+    std::vector<std::string> getGroupMembers(const std::string& groupName, const std::string& afterUsername, int limit);
+    bool visitGroupMembersPage(const std::string& groupName, const std::string& afterUsername, int limit,
+                               const NameVisitor& visitor);
+    // 成员数来自触发器维护的计数表，不随成员数增长
+    long long getGroupMemberCount(const std::string& groupName);
     bool isGroupCreator(const std::string& username, const std::string& groupName);
+    bool isGroupMember(const std::string& username, const std::string& groupName);
     
     // 权限管理
     bool verifySystemPassword(const std::string& password);
@@ -56,6 +194,18 @@ public:
                     const std::string& content, bool isGroup = false);
     std::vector<Message> getMessages(const std::string& user1, const std::string& user2, 
                                    bool isGroup = false);
+    bool visitMessages(const std::string& user1, const std::string& user2, 
+                       bool isGroup, const MessageVisitor& visitor);
+    // 增量读取：按 id 顺序访问 afterId 之后的消息
+    bool visitMessagesSince(const std::string& user1, const std::string& user2, bool isGroup,
+                            long long afterId, const MessageVisitor& visitor);
+    long long getLastMessageId(const std::string& user1, const std::string& user2, bool isGroup);
+    // 会话最新的一屏消息（按时间升序），优先使用缓存：数据库未变化时不查询，
+    // 有变化时只增量读取缓存中最大 id 之后的消息
+    bool visitConversation(const std::string& user1, const std::string& user2, bool isGroup,
+                           const MessageVisitor& visitor);
+    // 在后台把这些会话读入缓存，覆盖尚未完成的上一批；预取未启用时什么也不做
+    void prefetchConversations(const std::vector<PrefetchTarget>& targets);
     
     // 获取最近聊天列表
     struct RecentChat {
@@ -64,7 +214,15 @@ public:
         std::string lastTime;
         bool isGroup;
     };
-    std::vector<RecentChat> getRecentChats(const std::string& username);
+    // 按最后消息时间倒序；limit > 0 时只返回从第 offset 条起的 limit 条，
+    // 私聊按好友、群聊按所在群各沿索引取最新一条，排序只涉及会话数；
+    // 每个子查询带 LIMIT，SQLite 的排序器只保留前 offset + limit + 1 行。hasMore 报告是否还有下一页
+    std::vector<RecentChat> getRecentChats(const std::string& username, int limit = 0, int offset = 0,
+                                           bool* hasMore = nullptr);
+    
+private:
+    // 批量成员变更的事务收尾：提交失败时回滚并把结果全部记为失败
+    bool finishBulk(bool ok, std::vector<MembershipResult>& results);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <string>
+
+// 消息行及其借用视图，Database 与 MessageCache 共用
+struct Message {
+    int id;
+    std::string sender;
+    std::string receiver;
+    std::string content;
+    std::string timestamp;
+    bool isGroup;
+};
+
+// 借用的文本视图：直接指向 sqlite3_column_text 返回的缓冲区，
+// 仅在访问器回调期间有效，需要保留时请调用 str() 拷贝
+struct TextView {
+    const char* data;
+    int size;
+    
+    std::string str() const { return std::string(data, size); }
+    bool operator==(const std::string& other) const {
+        return other.size() == (size_t)size && other.compare(0, other.size(), data, size) == 0;
+    }
+};
+
+// 消息行的借用视图，字段有效期同 TextView
+struct MessageView {
+    int id;
+    TextView sender;
+    TextView receiver;
+    TextView content;
+    TextView timestamp;
+    bool isGroup;
+};
+
+// 借用 Message 的视图，有效期同 msg
+inline MessageView viewOf(const Message& msg) {
+    MessageView view;
+    view.id = msg.id;
+    view.sender.data = msg.sender.data();
+    view.sender.size = (int)msg.sender.size();
+    view.receiver.data = msg.receiver.data();
+    view.receiver.size = (int)msg.receiver.size();
+    view.content.data = msg.content.data();
+    view.content.size = (int)msg.content.size();
+    view.timestamp.data = msg.timestamp.data();
+    view.timestamp.size = (int)msg.timestamp.size();
+    view.isGroup = msg.isGroup;
+    return view;
+}
+
+// 拷贝视图指向的内容
+inline Message messageOf(const MessageView& view) {
+    Message msg;
+    msg.id = view.id;
+    msg.sender = view.sender.str();
+    msg.receiver = view.receiver.str();
+    msg.content = view.content.str();
+    msg.timestamp = view.timestamp.str();
+    msg.isGroup = view.isGroup;
+    return msg;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 按业务操作分类的查询计数
+enum QueryType {
+    QUERY_USER,             // 注册、登录、查找用户
+    QUERY_FRIEND,           // 好友关系
+    QUERY_GROUP,            // 群组与群成员
+    QUERY_HISTORY,          // 读取聊天记录
+    QUERY_SEND,             // 写入消息
+    QUERY_RECENT,           // 最近聊天列表
+    QUERY_TYPE_COUNT
+};
+
+// 指标导出参数
+struct MetricsOptions {
+    std::string path;           // 指标文件路径，"%p" 替换为进程号，空串表示不导出
+    int intervalSec;            // 写出间隔
+    bool renderStats;           // 在聊天窗口标题下显示上一帧的渲染耗时和写出字节数
+
+    MetricsOptions();
+    // 读取 OICQ_METRICS_FILE / OICQ_METRICS_INTERVAL / OICQ_RENDER_STATS
+    static MetricsOptions fromEnvironment();
+};
+
+// 进程内运行指标：热路径上只做一次 relaxed 原子加法，不加锁；
+// 导出线程定期以 Prometheus 文本格式写入文件，供 node_exporter 的 textfile collector 采集
+class Metrics {
+private:
+    static Metrics* instance;
+
+    std::atomic<long long> messagesSent[2];     // [0] 私聊 [1] 群聊
+    std::atomic<long long> queries[QUERY_TYPE_COUNT];
+    std::atomic<long long> refreshPolls;
+    std::atomic<long long> refreshUpdates;
+    std::atomic<long long> renderFrames;
+    std::atomic<long long> renderBytes;
+    std::atomic<long long> renderMicros;
+
+    MetricsOptions options;
+    std::string outputPath;
+    std::thread exporter;
+    std::mutex exporterMutex;
+    std::condition_variable exporterWake;
+    bool stopping;
+
+    Metrics();
+    void exportLoop();
+
+public:
+    static Metrics* getInstance();
+
+    void countMessageSent(bool isGroup) {
+        messagesSent[isGroup ? 1 : 0].fetch_add(1, std::memory_order_relaxed);
+    }
+    void countQuery(QueryType type) {
+        queries[type].fetch_add(1, std::memory_order_relaxed);
+    }
+    void countRefreshPoll(bool updated) {
+        refreshPolls.fetch_add(1, std::memory_order_relaxed);
+        if (updated) refreshUpdates.fetch_add(1, std::memory_order_relaxed);
+    }
+    void countFrame(size_t bytes, double micros) {
+        renderFrames.fetch_add(1, std::memory_order_relaxed);
+        renderBytes.fetch_add((long long)bytes, std::memory_order_relaxed);
+        renderMicros.fetch_add((long long)micros, std::memory_order_relaxed);
+    }
+
+    // 生成 Prometheus 文本格式的全部指标
+    std::string render();
+    // 写入临时文件后 rename，采集方不会读到写了一半的文件
+    bool writeFile(const std::string& path);
+
+    const MetricsOptions& getOptions() const { return options; }
+    void startExporter(const MetricsOptions& opts);
+    // 停止导出线程并删除指标文件，避免进程退出后留下过期的序列
+    void stopExporter();
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 等待结果
+enum NotifyResult {
+    NOTIFY_MESSAGE,         // 订阅的会话有新消息
+    NOTIFY_TIMEOUT,         // 超时，期间没有新消息
+    NOTIFY_CANCELLED        // 订阅已被取消
+};
+
+// 一条已提交消息的通知，携带足以直接显示的内容
+struct MessageNotice {
+    long long id;
+    std::string sender;
+    std::string receiver;
+    std::string content;
+    std::string timestamp;
+    bool isGroup;
+    bool complete;          // false 表示内容被截断，需要回数据库读取
+};
+
+// 进程内新消息通知：每个聊天窗口订阅一个会话，
+// 消息写入提交后只唤醒该会话的订阅者，没有新消息时订阅线程完全阻塞
+class MessageNotifier {
+public:
+    // 有新通知时在发布方线程、持有通知器锁的情况下调用，只应做唤醒之类的轻量操作
+    typedef std::function<void()> Listener;
+
+    struct Subscription {
+        std::string key;
+        std::string ignoreSender;   // 自己发送的消息已在本地回显，不唤醒
+        std::vector<MessageNotice> notices;
+        bool resync;                // 通知可能有遗漏，需要回数据库增量读取
+        bool cancelled;
+        std::condition_variable wake;
+        Listener listener;
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::list<Subscription> subscriptions;
+
+public:
+    // 私聊两个方向归为同一会话；群聊以群名区分
+    static std::string conversationKey(const std::string& user1, const std::string& user2, bool isGroup);
+    static std::string conversationKey(const MessageNotice& notice) {
+        return conversationKey(notice.sender, notice.receiver, notice.isGroup);
+    }
+
+    // 提供 listener 时由订阅方在自己的事件循环中调用 take() 取走通知，不必占用线程阻塞在 wait()
+    Subscription* subscribe(const std::string& key, const std::string& ignoreSender,
+                            Listener listener = Listener());
+    void unsubscribe(Subscription* sub);
+    void cancel(Subscription* sub);
+    bool hasSubscribers() const;
+
+    // 阻塞直到有新消息、被取消或超时；timeout 为 0 表示一直等待。
+    // 返回 NOTIFY_MESSAGE 时取走积累的通知，resync 为 true 时通知不完整
+    NotifyResult wait(Subscription* sub, std::chrono::milliseconds timeout,
+                      std::vector<MessageNotice>& notices, bool& resync);
+    // 不阻塞地取走积累的通知，没有时返回 false
+    bool take(Subscription* sub, std::vector<MessageNotice>& notices, bool& resync);
+    void publish(const MessageNotice& notice);
+    // 通知来源丢失了消息（例如共享环被覆盖），唤醒全部订阅者回数据库读取
+    void publishResync();
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <sqlite3.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cache.h"
+
+// 预取的会话
+struct PrefetchTarget {
+    std::string user1;
+    std::string user2;      // 群聊时为群名
+    bool isGroup;
+    CacheStamp stamp;       // 提交时在主连接的线程上取的缓存标记，预取线程不访问主连接
+};
+
+// 后台预取：用户浏览最近聊天列表时，在独立的只读连接和低优先级线程上
+// 提前读取最可能打开的几个会话，写入会话缓存。新的请求覆盖尚未处理的旧请求
+class Prefetcher {
+public:
+    // 在预取线程上用只读连接加载一个会话
+    typedef std::function<void(sqlite3* conn, const PrefetchTarget& target)> Loader;
+
+private:
+    sqlite3* conn;
+    Loader loader;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<PrefetchTarget> queue;
+    bool stopping;
+
+    void run();
+
+public:
+    Prefetcher();
+    ~Prefetcher();
+
+    // 以只读方式打开同一数据库文件；内存数据库和临时数据库（空路径）每个连接各自独立，返回 false
+    bool start(const std::string& path, long long mmapSize, Loader loader);
+    void stop();
+    bool isRunning() const { return worker.joinable(); }
+
+    // 替换待预取的会话列表，按顺序处理
+    void submit(const std::vector<PrefetchTarget>& targets);
+};
+
+#endif
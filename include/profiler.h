@@ -0,0 +1,86 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <sqlite3.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 对数-线性分桶的延迟直方图（HDR 风格）：每个 2 的幂区间再细分 16 个子桶，
+// 相对误差约 6%，内存固定，记录为 O(1)
+class LatencyHistogram {
+private:
+    static const int kSubBucketBits = 4;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+
+    std::vector<unsigned long long> buckets;
+    unsigned long long total;
+    unsigned long long sum;
+    unsigned long long maxValue;
+
+    static int bucketIndex(unsigned long long value);
+    static unsigned long long bucketUpperBound(int index);
+
+public:
+    LatencyHistogram();
+
+    void record(unsigned long long micros);
+    // 累加另一个直方图（如各线程分别记录后汇总）
+    void merge(const LatencyHistogram& other);
+    unsigned long long percentile(double p) const;
+    unsigned long long count() const { return total; }
+    unsigned long long totalMicros() const { return sum; }
+    unsigned long long max() const { return maxValue; }
+};
+
+// 单条 SQL 语句的累计统计
+struct StatementStats {
+    std::string sql;
+    long long calls;
+    long long fullScanSteps;    // SQLITE_STMTSTATUS_FULLSCAN_STEP：全表扫描前进的行数
+    long long vmSteps;          // SQLITE_STMTSTATUS_VM_STEP：虚拟机指令数，近似总工作量
+    long long sorts;            // SQLITE_STMTSTATUS_SORT：排序次数
+    long long autoIndexRows;    // SQLITE_STMTSTATUS_AUTOINDEX：自动临时索引插入的行数
+    LatencyHistogram latency;
+
+    StatementStats();
+};
+
+// 基于 sqlite3_trace_v2 的语句级性能分析器：
+// 每条语句执行结束时记录耗时和 sqlite3_stmt_status 计数，超过阈值的写入慢查询日志。
+// SQLite 在 Unix 上提供的 PROFILE 耗时只有毫秒精度，因此在 TRACE_STMT 时自行打点计时
+class QueryProfiler {
+private:
+    typedef std::chrono::steady_clock Clock;
+    
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, StatementStats> stats;
+    std::unordered_map<sqlite3_stmt*, Clock::time_point> running;
+    std::string slowLogPath;
+    double slowThresholdMs;
+    std::ofstream slowLog;
+
+    static int traceCallback(unsigned type, void* context, void* p, void* x);
+    void start(sqlite3_stmt* stmt, const char* text);
+    void record(sqlite3_stmt* stmt, long long nanos);
+    void writeSlowLog(const char* sql, double ms, long long fullScanSteps, long long vmSteps);
+
+public:
+    QueryProfiler();
+
+    void attach(sqlite3* db);
+    void setSlowLog(const std::string& path, double thresholdMs);
+    double getSlowThresholdMs() const { return slowThresholdMs; }
+
+    // 按总耗时降序返回所有语句的统计快照
+    std::vector<StatementStats> snapshot() const;
+    void reset();
+    
+    // 去掉开头的注释行、压缩空白，maxBytes > 0 时按 UTF-8 字符边界截断
+    static std::string summarizeSql(const std::string& sql, size_t maxBytes = 0);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "message.h"
+
+// 客户端与 oicqd 之间的二进制协议。
+//
+// 帧:   varint(正文长度) 正文；正文首字节为操作码
+// 整数: 无符号 LEB128 varint；有符号数先 zigzag 再 varint
+// 文本: varint(字节数) 原始字节，不含结尾 '\0'
+//
+//   请求                                   响应
+//   PING                                   PONG
+//   REGISTER / LOGIN    用户名 密码          OK | ERR 原因
+//   FRIEND              用户名              OK | ERR 原因
+//   CREATE_GROUP / JOIN_GROUP  群名         OK | ERR 原因
+//   SEND       目标 是否群聊 内容            OK | ERR 原因
+//   HISTORY    目标 是否群聊 起始id          一个或多个 MESSAGES 帧 | ERR；起始 id 为 0 时返回最新一屏
+//   RECENT     条数 偏移                    CHATS | ERR
+//   WATCH      目标 是否群聊                 OK | ERR；之后该会话的新消息以 PUSH 帧异步推送
+//   UNWATCH                                OK
+//   QUIT                                   BYE，发送完毕后服务器关闭连接
+//
+// MESSAGES / PUSH 正文: 后续帧标志(u8) 然后若干条消息直到正文结束，每条为
+//   标志(u8: 群聊 / 发送者同上一条 / 接收者同上一条 / 时间为原文)
+//   id 差值 [发送者] [接收者] 时间差值（秒）或时间原文 内容
+// CHATS 正文: 是否还有下一页(u8) 然后若干条 标志(u8) 名称 时间差值或原文 最后消息
+// id 与时间均相对同一帧中的上一条（第一条相对 0）。PUSH 帧可能出现在任意两条响应之间
+namespace protocol {
+
+enum Opcode {
+    OP_PING = 0x01,
+    OP_REGISTER = 0x02,
+    OP_LOGIN = 0x03,
+    OP_FRIEND = 0x04,
+    OP_CREATE_GROUP = 0x05,
+    OP_JOIN_GROUP = 0x06,
+    OP_SEND = 0x07,
+    OP_HISTORY = 0x08,
+    OP_RECENT = 0x09,
+    OP_WATCH = 0x0A,
+    OP_UNWATCH = 0x0B,
+    OP_QUIT = 0x0C,
+
+    OP_OK = 0x80,
+    OP_ERR = 0x81,
+    OP_PONG = 0x82,
+    OP_BYE = 0x83,
+    OP_MESSAGES = 0x84,
+    OP_CHATS = 0x85,
+    OP_PUSH = 0x86
+};
+
+// 服务端接受的请求帧上限；响应帧由服务端按 kBatchBytes 切分，客户端接受的上限更宽
+static const size_t kMaxRequestBytes = 64 * 1024;
+static const size_t kMaxResponseBytes = 16 * 1024 * 1024;
+// MESSAGES 帧正文超过该大小后另起一帧
+static const size_t kBatchBytes = 256 * 1024;
+
+enum FrameStatus {
+    FRAME_OK,
+    FRAME_INCOMPLETE,       // 数据不足一帧，继续接收
+    FRAME_INVALID           // 长度前缀损坏或超过上限，应断开连接
+};
+
+inline TextView textOf(const std::string& s) {
+    TextView view;
+    view.data = s.data();
+    view.size = (int)s.size();
+    return view;
+}
+
+// 找出缓冲区开头的一帧：成功时 body 指向正文，frameSize 为整帧长度
+FrameStatus peekFrame(const char* data, size_t size, size_t maxBody,
+                      const char*& body, size_t& bodySize, size_t& frameSize);
+
+// 正文读取器：越界或格式错误后 ok() 为 false，此后的读取全部失败
+class Reader {
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+    bool valid;
+
+public:
+    Reader(const char* data, size_t size)
+        : p((const unsigned char*)data), end((const unsigned char*)data + size), valid(true) {}
+
+    bool readByte(uint8_t& value);
+    bool readVarint(uint64_t& value);
+    bool readSigned(int64_t& value);
+    // 视图指向原缓冲区，不复制
+    bool readText(TextView& value);
+    bool ok() const { return valid; }
+    bool atEnd() const { return p == end; }
+    bool fail() { valid = false; return false; }
+};
+
+// 请求的解码结果，文本字段均为指向接收缓冲区的视图
+struct Request {
+    Opcode op;
+    TextView text1;         // 用户名 / 目标 / 群名
+    TextView text2;         // 密码 / 内容
+    bool isGroup;
+    long long number1;      // 起始 id / 条数
+    long long number2;      // 偏移
+};
+
+void putVarint(std::string& out, uint64_t value);
+void putSigned(std::string& out, int64_t value);
+void putText(std::string& out, const char* data, size_t size);
+
+// 帧的写入：先占位长度前缀，正文写完后回填
+size_t beginFrame(std::string& out, Opcode op);
+void endFrame(std::string& out, size_t start);
+
+void encodeRequest(std::string& out, const Request& request);
+// 解码一帧正文；未知操作码、字段缺失或有多余字节时返回 false
+bool decodeRequest(const char* body, size_t size, Request& request);
+// OK / PONG / BYE 之类不带字段的响应
+void encodeStatus(std::string& out, Opcode op);
+void encodeError(std::string& out, const std::string& reason);
+
+// "YYYY-MM-DD HH:MM:SS"（UTC）与秒数互转，格式不符时返回 false
+bool parseTimestamp(const char* text, size_t size, long long& seconds);
+// 写入 20 字节（含 '\0'）的缓冲区
+void formatTimestamp(long long seconds, char* out);
+
+// 消息批次的一条，文本为指向帧正文的视图；时间按原文传输时 rawTime.data 非空，否则看 time
+struct WireMessage {
+    long long id;
+    TextView sender;
+    TextView receiver;
+    TextView content;
+    long long time;
+    TextView rawTime;
+    bool isGroup;
+};
+
+// 逐条写入 MESSAGES / PUSH 帧。上一条的发送者和接收者以在 out 中的偏移记录，
+// 相同时只写标志位，不复制字符串
+class MessageBatchWriter {
+private:
+    std::string& out;
+    size_t start;
+    size_t moreOffset;
+    long long lastId;
+    long long lastTime;
+    size_t senderOffset, senderSize;
+    size_t receiverOffset, receiverSize;
+    bool hasLast;
+
+public:
+    MessageBatchWriter(std::string& out, Opcode op);
+    void add(const MessageView& msg);
+    size_t bodySize() const { return out.size() - start; }
+    // 写完正文；more 表示同一请求还有后续 MESSAGES 帧
+    void finish(bool more);
+};
+
+class MessageBatchReader {
+private:
+    Reader reader;
+    WireMessage last;
+    long long lastTime;
+    bool hasLast;
+    bool more;
+
+public:
+    // body 为 MESSAGES / PUSH 帧的正文（不含操作码）
+    MessageBatchReader(const char* body, size_t size);
+    bool hasMore() const { return more; }
+    // 没有更多消息或格式错误时返回 false，区分两者看 ok()
+    bool next(WireMessage& msg);
+    bool ok() const { return reader.ok(); }
+};
+
+// 最近聊天列表的一条
+struct WireChat {
+    TextView name;
+    TextView lastMessage;
+    long long time;
+    TextView rawTime;
+    bool isGroup;
+};
+
+class ChatBatchWriter {
+private:
+    std::string& out;
+    size_t start;
+    long long lastTime;
+
+public:
+    ChatBatchWriter(std::string& out, bool hasMore);
+    void add(const TextView& name, bool isGroup, const TextView& lastTime, const TextView& lastMessage);
+    void finish();
+};
+
+class ChatBatchReader {
+private:
+    Reader reader;
+    long long lastTime;
+    bool more;
+
+public:
+    ChatBatchReader(const char* body, size_t size);
+    bool hasMore() const { return more; }
+    bool next(WireChat& chat);
+    bool ok() const { return reader.ok(); }
+};
+
+// 把视图拷贝为 Message，按需还原时间文本
+Message toMessage(const WireMessage& msg);
+std::string timeText(long long time, const TextView& rawTime);
+
+}  // namespace protocol
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 单线程事件循环：标准输入的每一行、其它线程发来的事件和定时器都在调用 run() 的线程上分发，
+// 回调之间天然串行，不需要加锁。POSIX 上用 poll() 同时等待标准输入和唤醒描述符
+// （Linux 为 eventfd，其它平台为非阻塞管道）；Windows 控制台不能 poll，由读行线程逐行交给事件循环
+class Reactor {
+public:
+    typedef std::function<void()> Task;
+    typedef std::function<void(const std::string&)> LineHandler;
+
+private:
+    struct Timer {
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point due;
+        Task task;
+    };
+
+    std::mutex mutex;                   // 保护 pending 以及 Windows 上的输入交接
+    std::vector<Task> events;
+    std::vector<bool> pending;
+    std::vector<Timer> timers;
+    LineHandler onLine;
+    Task onEof;
+    std::string inputBuffer;
+    bool inputOpen;
+    bool running;
+    int wakeRead;                       // eventfd 时读写两端是同一个描述符
+    int wakeWrite;
+#ifdef _WIN32
+    std::condition_variable wakeup;
+    bool woken;
+    std::thread inputThread;
+    std::vector<std::string> lines;
+    bool inputEof;
+    bool lineHandled;                   // 读行线程交出的行已处理完
+    void readLines();
+#endif
+
+    void notifyLoop();
+    void drainWakeup();
+    void dispatchEvents();
+    void readInput();
+    void runTimers();
+    int nextTimeout() const;
+
+public:
+    Reactor();
+    ~Reactor();
+
+    // 注册一个跨线程事件，返回供 signal() 使用的编号；需在 run() 之前注册
+    int addEvent(Task handler);
+    // 线程安全：标记事件待处理并唤醒事件循环，处理前多次触发只执行一次
+    void signal(int event);
+    // 每隔 interval 毫秒在事件循环线程中执行一次
+    void addTimer(int intervalMs, Task task);
+    // 标准输入每读到一整行回调一次（不含换行符），输入结束时回调 eofHandler
+    void watchInput(LineHandler lineHandler, Task eofHandler);
+
+    // 阻塞分发事件直到某个回调调用 stop()
+    void run();
+    void stop() { running = false; }
+};
+
+#endif
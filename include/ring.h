@@ -0,0 +1,65 @@
+#ifndef RING_H
+#define RING_H
+
+#include <string>
+#include <vector>
+#include "notifier.h"
+
+// /dev/shm 中的多生产者消息通知环：同一主机上的 oicq 进程写入消息后追加一条通知，
+// 各进程从自己的游标处读取，不必访问 SQLite 就能显示新消息。SQLite 仍是唯一的持久数据源，
+// 环被覆盖或内容放不下时，读取方退回数据库增量读取。
+//
+// 写入方用 fetch_add 领取序号，槽位用序号做版本（奇数写入中，偶数已完成），全程无锁；
+// 读取方比较前后两次版本判断是否读到被覆盖的数据。等待通过共享 futex 字，仅 Linux 支持。
+// 段只属于当前用户且权限不宽于数据库文件，最后一个附加的进程关闭时删除
+// （异常退出的进程不会减少附加计数，段会留到下次全部正常关闭）。
+class SharedRing {
+public:
+    static const unsigned int kCapacity = 4096;
+    // 写入方领取序号后超过该时间仍未写完，视为写入进程已退出
+    static const int kStalledSlotMs = 500;
+
+private:
+    struct Header;
+    struct Slot;
+
+    Header* header;
+    Slot* slots;
+    size_t mappedSize;
+    int pid;
+    int fd;                             // 保持打开，附加和分离时对它加 flock
+    std::string name;
+    // 读取方正在等待的未完成槽位，只由 read() 的调用线程使用
+    bool stalled;
+    unsigned long long stalledCursor;
+    long long stalledSinceMs;
+
+    // 该槽位已等待超过 kStalledSlotMs 时返回 true
+    bool stallExpired(unsigned long long cursor);
+
+public:
+    SharedRing();
+    ~SharedRing();
+
+    // 按数据库文件的绝对路径创建或附加同名共享段，不支持或失败时返回 false
+    bool open(const std::string& dbPath);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    void publish(const MessageNotice& notice);
+
+    // 读取 cursor 之后已完成的通知并前移游标；跳过本进程写入的通知。
+    // 通知被覆盖、无法完整放入环或写入方中途退出时 lost 为 true
+    void read(unsigned long long& cursor, std::vector<MessageNotice>& notices, bool& lost);
+    // 上次 read() 停在一个未写完的槽位上，调用方应在 kStalledSlotMs 内再读一次
+    bool isStalled() const { return stalled; }
+    unsigned long long head() const;
+
+    // 读取前取得的唤醒字；wait 在唤醒字变化前阻塞，timeoutMs 为 0 表示一直等待
+    unsigned int wakeWord() const;
+    void wait(unsigned int word, int timeoutMs);
+    // 唤醒所有等待者（用于停止本进程的读取线程，其它进程只会多读一次空）
+    void wakeAll();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profiler.h"
+
+// 工作窃取线程池：每个工作线程有自己的任务队列，没有全局队列锁。
+// 工作线程提交的任务放进自己的队列尾部并从尾部取（后进先出，数据还在缓存里）；
+// 自己的队列空了再从其它队列头部窃取最早的任务。
+// 亲和提示把同一个 key（如连接）的任务放进固定的队列，该线程空闲时总是由它执行，
+// 忙时才被其它线程窃取；pinCores 时工作线程 i 绑定到第 i 个 CPU，队列即对应核心。
+// 任务之间不保证执行顺序，需要顺序的调用方自行串联
+class Scheduler {
+public:
+    typedef std::function<void()> Task;
+    static const int kNoAffinity = -1;
+
+    // 任务延迟统计：排队为提交到开始执行，运行为执行耗时，单位微秒
+    struct Stats {
+        unsigned long long tasks;
+        unsigned long long stolen;          // 被其它工作线程从所在队列窃取后执行
+        unsigned long long helped;          // 由等待 TaskGroup 的非工作线程执行
+        unsigned long long affinityHits;    // 带亲和提示且在指定线程上执行
+        unsigned long long affinityTasks;
+        unsigned long long queueP50, queueP99, queueMax;
+        unsigned long long runP50, runP99, runMax;
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Item {
+        Task task;
+        Clock::time_point queuedAt;
+        int queue;                          // 放入的队列
+        bool hinted;                        // 由亲和提示指定
+    };
+
+    // 每个工作线程一份，分开加锁；统计只由执行线程写入，stats() 读取时加锁
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Item> tasks;
+        std::thread thread;
+        std::mutex statsMutex;
+        LatencyHistogram queueLatency;
+        LatencyHistogram runLatency;
+        unsigned long long stolen;
+        unsigned long long affinityHits;
+        unsigned long long affinityTasks;
+
+        Worker() : stolen(0), affinityHits(0), affinityTasks(0) {}
+    };
+
+    std::vector<std::unique_ptr<Worker> > workers;
+    Worker helper;                          // 非工作线程执行的任务记在这里
+    std::atomic<long long> queued;          // 所有队列中的任务数
+    std::atomic<int> sleepers;
+    std::atomic<unsigned> nextWorker;       // 无亲和提示的外部任务轮流分配
+    std::mutex idleMutex;
+    std::condition_variable idleWake;
+    std::atomic<bool> stopping;
+
+    void run(int index, bool pinCore);
+    // 依次尝试 self 的队列尾部和其它队列头部；self 为 -1 时只窃取
+    bool take(int self, Item& item);
+    void execute(Worker& stats, int self, Item& item);
+
+public:
+    Scheduler();
+    ~Scheduler();
+
+    // workers <= 0 时取 CPU 核数
+    bool start(int workers, bool pinCores = false);
+    // 执行完已提交的任务后退出
+    void stop();
+    bool isRunning() const { return !workers.empty(); }
+    int workerCount() const { return (int)workers.size(); }
+
+    // 提交任务；affinity 为非负时放进第 affinity % workerCount() 个线程的队列。
+    // 没有工作线程时在调用线程上直接执行
+    void submit(Task task, int affinity = kNoAffinity);
+    // 取出一个任务在调用线程上执行，没有任务时返回 false；供等待方帮忙
+    bool runPending();
+
+    Stats stats();
+    void resetStats();
+};
+
+// 一组任务的完成计数：wait() 期间调用线程也执行队列中的任务，而不是空等
+class TaskGroup {
+private:
+    Scheduler& scheduler;
+    std::atomic<int> pending;
+    std::mutex mutex;
+    std::condition_variable done;
+
+public:
+    explicit TaskGroup(Scheduler& scheduler);
+    ~TaskGroup();
+
+    void run(Scheduler::Task task, int affinity = Scheduler::kNoAffinity);
+    void wait();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "notifier.h"
+#include "protocol.h"
+#include "scheduler.h"
+#include "uring.h"
+
+// oicqd 监听参数
+struct ServerOptions {
+    std::string host;           // TCP 监听地址，空串表示不监听 TCP
+    int port;                   // 0 表示由系统分配（测试用），实际端口见 ChatServer::tcpPort()
+    std::string unixPath;       // Unix 域套接字路径，空串表示不监听
+    int maxClients;             // 同时在线连接上限，超过时新连接直接关闭
+    std::string ioBackend;      // "epoll" 或 "io_uring"；io_uring 不可用时退回 epoll
+    std::string messageLogPath; // 追加写入每条发出消息的日志文件，空串不写
+    int workers;                // 编码推送帧的工作线程数，0 表示都在事件循环线程上完成
+
+    ServerOptions();
+    // 读取 OICQ_SERVER_HOST / OICQ_SERVER_PORT / OICQ_SERVER_SOCKET / OICQ_SERVER_MAX_CLIENTS /
+    // OICQ_SERVER_IO / OICQ_SERVER_MESSAGE_LOG / OICQ_SERVER_WORKERS
+    static ServerOptions fromEnvironment();
+};
+
+// 单线程 epoll 聊天服务：所有连接的非阻塞读写、请求处理和新消息推送都在调用 run() 的线程上完成，
+// Database 单例只在这个线程上使用。订阅的会话有新消息时，通知器在发布方线程把连接记入就绪表并写 eventfd，
+// 事件循环醒来后只处理就绪的连接。协议见 protocol.h。仅 Linux 支持，其它平台 start() 返回 false。
+//
+// 选择 io_uring 时，accept、套接字收发、eventfd 唤醒、定时检查和消息日志写入都作为异步请求放入同一个环，
+// 一轮循环产生的请求由一次 io_uring_enter 提交并等待完成；接收缓冲区和日志缓冲区注册为固定缓冲区。
+//
+// 配置了工作线程时，一次唤醒要推送大量连接（如大群里很多人开着窗口）的 PUSH 帧编码分给工作窃取线程池，
+// 以连接描述符为亲和提示；数据库访问和收发仍在事件循环线程上
+class ChatServer {
+private:
+    struct Session {
+        int fd;
+        std::string input;              // 尚未凑成整帧的输入
+        std::string output;             // 尚未写出的响应
+        size_t outputSent;              // output 中已写出的字节数
+        std::string username;           // 登录后非空
+        MessageNotifier::Subscription* sub;
+        std::string watchTarget;
+        bool watchGroup;
+        long long lastPushedId;         // 已推送的最大消息 id，通知不完整时从这里增量读取
+        bool writable;                  // 是否已注册 EPOLLOUT
+        bool closing;                   // QUIT 之后写完即关闭
+
+        // 以下仅 io_uring 使用
+        char* recvBuffer;               // 固定缓冲区中的一段，或不够分时单独分配
+        int recvSlot;                   // 固定缓冲区槽位，-1 表示单独分配
+        std::string sendStage;          // 发送中的数据副本，output 可以在发送期间继续追加
+        bool reading;                   // 有未完成的读请求
+        bool sending;                   // 有未完成的发送请求
+        bool closed;                    // 已关闭，等未完成的请求返回后释放
+    };
+
+    // 一个连接本次唤醒的推送：通知在事件循环线程取出，encodePush() 可在工作线程上执行
+    struct PushJob {
+        Session* session;
+        std::vector<MessageNotice> notices;
+        bool resync;
+        size_t before;                  // 编码前 output 的长度，没有可推送的消息时回退
+        int added;
+        std::unique_ptr<protocol::MessageBatchWriter> batch;
+    };
+
+    ServerOptions options;
+    Scheduler pool;
+    int epollFd;
+    int wakeFd;                         // eventfd：推送就绪、数据库变化与 stop() 共用
+    int tcpFd;
+    int unixFd;
+    int boundPort;
+    std::atomic<bool> stopping;
+    std::atomic<bool> externalChanged;  // 文件监视线程发现数据库变化，待事件循环检查
+    std::unordered_map<int, Session*> sessions;
+    std::mutex readyMutex;
+    std::vector<int> readyFds;          // 有待推送通知的连接，由通知器线程写入
+    int logFd;
+    std::string logPending;             // 本轮循环追加的日志行，循环末尾一次写出
+    long long requestsHandled;
+    long long syscalls;                 // io_uring_enter 以外的收发、等待、accept 与日志写入调用
+
+    bool useUring;
+    IoUring ring;
+    std::vector<char> fixedArena;       // 日志缓冲区 + 每个连接一段接收缓冲区
+    std::vector<int> freeSlots;
+    std::vector<Session*> retired;      // 已关闭但仍有请求未返回的连接
+    size_t logInFlight;                 // 日志缓冲区中正在写入的字节数
+    size_t logWritten;
+    bool logWriting;
+    bool timerArmed;
+
+    bool listenTcp();
+    bool listenUnix();
+    Session* newSession(int fd);
+    void acceptClients(int listenFd);
+    void readSession(Session* session);
+    // 解析并处理输入中的整帧；帧损坏时关闭连接并返回 false
+    bool processInput(Session* session);
+    // 尽量写出 output；连接因此关闭时返回 false
+    bool flushSession(Session* session);
+    void closeSession(Session* session);
+    void appendMessageLog(const std::string& sender, const std::string& target, bool isGroup,
+                          const TextView& content);
+    void flushMessageLog();
+    void handleFrame(Session* session, const char* body, size_t size);
+    void handleRequest(Session* session, const protocol::Request& request);
+    void watch(Session* session, const std::string& target, bool isGroup);
+    void unwatch(Session* session);
+    void deliverPushes();
+    static void encodePush(PushJob& job);
+    bool canChat(const Session* session, const std::string& target, bool isGroup);
+
+    bool startUring();
+    void runUring();
+    void queueRecv(Session* session);
+    bool flushUring(Session* session);
+    void closeUring(Session* session);
+    void releaseIfIdle(Session* session);
+    void onUringCompletion(const IoUring::Completion& completion);
+
+public:
+    ChatServer();
+    ~ChatServer();
+
+    bool start(const ServerOptions& opts);
+    int tcpPort() const { return boundPort; }
+    // 阻塞处理连接直到 stop()
+    void run();
+    // 线程安全，只写原子变量和 eventfd，可在信号处理函数中调用
+    void stop();
+    size_t sessionCount() const { return sessions.size(); }
+    // 实际使用的 I/O 后端
+    const char* ioBackend() const { return useUring ? "io_uring" : "epoll"; }
+    // io_uring 注册为固定缓冲区的字节数，epoll 时为 0
+    size_t fixedBufferBytes() const { return ring.registeredBytes(); }
+    long long requestCount() const { return requestsHandled; }
+    // 推送编码线程池的任务延迟统计，未配置工作线程时 tasks 为 0
+    Scheduler::Stats workerStats() { return pool.stats(); }
+    // 收发、accept、等待事件和日志写入所用的系统调用次数，io_uring 时主要是 io_uring_enter
+    long long ioSyscallCount() const { return syscalls + (long long)ring.enterCount(); }
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "coroutine.h"
+#include "database.h"
+#include "message.h"
+#include "protocol.h"
+
+// 跑在 SessionLoop 上的非阻塞 oicqd 会话，会话逻辑写成无栈协程：子类在 resume() 中发出请求后
+// CO_AWAIT(co, replyReady()) 等待应答（服务端读库的结果），CO_AWAIT(co, pushReady()) 等待新消息推送，
+// sleepUntil() 之后 CO_AWAIT(co, timerDue()) 等待定时。挂起时让出事件循环线程，
+// 每个会话只占对象本身和收发缓冲区，没有自己的线程和栈。
+// 同一时刻只有一个未完成的请求；连接断开后 isFailed() 为 true，所有等待条件立即成立
+class AsyncSession {
+    friend class SessionLoop;
+
+public:
+    // 最近一次请求的应答
+    struct Reply {
+        int op;                                     // OP_OK / OP_ERR / OP_MESSAGES ...，尚未收到时为 0
+        std::string error;                          // OP_ERR 的原因
+        std::vector<Message> messages;              // HISTORY 的全部批次
+        std::vector<Database::RecentChat> chats;    // RECENT 的本页
+        bool hasMore;
+    };
+
+private:
+    int fd;
+    std::string input;              // 尚未凑成整帧的输入
+    std::string output;
+    size_t outputSent;
+    bool writable;                  // 是否已注册 EPOLLOUT
+    bool awaiting;                  // 有未完成的请求
+    bool failed;
+    double wakeAt;                  // 定时唤醒时刻（微秒，steady_clock），0 表示没有
+    double queuedWake;              // 已放入定时队列的时刻
+
+    void handleFrame(const char* body, size_t size);
+    void fail();
+
+protected:
+    Coroutine co;
+    Reply reply;
+    std::deque<Message> pushes;
+
+    // 协程体；每次有应答、推送、定时到期或连接断开时由事件循环调用
+    virtual void resume() = 0;
+
+    // 编码请求放入发送缓冲区，本轮 resume() 返回后写出
+    void request(protocol::Opcode op, const std::string& text1 = std::string(),
+                 const std::string& text2 = std::string(), bool isGroup = false,
+                 long long number1 = 0, long long number2 = 0);
+    bool replyReady() const { return !awaiting || failed; }
+    // 应答为 OK / PONG / BYE / MESSAGES / CHATS
+    bool replyOk() const;
+    bool pushReady() const { return !pushes.empty() || failed; }
+    void sleepUntil(double micros) { wakeAt = micros; }
+    bool timerDue() const;
+    bool isFailed() const { return failed; }
+
+public:
+    AsyncSession();
+    virtual ~AsyncSession();
+
+    bool isDone() const { return co.isDone(); }
+    static double nowMicros();
+};
+
+// 协程会话的事件循环：一个线程上用 epoll 驱动任意多个 AsyncSession。
+// 会话由调用方持有，只在调用 run() 的线程上使用。仅 Linux 支持，其它平台 start() 返回 false
+class SessionLoop {
+private:
+    typedef std::pair<double, AsyncSession*> TimerEntry;
+
+    int epollFd;
+    size_t active;
+    // 最早到期的在队首；会话改了定时后旧的条目在出队时丢弃
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry> > timers;
+
+    void step(AsyncSession* session);
+    // 尽量写出发送缓冲区；连接因此断开时返回 false
+    bool flush(AsyncSession* session);
+    void readFrom(AsyncSession* session);
+    void finish(AsyncSession* session);
+
+public:
+    SessionLoop();
+    ~SessionLoop();
+
+    bool start();
+    // 连接 oicqd（"地址:端口" 或含 '/' 的 Unix 套接字路径）并立即执行协程到第一个挂起点；
+    // 连接失败时返回 false，会话不加入循环
+    bool add(AsyncSession* session, const std::string& address);
+    // 运行直到所有会话的协程结束；连接断开的会话再被调用一次 resume() 后即视为结束
+    void run();
+    size_t activeCount() const { return active; }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 单帧渲染统计
+struct FrameStats {
+    double micros;          // 生成差异并写出的耗时
+    size_t bytes;           // 写入终端的字节数
+    int rowsWritten;        // 重写的行数
+};
+
+// 差异化终端渲染：保存上一帧的后备缓冲，新帧逐行比较，
+// 只用 ANSI 转义序列重写变化或新增的行，整帧拼成一次 write()。
+// 帧的最后一行是输入提示行，渲染后光标停在其末尾；帧高度不超过终端行数减一，
+// 用户回车时终端不会滚动，后备缓冲与屏幕保持一致
+class Terminal {
+private:
+    static Terminal* instance;
+
+    std::mutex mutex;
+    std::vector<std::string> screen;    // 屏幕上每一行的内容（按终端宽度折行后）
+    int rows;
+    int cols;
+    bool ansi;                          // 终端支持 ANSI 转义序列
+    FrameStats last;
+
+    Terminal();
+    void querySize(int& rows, int& cols);
+    void writeOut(const std::string& data);
+    void clearLocked();
+
+public:
+    static Terminal* getInstance();
+
+    // 清屏并清空后备缓冲，取代 system("clear")
+    void clear();
+    // 渲染一帧：折行、取最后一屏，与上一帧比较后写出差异
+    void render(const std::vector<std::string>& lines);
+    // 用户在提示行输入并回车后，终端回显改变了提示行及其下一行，下次渲染时重写
+    void inputEchoed();
+    FrameStats lastFrame();
+
+    // 终端显示宽度（CJK 等宽字符计 2 列）
+    static int displayWidth(const std::string& text);
+    // 按显示宽度折行，不拆开 UTF-8 字符
+    static void wrapLine(const std::string& line, int width, std::vector<std::string>& out);
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TIMEFMT_H
+#define TIMEFMT_H
+
+#include <cstddef>
+#include <ctime>
+
+// 消息时间显示：把 "YYYY-MM-DD HH:MM:SS" 格式化为当天/非当天两种样式。
+// “今天”的日期串缓存到下一个本地零点，每行只比较日期前缀并按字节拷贝，
+// 结果写入调用方的缓冲区，不分配堆内存
+class TimeFormatter {
+public:
+    static const size_t kBufferSize = 32;   // 足够容纳任一输出及结尾的 '\0'
+
+private:
+    char today[10];             // 本地日期 "YYYY-MM-DD"
+    std::time_t dayStart;       // 今天零点
+    std::time_t nextMidnight;   // 明天零点，之前都无需重新计算
+
+    void recompute(std::time_t now);
+    static size_t copyRaw(const char* timestamp, size_t len, char* out);
+
+public:
+    TimeFormatter();
+
+    // 每批渲染开始时调用一次：跨过零点（或系统时间回拨）时重新计算今天的日期
+    void refresh() { refresh(std::time(NULL)); }
+    void refresh(std::time_t now) {
+        if (now >= nextMidnight || now < dayStart) recompute(now);
+    }
+
+    // 聊天记录：今天 "HH:MM:SS"，其它日期 "MM-DD HH:MM:SS"；返回写入的字节数（不含 '\0'）
+    size_t formatMessageTime(const char* timestamp, size_t len, char* out) const;
+    // 最近聊天列表：今天 "今天 HH:MM"，其它日期 "MM-DD HH:MM"
+    size_t formatListTime(const char* timestamp, size_t len, char* out) const;
+};
+
+#endif
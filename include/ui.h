@@ -28,15 +28,18 @@ public:
     void handleLogin();
     void handleRegister();
     void handleDeleteUser();
+    void handleSqlStats();
     
     // 聊天操作界面
     void handleAddFriend();
     void handleCreateGroup();
     void handleJoinGroup();
     void handleRemoveFromGroup();
+    void handleBulkMembership(bool join);   // true 为批量邀请，false 为批量移除
     void handleChatList();
     void handlePrivateChat();
     void handleGroupChat();
+    void handleGroupMembers();
     
     // 输入处理
     std::string getInput(const std::string& prompt);
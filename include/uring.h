@@ -0,0 +1,81 @@
+#ifndef URING_H
+#define URING_H
+
+#include <cstddef>
+#include <cstdint>
+
+// io_uring 的最小封装：直接使用系统调用（不依赖 liburing），映射提交队列和完成队列。
+// prep*() 只把请求写入提交队列，submitAndWait() 一次 io_uring_enter 提交全部请求并等待完成，
+// 一轮事件循环的所有读写合并为一次系统调用。只在一个线程上使用。
+// 内核不支持（ENOSYS）、被禁用（EPERM，如容器的 seccomp 策略）或缺少所需特性时 init() 返回 false，
+// 非 Linux 平台总是返回 false
+class IoUring {
+public:
+    struct Completion {
+        uint64_t userData;
+        int result;             // 成功时为字节数 / 新描述符，失败时为 -errno
+    };
+
+private:
+    int ringFd;
+    void* sqRing;
+    void* cqRing;
+    void* sqes;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    void* cqes;
+    unsigned sqEntries;
+    unsigned localTail;         // 已写入但尚未发布给内核的 sqe
+    const char* fixedBase;
+    size_t fixedSize;
+    long long timeoutSpec[2];   // IORING_OP_TIMEOUT 的 __kernel_timespec，提交时由内核读取
+    unsigned long long enters;
+
+    void* nextSqe();
+    void publish();
+    bool isFixed(const void* data, size_t size) const;
+
+public:
+    IoUring();
+    ~IoUring();
+
+    // entries 为提交队列长度，完成队列为其两倍；内核在完成队列满时暂存溢出的完成事件
+    bool init(unsigned entries);
+    bool isReady() const { return ringFd >= 0; }
+    void close();
+
+    // 注册一块固定缓冲区：读写地址落在其中时改用 READ_FIXED / WRITE_FIXED，省去每次的页固定。
+    // 超出 RLIMIT_MEMLOCK 等原因失败时返回 false，此后的读写照常进行
+    bool registerBuffer(void* data, size_t size);
+
+    void prepAccept(int fd, uint64_t userData);
+    // offset 对套接字无意义；以 O_APPEND 打开的文件总是追加
+    void prepRead(int fd, void* data, unsigned size, uint64_t userData);
+    void prepWrite(int fd, const void* data, unsigned size, uint64_t userData);
+    // 套接字发送，带 MSG_NOSIGNAL（对端已关闭时 WRITE 会触发 SIGPIPE）
+    void prepSend(int fd, const void* data, unsigned size, uint64_t userData);
+    // 单次可读通知
+    void prepPollIn(int fd, uint64_t userData);
+    // ms 毫秒后以 -ETIME 完成；同一时刻只应有一个未完成的定时器
+    void prepTimeout(int ms, uint64_t userData);
+
+    // 提交排队的请求，并在没有已完成事件时至少等待一个；被信号打断时返回 true
+    bool submitAndWait();
+    // 取出一个已完成事件，没有时返回 false
+    bool popCompletion(Completion& completion);
+
+    // 实际注册的固定缓冲区字节数
+    size_t registeredBytes() const { return fixedSize; }
+    // io_uring_enter 调用次数
+    unsigned long long enterCount() const { return enters; }
+};
+
+#endif
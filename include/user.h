@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include "database.h"
 
 class User {
 public:
@@ -27,6 +28,13 @@ public:
     bool createGroup(const std::string& groupName);
     bool joinGroup(const std::string& groupName);
     bool removeUserFromGroup(const std::string& targetUser, const std::string& groupName, const std::string& adminPassword);
+    // 群创建者或持有管理员密码者才能管理群成员
+    bool canManageGroup(const std::string& groupName, const std::string& adminPassword);
+    // 批量邀请/移出，权限不足或群不存在时返回 false，逐人结果见 results
+    bool addUsersToGroup(const std::vector<std::string>& targetUsers, const std::string& groupName,
+                         const std::string& adminPassword, std::vector<Database::MembershipResult>& results);
+    bool removeUsersFromGroup(const std::vector<std::string>& targetUsers, const std::string& groupName,
+                              const std::string& adminPassword, std::vector<Database::MembershipResult>& results);
     std::vector<std::string> getGroups();
 };
 
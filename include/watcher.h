@@ -0,0 +1,31 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <functional>
+#include <string>
+#include <thread>
+
+// 数据库文件变化监视：Linux 上用 inotify 监视数据库所在目录中的主文件和 -wal 文件，
+// 其它进程提交时回调 onChange；一批事件只回调一次。
+// 没有 inotify 的平台 start() 返回 false，由调用方退回定时检查
+class ChangeWatcher {
+private:
+    int inotifyFd;
+    int stopPipe[2];
+    std::thread thread;
+    std::string dbFile;
+    std::string walFile;
+    std::function<void()> onChange;
+
+    void run();
+
+public:
+    ChangeWatcher();
+    ~ChangeWatcher();
+
+    bool start(const std::string& dbPath, const std::function<void()>& callback);
+    void stop();
+    bool isActive() const { return thread.joinable(); }
+};
+
+#endif
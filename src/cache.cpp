@@ -0,0 +1,166 @@
+#include "cache.h"
+
+MessageCache::MessageCache() : window(50), maxBytes(0), totalBytes(0) {
+    stats.hits = 0;
+    stats.deltaHits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+    stats.prefetches = 0;
+    stats.prefetchHits = 0;
+    stats.entries = 0;
+    stats.bytes = 0;
+}
+
+void MessageCache::configure(size_t newWindow, long long newMaxBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    window = newWindow;
+    maxBytes = newMaxBytes;
+    for (auto& entry : entries) {
+        trim(entry);
+    }
+    evict();
+}
+
+long long MessageCache::messageBytes(const Message& msg) {
+    return (long long)(sizeof(Message) + msg.sender.size() + msg.receiver.size() +
+                       msg.content.size() + msg.timestamp.size());
+}
+
+void MessageCache::trim(Entry& entry) {
+    while (entry.messages.size() > window) {
+        long long size = messageBytes(entry.messages.front());
+        entry.bytes -= size;
+        totalBytes -= size;
+        entry.messages.pop_front();
+    }
+}
+
+void MessageCache::evict() {
+    // 从最久未使用的一端淘汰；单个会话超出预算时连同它自己一起淘汰
+    while (totalBytes > maxBytes && !entries.empty()) {
+        Entry& victim = entries.back();
+        totalBytes -= victim.bytes;
+        index.erase(victim.key);
+        entries.pop_back();
+        stats.evictions++;
+    }
+}
+
+CacheState MessageCache::lookup(const std::string& key, const CacheStamp& stamp, long long& maxId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        stats.misses++;
+        return CACHE_MISSING;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    maxId = found->second->maxId;
+    if (found->second->prefetched) {
+        found->second->prefetched = false;
+        stats.prefetchHits++;
+    }
+    if (found->second->stamp == stamp) {
+        stats.hits++;
+        return CACHE_FRESH;
+    }
+    // 其它连接的提交可能删除或改写了窗口中的消息，只有本连接的写入（只追加新消息）才能增量读取
+    if (found->second->stamp.dataVersion != stamp.dataVersion) {
+        stats.misses++;
+        return CACHE_MISSING;
+    }
+    stats.deltaHits++;
+    return CACHE_STALE;
+}
+
+void MessageCache::store(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp) {
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    storeLocked(key, messages, stamp);
+}
+
+void MessageCache::storePrefetched(const std::string& key, const std::vector<Message>& messages,
+                                   const CacheStamp& stamp) {
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index.count(key)) return;
+    storeLocked(key, messages, stamp);
+    auto found = index.find(key);
+    if (found != index.end()) found->second->prefetched = true;
+    stats.prefetches++;
+}
+
+bool MessageCache::contains(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.count(key) > 0;
+}
+
+void MessageCache::storeLocked(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp) {
+    auto found = index.find(key);
+    if (found != index.end()) {
+        totalBytes -= found->second->bytes;
+        entries.erase(found->second);
+        index.erase(found);
+    }
+
+    entries.emplace_front();
+    Entry& entry = entries.front();
+    entry.key = key;
+    entry.maxId = 0;
+    entry.bytes = 0;
+    entry.stamp = stamp;
+    entry.prefetched = false;
+    for (const auto& msg : messages) {
+        entry.messages.push_back(msg);
+        entry.bytes += messageBytes(msg);
+        if (msg.id > entry.maxId) entry.maxId = msg.id;
+    }
+    totalBytes += entry.bytes;
+    index[key] = entries.begin();
+    trim(entry);
+    evict();
+}
+
+void MessageCache::append(const std::string& key, const std::vector<Message>& messages, const CacheStamp& stamp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) return;
+
+    Entry& entry = *found->second;
+    entry.stamp = stamp;
+    for (const auto& msg : messages) {
+        if (msg.id <= entry.maxId) continue;
+        entry.messages.push_back(msg);
+        long long size = messageBytes(msg);
+        entry.bytes += size;
+        totalBytes += size;
+        entry.maxId = msg.id;
+    }
+    trim(entry);
+    evict();
+}
+
+bool MessageCache::visit(const std::string& key, const std::function<bool(const MessageView&)>& visitor) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) return false;
+
+    for (const auto& msg : found->second->messages) {
+        if (!visitor(viewOf(msg))) break;
+    }
+    return true;
+}
+
+void MessageCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    totalBytes = 0;
+}
+
+MessageCacheStats MessageCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    MessageCacheStats result = stats;
+    result.entries = (long long)entries.size();
+    result.bytes = totalBytes;
+    return result;
+}
@@ -1,10 +1,14 @@
 #include "chat.h"
 #include "database.h"
+#include "metrics.h"
+#include "reactor.h"
+#include "terminal.h"
 #include <iostream>
 #include <iomanip>
 #include <thread>
 #include <chrono>
-#include <limits>
+#include <cstdio>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <conio.h>
@@ -16,6 +20,22 @@
 
 Chat::Chat(const std::string& username) : currentUser(username) {}
 
+// 通知的借用视图，有效期同 notice
+static MessageView noticeView(const MessageNotice& notice) {
+    MessageView view;
+    view.id = (int)notice.id;
+    view.sender.data = notice.sender.data();
+    view.sender.size = (int)notice.sender.size();
+    view.receiver.data = notice.receiver.data();
+    view.receiver.size = (int)notice.receiver.size();
+    view.content.data = notice.content.data();
+    view.content.size = (int)notice.content.size();
+    view.timestamp.data = notice.timestamp.data();
+    view.timestamp.size = (int)notice.timestamp.size();
+    view.isGroup = notice.isGroup;
+    return view;
+}
+
 void Chat::showChatList() {
     Database* db = Database::getInstance();
     
@@ -39,7 +59,8 @@ void Chat::showChatList() {
         std::cout << "  暂未加入任何群组" << std::endl;
     } else {
         for (size_t i = 0; i < groups.size(); ++i) {
-            std::cout << "  " << (i + 1) << ". " << groups[i] << std::endl;
+            std::cout << "  " << (i + 1) << ". " << groups[i]
+                      << " (" << db->getGroupMemberCount(groups[i]) << " 人)" << std::endl;
         }
     }
     
@@ -47,50 +68,106 @@ void Chat::showChatList() {
 }
 
 void Chat::showRecentChats() {
-    Database* db = Database::getInstance();
     bool needRefresh = true;  // 标记是否需要刷新显示
+    int page = 0;
+    bool hasMore = false;
+    std::vector<Database::RecentChat> recentChats;  // 当前页，序号从 page * kRecentPageSize + 1 开始
     
     while (true) {
         // 需要刷新时显示聊天列表
         if (needRefresh) {
             clearScreen();
-            displayRecentChatsList();
+            recentChats = displayRecentChatsList(page, hasMore);
             needRefresh = false;
         }
         
-        std::cout << "输入序号进入聊天，输入0返回上级菜单: ";
+        std::cout << "输入序号进入聊天";
+        if (hasMore) std::cout << "，n 下一页";
+        if (page > 0) std::cout << "，p 上一页";
+        std::cout << "，输入0返回上级菜单: ";
         
-        int choice;
+        std::string input;
+        if (!(std::cin >> input)) {
+            break;
+        }
+        std::cin.ignore(); // 清除缓冲区
         
-        // 使用带超时的输入检查
-        if (std::cin >> choice) {
-            std::cin.ignore(); // 清除缓冲区
-            
-            if (choice == 0) {
-                break;
+        if (input == "n" || input == "p") {
+            if (input == "n" && hasMore) {
+                ++page;
+            } else if (input == "p" && page > 0) {
+                --page;
             } else {
-                std::vector<Database::RecentChat> recentChats = db->getRecentChats(currentUser);
-                if (choice > 0 && choice <= (int)recentChats.size()) {
-                    const auto& selectedChat = recentChats[choice - 1];
-                    
-                    // 进入选定的聊天
-                    interactiveChat(selectedChat.name, selectedChat.isGroup);
-                    
-                    // 聊天结束后需要刷新显示列表
-                    needRefresh = true;
-                } else {
-                    std::cout << "无效选择!" << std::endl;
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    needRefresh = true;
-                }
+                std::cout << "没有更多了!" << std::endl;
+                std::this_thread::sleep_for(std::chrono::seconds(1));
             }
-        } else {
-            // 输入错误处理
-            std::cin.clear();
-            std::cin.ignore((std::numeric_limits<std::streamsize>::max)(), '\n');
+            needRefresh = true;
+            continue;
+        }
+        
+        char* end = nullptr;
+        long choice = std::strtol(input.c_str(), &end, 10);
+        if (end == input.c_str() || *end != '\0') {
             std::cout << "无效输入，请输入数字!" << std::endl;
             std::this_thread::sleep_for(std::chrono::seconds(1));
             needRefresh = true;
+            continue;
+        }
+        
+        if (choice == 0) {
+            break;
+        }
+        
+        // 序号全局连续，只接受当前页上显示的
+        long index = choice - 1 - (long)page * kRecentPageSize;
+        if (index >= 0 && index < (long)recentChats.size()) {
+            const auto& selectedChat = recentChats[index];
+            
+            // 进入选定的聊天
+            interactiveChat(selectedChat.name, selectedChat.isGroup);
+        } else {
+            std::cout << "无效选择!" << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        // 聊天结束后列表顺序可能变化，停留在当前页重新读取
+        needRefresh = true;
+    }
+}
+
+void Chat::showGroupMembers(const std::string& groupName) {
+    Database* db = Database::getInstance();
+    // 每页起点（上一页最后一个用户名），用于返回上一页
+    std::vector<std::string> pageStarts(1, std::string());
+    
+    while (true) {
+        clearScreen();
+        long long total = db->getGroupMemberCount(groupName);
+        // 多取一人判断是否还有下一页
+        std::vector<std::string> members = db->getGroupMembers(groupName, pageStarts.back(), kMemberPageSize + 1);
+        bool hasMore = members.size() > (size_t)kMemberPageSize;
+        if (hasMore) members.pop_back();
+        
+        size_t first = (pageStarts.size() - 1) * kMemberPageSize;
+        std::cout << "\n========== 群成员: " << groupName << " (共 " << total << " 人) ==========" << std::endl;
+        if (members.empty()) {
+            std::cout << "  暂无成员" << std::endl;
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            std::cout << "  " << (first + i + 1) << ". " << members[i] << std::endl;
+        }
+        std::cout << "============================" << std::endl;
+        
+        std::cout << "输入";
+        if (hasMore) std::cout << " n 下一页，";
+        if (pageStarts.size() > 1) std::cout << " p 上一页，";
+        std::cout << " 0 返回: ";
+        
+        std::string input;
+        if (!std::getline(std::cin, input) || input == "0") break;
+        if (input == "n" && hasMore) {
+            pageStarts.push_back(members.back());
+        } else if (input == "p" && pageStarts.size() > 1) {
+            pageStarts.pop_back();
         }
     }
 }
@@ -100,63 +177,134 @@ void Chat::selectAndEnterChat() {
 }
 
 void Chat::interactiveChat(const std::string& target, bool isGroup) {
-    clearScreen();
-    std::cout << "\n========== " << (isGroup ? "群聊: " : "私聊: ") << target << " ==========" << std::endl;
-    std::cout << "自动刷新中... (每3秒更新)" << std::endl;
+    Database* db = Database::getInstance();
+    MessageNotifier& notifier = db->getNotifier();
+    Terminal* terminal = Terminal::getInstance();
+    bool renderStats = Metrics::getInstance()->getOptions().renderStats;
     
-    // 显示最近的聊天记录
-    showChatHistory(target, isGroup);
+    // 聊天窗口的内容：标题 + 消息行 + 输入提示，每次变化后整帧交给终端做差异渲染
+    static const size_t kMaxHistoryLines = 200;
+    std::vector<std::string> history;
+    bool hasMessages = false;
+    std::string title = std::string(isGroup ? "群聊: " : "私聊: ") + target;
+    if (isGroup) {
+        title += " (" + std::to_string(db->getGroupMemberCount(target)) + " 人)";
+    }
     
-    std::cout << "\n输入消息开始聊天 (输入 'exit' 退出):" << std::endl;
+    auto renderView = [&]() {
+        std::vector<std::string> frame;
+        frame.push_back("");
+        frame.push_back("========== " + title + " ==========");
+        std::string status = "新消息实时显示";
+        if (renderStats) {
+            FrameStats stats = terminal->lastFrame();
+            char buffer[80];
+            snprintf(buffer, sizeof(buffer), "   上一帧: %.0fus %zu字节 %d行", stats.micros, stats.bytes, stats.rowsWritten);
+            status += buffer;
+        }
+        frame.push_back(status);
+        frame.push_back("");
+        frame.push_back("聊天记录:");
+        if (!hasMessages) frame.push_back("暂无聊天记录");
+        frame.insert(frame.end(), history.begin(), history.end());
+        frame.push_back("");
+        frame.push_back("输入消息开始聊天 (输入 'exit' 退出):");
+        frame.push_back(currentUser + " >> ");
+        terminal->render(frame);
+    };
+    auto appendLine = [&](const std::string& line) {
+        hasMessages = true;
+        history.push_back(line);
+        if (history.size() > kMaxHistoryLines) {
+            history.erase(history.begin(), history.begin() + (history.size() - kMaxHistoryLines));
+        }
+    };
     
-    // 记录最后一条消息的时间戳，用于检查是否有新消息
-    std::string lastMessageTime = getLastMessageTime(target, isGroup);
+    // 输入、新消息和定时检查都在当前线程的事件循环中处理，界面状态无需加锁
+    Reactor reactor;
+    MessageNotifier::Subscription* sub = nullptr;
+    std::vector<MessageNotice> notices;
+    long long lastShownId = 0;
     
-    // 启动自动刷新线程
-    bool shouldExit = false;
-    std::thread refreshThread([&]() {
-        while (!shouldExit) {
-            std::this_thread::sleep_for(std::chrono::seconds(3));
-            if (!shouldExit) {
-                std::string currentLastTime = getLastMessageTime(target, isGroup);
-                if (currentLastTime != lastMessageTime && !currentLastTime.empty()) {
-                    // 有新消息，刷新显示
-                    lastMessageTime = currentLastTime;
-                    clearScreen();
-                    std::cout << "\n========== " << (isGroup ? "群聊: " : "私聊: ") << target << " ==========" << std::endl;
-                    std::cout << "自动刷新中... (每3秒更新)" << std::endl;
-                    showChatHistory(target, isGroup);
-                    std::cout << "\n" << currentUser << " >> ";
-                    std::cout.flush();
-                }
+    int messageEvent = reactor.addEvent([&]() {
+        bool resync = false;
+        if (!notifier.take(sub, notices, resync)) return;
+        timeFormatter.refresh();
+        
+        bool updated = false;
+        auto show = [&](const MessageView& msg) {
+            if (msg.id <= lastShownId) return true;  // 多个来源可能重复通知
+            lastShownId = msg.id;
+            if (msg.sender == currentUser) return true;  // 已在本地回显
+            updated = true;
+            appendLine(formatMessageLine(msg));
+            return true;
+        };
+        
+        // 通知携带完整内容时直接显示；有遗漏或内容被截断时才回数据库增量读取
+        for (const auto& notice : notices) {
+            if (!notice.complete) resync = true;
+        }
+        if (resync) {
+            db->visitMessagesSince(currentUser, target, isGroup, lastShownId, show);
+        } else {
+            for (const auto& notice : notices) {
+                show(noticeView(notice));
             }
         }
+        
+        Metrics::getInstance()->countRefreshPoll(updated);
+        if (updated) {
+            renderView();
+        }
     });
     
-    std::string message;
-    while (true) {
-        std::cout << currentUser << " >> ";
-        std::getline(std::cin, message);
-        
+    // 先订阅再读取记录，避免两者之间到达的消息被漏掉；
+    // 通知可能来自 update_hook、共享通知环或文件监视线程，它们只唤醒事件循环
+    sub = notifier.subscribe(MessageNotifier::conversationKey(currentUser, target, isGroup), currentUser,
+                             [&reactor, messageEvent]() { reactor.signal(messageEvent); });
+    
+    // 显示最近的聊天记录（重新进入会话时多半直接来自缓存）；
+    // 订阅之后读取，其中最大的 id 之后的消息都会收到通知
+    timeFormatter.refresh();
+    db->visitConversation(currentUser, target, isGroup, [&](const MessageView& msg) {
+        if (msg.id > lastShownId) lastShownId = msg.id;
+        appendLine(formatMessageLine(msg));
+        return true;
+    });
+    terminal->clear();
+    renderView();
+    
+    reactor.watchInput([&](const std::string& message) {
         if (message == "exit") {
-            shouldExit = true;
-            break;
-        } else if (!message.empty()) {
+            reactor.stop();
+            return;
+        }
+        terminal->inputEchoed();
+        if (!message.empty()) {
             if (sendMessage(target, message, isGroup)) {
                 // 发送后立即显示自己的消息
-                std::cout << "[" << getCurrentTime() << "] " << currentUser << ": " << message << std::endl;
-                // 更新最后消息时间
-                lastMessageTime = getCurrentTime();
+                appendLine("[" + formatMessageTime(getCurrentTime()) + "] " +
+                           (isGroup ? currentUser : std::string("我")) + ": " + message);
             } else {
-                std::cout << "消息发送失败" << std::endl;
+                appendLine("消息发送失败");
             }
         }
-    }
+        renderView();
+    }, [&]() { reactor.stop(); });
     
-    // 等待刷新线程结束
-    if (refreshThread.joinable()) {
-        refreshThread.join();
+    // 文件监视线程只唤醒事件循环，检查在本线程进行；
+    // 没有通知环和文件监视的平台每3秒检查一次 data_version，有变化时会发布通知
+    int changeEvent = reactor.addEvent([&]() { db->checkExternalChanges(); });
+    db->startChangeWatcher([&reactor, changeEvent]() { reactor.signal(changeEvent); });
+    if (!db->isWatchingChanges()) {
+        reactor.addTimer(3000, [&]() { db->checkExternalChanges(); });
     }
+    
+    reactor.run();
+    db->stopChangeWatcher();
+    // 退订后发布方不会再访问 reactor
+    notifier.unsubscribe(sub);
 }
 
 std::string Chat::getCurrentTime() {
@@ -169,19 +317,27 @@ std::string Chat::getCurrentTime() {
     return std::string(buffer);
 }
 
-void Chat::displayRecentChatsList() {
+std::vector<Database::RecentChat> Chat::displayRecentChatsList(int page, bool& hasMore) {
     Database* db = Database::getInstance();
-    std::vector<Database::RecentChat> recentChats = db->getRecentChats(currentUser);
+    int offset = page * kRecentPageSize;
+    std::vector<Database::RecentChat> recentChats = db->getRecentChats(currentUser, kRecentPageSize, offset, &hasMore);
     
     std::cout << "\n========== 最近聊天 (按时间排序) ==========" << std::endl;
+    if (page > 0 || hasMore) {
+        std::cout << "第 " << (page + 1) << " 页" << std::endl;
+    }
     
-    if (recentChats.empty()) {
+    if (recentChats.empty() && page == 0) {
         std::cout << "暂无聊天记录" << std::endl;
         std::cout << "提示: 可以添加好友或创建群聊开始聊天" << std::endl;
+    } else if (recentChats.empty()) {
+        std::cout << "本页没有聊天记录" << std::endl;
     } else {
         std::cout << "序号  类型    名称                最后消息                    时间" << std::endl;
         std::cout << "------------------------------------------------------------------------" << std::endl;
         
+        timeFormatter.refresh();
+        char timeText[TimeFormatter::kBufferSize];
         for (size_t i = 0; i < recentChats.size(); ++i) {
             const auto& chat = recentChats[i];
             
@@ -192,79 +348,50 @@ void Chat::displayRecentChatsList() {
             }
             
             // 格式化时间显示 - 显示月-日 时:分
-            std::string timeStr = formatTimeDisplay(chat.lastTime);
+            timeFormatter.formatListTime(chat.lastTime.data(), chat.lastTime.size(), timeText);
             
             printf("%-4zu  %-6s  %-18s  %-26s  %s\n", 
-                   i + 1,
+                   offset + i + 1,
                    chat.isGroup ? "[群聊]" : "[私聊]",
                    chat.name.c_str(),
                    shortMsg.c_str(),
-                   timeStr.c_str());
+                   timeText);
         }
     }
     
     std::cout << "========================================================================" << std::endl;
+    
+    // 用户多半会打开排在前面的会话，趁菜单等待输入时在后台读入缓存
+    std::vector<PrefetchTarget> targets;
+    for (const auto& chat : recentChats) {
+        PrefetchTarget target;
+        target.user1 = currentUser;
+        target.user2 = chat.name;
+        target.isGroup = chat.isGroup;
+        targets.push_back(target);
+    }
+    db->prefetchConversations(targets);
+    return recentChats;
 }
 
 std::string Chat::formatTimeDisplay(const std::string& timestamp) {
-    // 输入格式: "YYYY-MM-DD HH:MM:SS"
-    if (timestamp.length() >= 19) {
-        // 解析消息时间戳
-        std::string msgDate = timestamp.substr(0, 10); // YYYY-MM-DD
-        std::string todayDate = getCurrentTime().substr(0, 10); // 今天的日期
-        
-        std::string month = timestamp.substr(5, 2);
-        std::string day = timestamp.substr(8, 2);
-        std::string time = timestamp.substr(11, 5); // HH:MM
-        
-        if (msgDate == todayDate) {
-            // 今天的消息只显示时间
-            return "今天 " + time;
-        } else {
-            // 其他日期显示月-日 时:分
-            return month + "-" + day + " " + time;
-        }
-    }
-    return timestamp;
+    // 输入格式: "YYYY-MM-DD HH:MM:SS"，今天的消息只显示时间
+    char buffer[TimeFormatter::kBufferSize];
+    timeFormatter.refresh();
+    size_t len = timeFormatter.formatListTime(timestamp.data(), timestamp.size(), buffer);
+    return std::string(buffer, len);
 }
 
 std::string Chat::formatMessageTime(const std::string& timestamp) {
     // 用于聊天记录中的时间显示
-    if (timestamp.length() >= 19) {
-        // 获取当前日期
-        std::string msgDate = timestamp.substr(0, 10); // YYYY-MM-DD
-        std::string todayDate = getCurrentTime().substr(0, 10); // 今天的日期
-        
-        if (msgDate == todayDate) {
-            // 今天的消息只显示时间
-            return timestamp.substr(11, 8); // HH:MM:SS
-        } else {
-            // 其他日期显示完整格式
-            std::string month = timestamp.substr(5, 2);
-            std::string day = timestamp.substr(8, 2);
-            std::string time = timestamp.substr(11, 8);
-            return month + "-" + day + " " + time;
-        }
-    }
-    return timestamp;
-}
-
-std::string Chat::getLastMessageTime(const std::string& target, bool isGroup) {
-    Database* db = Database::getInstance();
-    std::vector<Message> messages = db->getMessages(currentUser, target, isGroup);
-    
-    if (!messages.empty()) {
-        return messages.back().timestamp;
-    }
-    return "";
+    char buffer[TimeFormatter::kBufferSize];
+    timeFormatter.refresh();
+    size_t len = timeFormatter.formatMessageTime(timestamp.data(), timestamp.size(), buffer);
+    return std::string(buffer, len);
 }
 
 void Chat::clearScreen() {
-#ifdef _WIN32
-    system("cls");
-#else
-    system("clear");
-#endif
+    Terminal::getInstance()->clear();
 }
 
 bool Chat::sendMessage(const std::string& receiver, const std::string& content, bool isGroup) {
@@ -274,20 +401,28 @@ bool Chat::sendMessage(const std::string& receiver, const std::string& content,
 
 void Chat::showChatHistory(const std::string& target, bool isGroup) {
     Database* db = Database::getInstance();
-    std::vector<Message> messages = db->getMessages(currentUser, target, isGroup);
+    bool hasMessages = false;
     
     std::cout << "\n聊天记录:" << std::endl;
-    if (messages.empty()) {
+    // 逐行流式输出，第一条记录无需等待整个结果集
+    timeFormatter.refresh();
+    db->visitConversation(currentUser, target, isGroup, [&](const MessageView& msg) {
+        hasMessages = true;
+        displayMessage(msg);
+        return true;
+    });
+    
+    if (!hasMessages) {
         std::cout << "暂无聊天记录" << std::endl;
-    } else {
-        displayMessages(messages);
     }
 }
 
 void Chat::displayMessages(const std::vector<Message>& messages) {
+    timeFormatter.refresh();
+    char timeStr[TimeFormatter::kBufferSize];
     for (const auto& msg : messages) {
         // 使用智能时间格式化
-        std::string timeStr = formatMessageTime(msg.timestamp);
+        timeFormatter.formatMessageTime(msg.timestamp.data(), msg.timestamp.size(), timeStr);
         
         if (msg.isGroup) {
             std::cout << "[" << timeStr << "] " << msg.sender << ": " << msg.content << std::endl;
@@ -299,4 +434,27 @@ void Chat::displayMessages(const std::vector<Message>& messages) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+std::string Chat::formatMessageLine(const MessageView& msg) {
+    char timeText[TimeFormatter::kBufferSize];
+    size_t timeLen = timeFormatter.formatMessageTime(msg.timestamp.data, (size_t)msg.timestamp.size, timeText);
+    
+    std::string line;
+    line.reserve(timeLen + msg.sender.size + msg.content.size + 8);
+    line += '[';
+    line.append(timeText, timeLen);
+    line += "] ";
+    if (!msg.isGroup && msg.sender == currentUser) {
+        line += "我";
+    } else {
+        line.append(msg.sender.data, msg.sender.size);
+    }
+    line += ": ";
+    line.append(msg.content.data, msg.content.size);
+    return line;
+}
+
+void Chat::displayMessage(const MessageView& msg) {
+    std::cout << formatMessageLine(msg) << std::endl;
+}
@@ -0,0 +1,344 @@
+#include "client.h"
+#include "protocol.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+ChatClient::ChatClient() : fd(-1), inputStart(0) {}
+
+ChatClient::~ChatClient() {
+    disconnect();
+}
+
+#ifndef _WIN32
+
+bool ChatClient::connectTcp(const std::string& host, int port) {
+    disconnect();
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        lastError = "无法解析地址: " + host;
+        return false;
+    }
+    for (struct addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        lastError = "无法连接服务器";
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return true;
+}
+
+bool ChatClient::connectUnix(const std::string& path) {
+    disconnect();
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        lastError = "套接字路径过长";
+        return false;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        disconnect();
+        lastError = "无法连接服务器";
+        return false;
+    }
+    return true;
+}
+
+void ChatClient::disconnect() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+    input.clear();
+    inputStart = 0;
+}
+
+bool ChatClient::sendRequest(const protocol::Request& request) {
+    if (fd < 0) {
+        lastError = "未连接";
+        return false;
+    }
+    std::string frame;
+    protocol::encodeRequest(frame, request);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            disconnect();
+            lastError = "连接已断开";
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool ChatClient::readFrame(const char*& body, size_t& size, int timeoutMs) {
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+
+    while (true) {
+        size_t frameSize;
+        protocol::FrameStatus status = protocol::peekFrame(input.data() + inputStart, input.size() - inputStart,
+                                                           protocol::kMaxResponseBytes, body, size, frameSize);
+        if (status == protocol::FRAME_OK) {
+            inputStart += frameSize;
+            return true;
+        }
+        if (status == protocol::FRAME_INVALID) {
+            disconnect();
+            lastError = "无法解析服务器应答";
+            return false;
+        }
+        if (fd < 0) {
+            lastError = "未连接";
+            return false;
+        }
+
+        int wait = -1;
+        if (timeoutMs >= 0) {
+            long long left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            wait = left > 0 ? (int)left : 0;
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        int ready = poll(&pfd, 1, wait);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) {
+            lastError = "等待超时";
+            return false;
+        }
+
+        // 之前交出的正文视图到这里才失效，此时再前移缓冲区
+        input.erase(0, inputStart);
+        inputStart = 0;
+        char buffer[16 * 1024];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            disconnect();
+            lastError = "服务器已关闭连接";
+            return false;
+        }
+        input.append(buffer, n);
+    }
+}
+
+#else
+
+bool ChatClient::connectTcp(const std::string&, int) {
+    lastError = "当前平台不支持";
+    return false;
+}
+
+bool ChatClient::connectUnix(const std::string&) {
+    lastError = "当前平台不支持";
+    return false;
+}
+
+void ChatClient::disconnect() {
+    fd = -1;
+    input.clear();
+    inputStart = 0;
+}
+
+bool ChatClient::sendRequest(const protocol::Request&) {
+    lastError = "未连接";
+    return false;
+}
+
+bool ChatClient::readFrame(const char*&, size_t&, int) {
+    lastError = "未连接";
+    return false;
+}
+
+#endif
+
+bool ChatClient::connect(const std::string& address) {
+    if (address.find('/') != std::string::npos) return connectUnix(address);
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return connectTcp("127.0.0.1", std::atoi(address.c_str()));
+    return connectTcp(address.substr(0, colon), std::atoi(address.c_str() + colon + 1));
+}
+
+int ChatClient::release() {
+    int released = fd;
+    fd = -1;
+    input.clear();
+    inputStart = 0;
+    return released;
+}
+
+static protocol::Request makeRequest(protocol::Opcode op, const std::string& text1 = std::string(),
+                                     const std::string& text2 = std::string(), bool isGroup = false,
+                                     long long number1 = 0, long long number2 = 0) {
+    protocol::Request request;
+    request.op = op;
+    request.text1 = protocol::textOf(text1);
+    request.text2 = protocol::textOf(text2);
+    request.isGroup = isGroup;
+    request.number1 = number1;
+    request.number2 = number2;
+    return request;
+}
+
+void ChatClient::queuePushes(const char* body, size_t size) {
+    protocol::MessageBatchReader batch(body + 1, size - 1);
+    protocol::WireMessage msg;
+    while (batch.next(msg)) pushes.push_back(protocol::toMessage(msg));
+}
+
+bool ChatClient::readReply(const char*& body, size_t& size) {
+    while (readFrame(body, size, -1)) {
+        if ((uint8_t)body[0] != protocol::OP_PUSH) return true;
+        queuePushes(body, size);
+    }
+    return false;
+}
+
+bool ChatClient::failWith(const char* body, size_t size) {
+    protocol::Reader reader(body + 1, size - 1);
+    TextView reason;
+    if ((uint8_t)body[0] == protocol::OP_ERR && reader.readText(reason)) lastError = reason.str();
+    else lastError = "意外的应答";
+    return false;
+}
+
+bool ChatClient::call(const protocol::Request& request) {
+    const char* body;
+    size_t size;
+    if (!sendRequest(request) || !readReply(body, size)) return false;
+    uint8_t op = (uint8_t)body[0];
+    if (op == protocol::OP_OK || op == protocol::OP_PONG || op == protocol::OP_BYE) return true;
+    return failWith(body, size);
+}
+
+bool ChatClient::ping() {
+    return call(makeRequest(protocol::OP_PING));
+}
+
+bool ChatClient::registerUser(const std::string& username, const std::string& password) {
+    return call(makeRequest(protocol::OP_REGISTER, username, password));
+}
+
+bool ChatClient::login(const std::string& username, const std::string& password) {
+    return call(makeRequest(protocol::OP_LOGIN, username, password));
+}
+
+bool ChatClient::addFriend(const std::string& username) {
+    return call(makeRequest(protocol::OP_FRIEND, username));
+}
+
+bool ChatClient::createGroup(const std::string& groupName) {
+    return call(makeRequest(protocol::OP_CREATE_GROUP, groupName));
+}
+
+bool ChatClient::joinGroup(const std::string& groupName) {
+    return call(makeRequest(protocol::OP_JOIN_GROUP, groupName));
+}
+
+bool ChatClient::send(const std::string& target, bool isGroup, const std::string& content) {
+    return call(makeRequest(protocol::OP_SEND, target, content, isGroup));
+}
+
+bool ChatClient::history(const std::string& target, bool isGroup, long long afterId,
+                         std::vector<Message>& messages) {
+    if (!sendRequest(makeRequest(protocol::OP_HISTORY, target, std::string(), isGroup, afterId))) return false;
+    messages.clear();
+    const char* body;
+    size_t size;
+    while (readReply(body, size)) {
+        if ((uint8_t)body[0] != protocol::OP_MESSAGES) return failWith(body, size);
+        protocol::MessageBatchReader batch(body + 1, size - 1);
+        protocol::WireMessage msg;
+        while (batch.next(msg)) messages.push_back(protocol::toMessage(msg));
+        if (!batch.ok()) {
+            lastError = "无法解析服务器应答";
+            return false;
+        }
+        if (!batch.hasMore()) return true;
+    }
+    return false;
+}
+
+bool ChatClient::recent(int limit, int offset, std::vector<Database::RecentChat>& chats, bool* hasMore) {
+    const char* body;
+    size_t size;
+    if (!sendRequest(makeRequest(protocol::OP_RECENT, std::string(), std::string(), false, limit, offset)) ||
+        !readReply(body, size)) {
+        return false;
+    }
+    if ((uint8_t)body[0] != protocol::OP_CHATS) return failWith(body, size);
+
+    chats.clear();
+    protocol::ChatBatchReader batch(body + 1, size - 1);
+    protocol::WireChat wire;
+    while (batch.next(wire)) {
+        Database::RecentChat chat;
+        chat.name = wire.name.str();
+        chat.isGroup = wire.isGroup;
+        chat.lastTime = protocol::timeText(wire.time, wire.rawTime);
+        chat.lastMessage = wire.lastMessage.str();
+        chats.push_back(chat);
+    }
+    if (!batch.ok()) {
+        lastError = "无法解析服务器应答";
+        return false;
+    }
+    if (hasMore) *hasMore = batch.hasMore();
+    return true;
+}
+
+bool ChatClient::watch(const std::string& target, bool isGroup) {
+    return call(makeRequest(protocol::OP_WATCH, target, std::string(), isGroup));
+}
+
+bool ChatClient::unwatch() {
+    return call(makeRequest(protocol::OP_UNWATCH));
+}
+
+void ChatClient::quit() {
+    call(makeRequest(protocol::OP_QUIT));
+    disconnect();
+}
+
+bool ChatClient::readPush(Message& msg, int timeoutMs) {
+    const char* body;
+    size_t size;
+    while (pushes.empty()) {
+        if (!readFrame(body, size, timeoutMs)) return false;
+        // 没有未完成的请求时不应收到其它应答，忽略
+        if ((uint8_t)body[0] == protocol::OP_PUSH) queuePushes(body, size);
+    }
+    msg = pushes.front();
+    pushes.pop_front();
+    return true;
+}
@@ -1,13 +1,76 @@
 #include "database.h"
+#include "metrics.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <ctime>
 #include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <thread>
+#include <chrono>
 
 Database* Database::instance = nullptr;
 
-Database::Database() : db(nullptr) {}
+// 启动预读覆盖每个表最新的行数
+static const int kWarmupRows = 1000;
+
+// 不含目录的日志文件名放在数据库文件所在目录，而不是进程的当前目录
+static std::string besideDatabase(const std::string& dbPath, const std::string& name) {
+    if (name.empty() || name.find_first_of("/\\") != std::string::npos) return name;
+    size_t slash = dbPath.find_last_of("/\\");
+    return slash == std::string::npos ? name : dbPath.substr(0, slash + 1) + name;
+}
+
+DatabaseOptions::DatabaseOptions()
+    : path("chat.db"),
+      initScript("database/init.sql"),
+      mmapSize(256LL * 1024 * 1024),
+      cacheSizeKb(64 * 1024),
+      tempStore(2),
+      warmup(false),
+      journalMode("WAL"),
+      busyTimeoutMs(5000),
+      profile(false),
+      slowQueryMs(200.0),
+      slowLogPath("slow_query.log"),
+      shmRing(false),
+      messageCacheBytes(4LL * 1024 * 1024),
+      messageCacheWindow(50),
+      prefetchCount(3),
+      fanoutMinMembers(0) {}
+
+DatabaseOptions DatabaseOptions::fromEnvironment() {
+    return fromEnvironment(DatabaseOptions());
+}
+
+DatabaseOptions DatabaseOptions::fromEnvironment(const DatabaseOptions& defaults) {
+    DatabaseOptions opts = defaults;
+    const char* value;
+    
+    if ((value = std::getenv("OICQ_DB_PATH")) && *value) opts.path = value;
+    if ((value = std::getenv("OICQ_MMAP_SIZE")) && *value) opts.mmapSize = std::atoll(value);
+    if ((value = std::getenv("OICQ_CACHE_SIZE_KB")) && *value) opts.cacheSizeKb = std::atoi(value);
+    if ((value = std::getenv("OICQ_TEMP_STORE")) && *value) opts.tempStore = std::atoi(value);
+    if ((value = std::getenv("OICQ_WARMUP")) && *value) opts.warmup = std::atoi(value) != 0;
+    if ((value = std::getenv("OICQ_JOURNAL_MODE"))) opts.journalMode = value;
+    if ((value = std::getenv("OICQ_BUSY_TIMEOUT_MS")) && *value) opts.busyTimeoutMs = std::atoi(value);
+    if ((value = std::getenv("OICQ_PROFILE")) && *value) opts.profile = std::atoi(value) != 0;
+    if ((value = std::getenv("OICQ_SLOW_QUERY_MS")) && *value) opts.slowQueryMs = std::atof(value);
+    if ((value = std::getenv("OICQ_SLOW_LOG"))) opts.slowLogPath = value;
+    if ((value = std::getenv("OICQ_SHM_RING")) && *value) opts.shmRing = std::atoi(value) != 0;
+    if ((value = std::getenv("OICQ_MSG_CACHE_BYTES")) && *value) opts.messageCacheBytes = std::atoll(value);
+    if ((value = std::getenv("OICQ_MSG_CACHE_WINDOW")) && *value) opts.messageCacheWindow = std::atoi(value);
+    if (opts.messageCacheWindow < 1) opts.messageCacheWindow = 1;
+    if ((value = std::getenv("OICQ_PREFETCH_COUNT")) && *value) opts.prefetchCount = std::atoi(value);
+    if ((value = std::getenv("OICQ_FANOUT_MIN_MEMBERS")) && *value) opts.fanoutMinMembers = std::atoi(value);
+    
+    return opts;
+}
+
+Database::Database()
+    : db(nullptr), busyWaits(0), lastDataVersion(-1), lastExternalId(0), ringStopping(false), ringCursor(0) {}
 
 Database* Database::getInstance() {
     if (instance == nullptr) {
@@ -20,15 +83,33 @@ Database::~Database() {
     close();
 }
 
-bool Database::initialize() {
-    int rc = sqlite3_open("chat.db", &db);
+bool Database::initialize(const DatabaseOptions& opts) {
+    close();
+    options = opts;
+    
+    int rc = sqlite3_open(options.path.c_str(), &db);
     if (rc) {
         std::cerr << "无法打开数据库: " << sqlite3_errmsg(db) << std::endl;
         return false;
     }
     
+    // 记录插入 messages 的 rowid，提交后通知订阅者
+    sqlite3_update_hook(db, updateHook, this);
+    sqlite3_rollback_hook(db, rollbackHook, this);
+    
+    if (options.profile) {
+        options.slowLogPath = besideDatabase(options.path, options.slowLogPath);
+        profiler.setSlowLog(options.slowLogPath, options.slowQueryMs);
+        profiler.attach(db);
+    }
+    
+    // 页缓存和内存映射必须在首次读取前设置
+    if (!applyOptions()) {
+        return false;
+    }
+    
     // 读取并执行初始化SQL脚本
-    std::ifstream sqlFile("database/init.sql");
+    std::ifstream sqlFile(options.initScript.c_str());
     if (!sqlFile.is_open()) {
         std::cerr << "无法打开初始化SQL文件" << std::endl;
         return false;
@@ -39,10 +120,291 @@ bool Database::initialize() {
     std::string sql = buffer.str();
     sqlFile.close();
     
-    return executeSQL(sql);
+    if (!executeSQL(sql)) {
+        return false;
+    }
+    
+    if (options.warmup) {
+        warmupIndexes();
+    }
+    
+    messageCache.clear();
+    messageCache.configure((size_t)options.messageCacheWindow, options.messageCacheBytes);
+    
+    // 外部变更检查的起点：此前已有的消息不再通知
+    lastDataVersion = dataVersion();
+    lastExternalId = maxMessageId();
+    
+    // 通知环不可用（非 Linux、内存数据库等）时退回文件监视
+    if (options.shmRing && ring.open(options.path)) {
+        ringCursor = ring.head();
+    }
+    
+    if (options.prefetchCount > 0 && messageCache.enabled()) {
+        prefetcher.start(options.path, options.mmapSize, [this](sqlite3* conn, const PrefetchTarget& target) {
+            prefetchConversation(conn, target);
+        });
+    }
+    return true;
+}
+
+int Database::busyHandler(void* self, int attempts) {
+    // 与 sqlite3_busy_timeout 相同的退避序列，额外记录等待次数
+    static const int delays[] = { 1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100 };
+    static const int count = sizeof(delays) / sizeof(delays[0]);
+    Database* database = (Database*)self;
+    
+    int waited = 0;
+    for (int i = 0; i < attempts; ++i) {
+        waited += delays[i < count ? i : count - 1];
+    }
+    int delay = delays[attempts < count ? attempts : count - 1];
+    if (waited + delay > database->options.busyTimeoutMs) {
+        return 0;
+    }
+    
+    database->busyWaits++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    return 1;
+}
+
+void Database::updateHook(void* self, int op, const char*, const char* table, sqlite3_int64 rowid) {
+    // 钩子运行在语句执行过程中，不能在这里查询数据库
+    if (op != SQLITE_INSERT || std::strcmp(table, "messages") != 0) return;
+    Database* database = (Database*)self;
+    std::lock_guard<std::mutex> lock(database->pendingMutex);
+    database->pendingMessageIds.push_back(rowid);
+}
+
+void Database::rollbackHook(void* self) {
+    Database* database = (Database*)self;
+    std::lock_guard<std::mutex> lock(database->pendingMutex);
+    database->pendingMessageIds.clear();
+}
+
+void Database::publishCommittedMessages() {
+    // 显式事务尚未提交时继续累积
+    if (!sqlite3_get_autocommit(db)) return;
+    
+    std::vector<long long> ids;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        ids.swap(pendingMessageIds);
+    }
+    if (ids.empty() || (!notifier.hasSubscribers() && !ring.isOpen())) return;
+    
+    // 其它连接先提交的消息 id 更小，监视线程的唤醒可能还没到；先发布它们，
+    // 订阅方按 id 递增去重时才不会把它们当作已推送过的丢弃
+    if (!ring.isOpen()) checkExternalChanges();
+    
+    std::string sql = "SELECT sender, receiver, content, timestamp, is_group FROM messages WHERE id = ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return;
+    
+    for (long long id : ids) {
+        sqlite3_bind_int64(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            MessageNotice notice;
+            notice.id = id;
+            notice.sender = columnView(stmt, 0).str();
+            notice.receiver = columnView(stmt, 1).str();
+            notice.content = columnView(stmt, 2).str();
+            notice.timestamp = columnView(stmt, 3).str();
+            notice.isGroup = sqlite3_column_int(stmt, 4) != 0;
+            notice.complete = true;
+            notifier.publish(notice);
+            ring.publish(notice);
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+}
+
+long long Database::maxMessageId() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT MAX(id) FROM messages", -1, &stmt, NULL) != SQLITE_OK) return 0;
+    
+    long long id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return id;
+}
+
+void Database::checkExternalChanges() {
+    // 本连接自己的写入不会改变 data_version，检查点等无关的文件变化也会在这里被过滤
+    long long version = dataVersion();
+    if (version == lastDataVersion) return;
+    lastDataVersion = version;
+    
+    if (!notifier.hasSubscribers()) {
+        lastExternalId = maxMessageId();
+        return;
+    }
+    
+    std::string sql = "SELECT id, sender, receiver, content, timestamp, is_group FROM messages WHERE id > ? ORDER BY id";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return;
+    sqlite3_bind_int64(stmt, 1, lastExternalId);
+    
+    stepRows(stmt, [&](sqlite3_stmt* row) {
+        MessageNotice notice;
+        notice.id = lastExternalId = sqlite3_column_int64(row, 0);
+        notice.sender = columnView(row, 1).str();
+        notice.receiver = columnView(row, 2).str();
+        notice.content = columnView(row, 3).str();
+        notice.timestamp = columnView(row, 4).str();
+        notice.isGroup = sqlite3_column_int(row, 5) != 0;
+        notice.complete = true;
+        notifier.publish(notice);
+        return true;
+    });
+}
+
+bool Database::startChangeWatcher(const std::function<void()>& wake) {
+    if (!db) return false;
+    if (isWatchingChanges()) return true;
+    
+    // 有通知环时其它 oicq 进程的消息直接从环中读取，不再访问数据库；
+    // 绕过 Database 直接写库的程序不会出现在环中
+    if (ring.isOpen()) {
+        ringStopping = false;
+        ringThread = std::thread(&Database::tailRing, this);
+        return true;
+    }
+    // 回调在监视线程上，此时持有连接的线程可能正处于事务中，不能在这里查询
+    return watcher.start(options.path, wake);
+}
+
+void Database::tailRing() {
+    std::vector<MessageNotice> notices;
+    while (true) {
+        // 先取唤醒字再检查停止标志，close() 的唤醒不会丢失
+        unsigned int word = ring.wakeWord();
+        if (ringStopping) break;
+        
+        bool lost = false;
+        notices.clear();
+        ring.read(ringCursor, notices, lost);
+        for (const auto& notice : notices) {
+            notifier.publish(notice);
+        }
+        if (lost) {
+            notifier.publishResync();
+        }
+        // 停在未写完的槽位上时定时重读，写入方已退出则跳过该槽位
+        ring.wait(word, ring.isStalled() ? SharedRing::kStalledSlotMs : 0);
+    }
+}
+
+long long Database::dataVersion() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version", -1, &stmt, NULL) != SQLITE_OK) return -1;
+    
+    long long version = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+bool Database::applyOptions() {
+    // 多个进程共享同一数据库文件时，锁冲突交给退避重试处理
+    sqlite3_busy_handler(db, busyHandler, this);
+    
+    std::stringstream pragmas;
+    pragmas << "PRAGMA mmap_size = " << options.mmapSize << ";";
+    if (options.cacheSizeKb > 0) {
+        // 负数表示以 KiB 为单位，而非页数
+        pragmas << "PRAGMA cache_size = -" << options.cacheSizeKb << ";";
+    }
+    pragmas << "PRAGMA temp_store = " << options.tempStore << ";";
+    if (!options.journalMode.empty()) {
+        // 日志模式名直接拼入 PRAGMA，只接受字母
+        bool valid = true;
+        for (char c : options.journalMode) {
+            if (!std::isalpha((unsigned char)c)) valid = false;
+        }
+        if (valid) {
+            // WAL 模式下读写互不阻塞，适合多个会话同时收发消息
+            pragmas << "PRAGMA journal_mode = " << options.journalMode << ";";
+        } else {
+            std::cerr << "忽略无效的日志模式: " << options.journalMode << std::endl;
+        }
+    }
+    
+    return executeSQL(pragmas.str());
+}
+
+void Database::warmupIndexes() {
+    // 只预读热点范围：每个表最新的 kWarmupRows 行按完整键在各索引中查找一次，
+    // 读入的正是这些条目所在的叶子页和沿途的内部页；再读取最新的一段消息，覆盖打开聊天时最先访问的表尾页。
+    // 不遍历整个索引，启动耗时与历史总量无关。oicq_plancheck 检查每个索引都有一条探测，且按该索引 SEARCH
+    std::string sql = "SELECT m.tbl_name, m.name, ii.name FROM sqlite_master m, "
+                      "pragma_index_info(m.name) ii WHERE m.type = 'index' ORDER BY m.name, ii.seqno";
+    std::vector<std::string> tables, indexes;
+    std::vector<std::vector<std::string> > columns;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return;
+    
+    stepRows(stmt, [&](sqlite3_stmt* row) {
+        std::string index = columnView(row, 1).str();
+        if (indexes.empty() || indexes.back() != index) {
+            tables.push_back(columnView(row, 0).str());
+            indexes.push_back(index);
+            columns.push_back(std::vector<std::string>());
+        }
+        columns.back().push_back(columnView(row, 2).str());
+        return true;
+    });
+    
+    std::vector<std::string> scans;
+    for (size_t i = 0; i < indexes.size(); ++i) {
+        std::string select, match;
+        for (const auto& column : columns[i]) {
+            if (!select.empty()) select += ", ";
+            select += "\"" + column + "\"";
+            if (!match.empty()) match += " AND ";
+            match += "\"" + column + "\" IS r.\"" + column + "\"";
+        }
+        // WITHOUT ROWID 表没有 rowid 顺序，准备失败后跳过
+        scans.push_back("SELECT COUNT(*) FROM (SELECT " + select + " FROM \"" + tables[i] +
+                        "\" ORDER BY rowid DESC LIMIT " + std::to_string(kWarmupRows) + ") r WHERE EXISTS "
+                        "(SELECT 1 FROM \"" + tables[i] + "\" INDEXED BY \"" + indexes[i] + "\" WHERE " + match + ")");
+    }
+    scans.push_back("SELECT COUNT(length(content)) FROM "
+                    "(SELECT content FROM messages ORDER BY id DESC LIMIT " + std::to_string(kWarmupRows) + ")");
+    
+    for (const auto& scan : scans) {
+        rc = sqlite3_prepare_v2(db, scan.c_str(), -1, &stmt, NULL);
+        if (rc != SQLITE_OK) continue;
+        stepRows(stmt, [](sqlite3_stmt*) { return true; });
+    }
+}
+
+bool Database::getCacheStats(long long& hits, long long& misses) {
+    if (!db) return false;
+    int current, highwater;
+    if (sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 0) != SQLITE_OK) return false;
+    hits = current;
+    if (sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 0) != SQLITE_OK) return false;
+    misses = current;
+    return true;
 }
 
 void Database::close() {
+    prefetcher.stop();
+    if (ringThread.joinable()) {
+        ringStopping = true;
+        ring.wakeAll();
+        ringThread.join();
+    }
+    ring.close();
+    watcher.stop();
     if (db) {
         sqlite3_close(db);
         db = nullptr;
@@ -62,7 +424,31 @@ bool Database::executeSQL(const std::string& sql) {
     return true;
 }
 
+bool Database::stepRows(sqlite3_stmt* stmt, const std::function<bool(sqlite3_stmt*)>& onRow) {
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!onRow(stmt)) {
+            // 访问器要求提前终止
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+TextView Database::columnView(sqlite3_stmt* stmt, int col) {
+    // 必须先取 text 再取 bytes，保证长度对应转换后的 UTF-8 缓冲区
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    TextView view;
+    view.data = text ? text : "";
+    view.size = text ? sqlite3_column_bytes(stmt, col) : 0;
+    return view;
+}
+
 bool Database::createUser(const std::string& username, const std::string& password) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
     std::string sql = "INSERT INTO users (username, password) VALUES (?, ?)";
     sqlite3_stmt* stmt;
     
@@ -82,11 +468,27 @@ bool Database::createUser(const std::string& username, const std::string& passwo
 }
 
 bool Database::deleteUserData(const std::string& username) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
+    // 该用户发言过的写扩散群，删除消息后成员收件箱可能指向已删除的消息
+    std::vector<std::string> fanoutGroups;
+    std::string groupSql = "SELECT DISTINCT m.receiver FROM messages m "
+                           "INNER JOIN group_fanout f ON f.group_name = m.receiver "
+                           "WHERE m.sender = ? AND m.is_group = 1";
+    sqlite3_stmt* groupStmt;
+    if (sqlite3_prepare_v2(db, groupSql.c_str(), -1, &groupStmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(groupStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+        while (sqlite3_step(groupStmt) == SQLITE_ROW) {
+            fanoutGroups.push_back((char*)sqlite3_column_text(groupStmt, 0));
+        }
+    }
+    sqlite3_finalize(groupStmt);
+    
     // 删除用户相关的所有数据
     std::vector<std::string> queries = {
         "DELETE FROM users WHERE username = ?",
         "DELETE FROM friendships WHERE user1 = ? OR user2 = ?",
         "DELETE FROM group_members WHERE username = ?",
+        "DELETE FROM group_inbox WHERE username = ?",
         "DELETE FROM messages WHERE sender = ? OR receiver = ?"
     };
     
@@ -105,10 +507,17 @@ bool Database::deleteUserData(const std::string& username) {
         sqlite3_finalize(stmt);
     }
     
+    for (const auto& group : fanoutGroups) {
+        repointInbox(group);
+    }
+    
+    // 缓存只会增量追加，删除的消息必须整体丢弃
+    messageCache.clear();
     return true;
 }
 
 bool Database::validateUser(const std::string& username, const std::string& password) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
     std::string sql = "SELECT password FROM users WHERE username = ?";
     sqlite3_stmt* stmt;
     
@@ -129,6 +538,7 @@ bool Database::validateUser(const std::string& username, const std::string& pass
 }
 
 bool Database::userExists(const std::string& username) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
     std::string sql = "SELECT COUNT(*) FROM users WHERE username = ?";
     sqlite3_stmt* stmt;
     
@@ -148,6 +558,7 @@ bool Database::userExists(const std::string& username) {
 }
 
 int Database::getUserId(const std::string& username) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
     std::string sql = "SELECT id FROM users WHERE username = ?";
     sqlite3_stmt* stmt;
     
@@ -167,6 +578,7 @@ int Database::getUserId(const std::string& username) {
 }
 
 bool Database::addFriend(const std::string& username, const std::string& friendName) {
+    Metrics::getInstance()->countQuery(QUERY_FRIEND);
     if (!userExists(friendName)) return false;
     
     // 检查是否已经是好友（双向检查）
@@ -224,23 +636,45 @@ bool Database::addFriend(const std::string& username, const std::string& friendN
 
 std::vector<std::string> Database::getFriends(const std::string& username) {
     std::vector<std::string> friends;
+    visitFriends(username, [&](const TextView& name) {
+        friends.push_back(name.str());
+        return true;
+    });
+    return friends;
+}
+
+bool Database::visitFriends(const std::string& username, const NameVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_FRIEND);
     std::string sql = "SELECT user2 FROM friendships WHERE user1 = ?";
     sqlite3_stmt* stmt;
     
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
-    if (rc != SQLITE_OK) return friends;
+    if (rc != SQLITE_OK) return false;
     
     sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        friends.push_back((char*)sqlite3_column_text(stmt, 0));
+    return stepRows(stmt, [&](sqlite3_stmt* row) {
+        return visitor(columnView(row, 0));
+    });
+}
+
+bool Database::areFriends(const std::string& user1, const std::string& user2) {
+    Metrics::getInstance()->countQuery(QUERY_FRIEND);
+    // addFriend 双向各写一行，查一个方向即可
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM friendships WHERE user1 = ? AND user2 = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
     }
-    
+    sqlite3_bind_text(stmt, 1, user1.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, user2.c_str(), -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
     sqlite3_finalize(stmt);
-    return friends;
+    return found;
 }
 
 bool Database::createGroup(const std::string& groupName, const std::string& creator) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
     std::string sql = "INSERT INTO groups (name, creator) VALUES (?, ?)";
     sqlite3_stmt* stmt;
     
@@ -262,6 +696,7 @@ bool Database::createGroup(const std::string& groupName, const std::string& crea
 }
 
 bool Database::joinGroup(const std::string& username, const std::string& groupName) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
     std::string sql = "INSERT OR IGNORE INTO group_members (group_name, username) VALUES (?, ?)";
     sqlite3_stmt* stmt;
     
@@ -273,11 +708,27 @@ bool Database::joinGroup(const std::string& username, const std::string& groupNa
     
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) return false;
+    
+    // 新成员加入写扩散的群：收件箱指向当前最新消息，与读扩散时的最近聊天列表一致
+    if (sqlite3_changes(db) > 0 && isFanoutGroup(groupName)) {
+        long long latestId = latestGroupMessageId(groupName);
+        if (latestId > 0) {
+            sql = "INSERT OR REPLACE INTO group_inbox (username, group_name, message_id) VALUES (?, ?, ?)";
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return false;
+            sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 3, latestId);
+            rc = sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+    }
     
     return rc == SQLITE_DONE;
 }
 
 bool Database::removeFromGroup(const std::string& username, const std::string& groupName) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
     std::string sql = "DELETE FROM group_members WHERE group_name = ? AND username = ?";
     sqlite3_stmt* stmt;
     
@@ -287,13 +738,210 @@ bool Database::removeFromGroup(const std::string& username, const std::string& g
     sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
     
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) return false;
+    
+    // 退出后不再出现在最近聊天列表中（读扩散由 group_members 连接保证）
+    sql = "DELETE FROM group_inbox WHERE username = ? AND group_name = ?";
+    rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return false;
+    
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+    
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
     return rc == SQLITE_DONE;
 }
 
+// 执行一次不返回行的预编译语句并重置
+static bool stepDone(sqlite3_stmt* stmt) {
+    bool done = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    return done;
+}
+
+// 批量成员变更中每个用户的写入放在保存点 { SAVEPOINT, ROLLBACK TO, RELEASE } 中：
+// 失败的用户撤销已完成的部分（如成员行已插入而收件箱失败），结果与数据库保持一致。
+// 保存点本身无法结束时返回 false，整批回滚
+static bool endMemberSavepoint(sqlite3_stmt* const savepoint[3], const Database::MembershipResult& result) {
+    if (result.outcome == Database::MEMBER_FAILED && !stepDone(savepoint[1])) return false;
+    return stepDone(savepoint[2]);
+}
+
+bool Database::joinGroupBulk(const std::string& groupName, const std::vector<std::string>& usernames,
+                             std::vector<MembershipResult>& results) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    results.clear();
+    if (!executeSQL("BEGIN IMMEDIATE")) return false;
+    
+    const char* const statements[] = {
+        "SELECT 1 FROM groups WHERE name = ?",
+        "SELECT 1 FROM users WHERE username = ?",
+        "INSERT OR IGNORE INTO group_members (group_name, username) VALUES (?, ?)",
+        "INSERT OR REPLACE INTO group_inbox (username, group_name, message_id) VALUES (?, ?, ?)",
+        "SAVEPOINT bulk_member",
+        "ROLLBACK TO bulk_member",
+        "RELEASE bulk_member",
+    };
+    sqlite3_stmt* stmts[7] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+    bool ok = true;
+    for (int i = 0; i < 7 && ok; ++i) {
+        ok = sqlite3_prepare_v2(db, statements[i], -1, &stmts[i], NULL) == SQLITE_OK;
+    }
+    sqlite3_stmt* groupStmt = stmts[0];
+    sqlite3_stmt* userStmt = stmts[1];
+    sqlite3_stmt* memberStmt = stmts[2];
+    sqlite3_stmt* inboxStmt = stmts[3];
+    sqlite3_stmt* const savepoint[3] = { stmts[4], stmts[5], stmts[6] };
+    
+    if (ok) {
+        sqlite3_bind_text(groupStmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+        ok = sqlite3_step(groupStmt) == SQLITE_ROW;
+    }
+    
+    if (ok) {
+        // 写扩散的群：新成员的收件箱指向当前最新消息，与 joinGroup 一致
+        long long latestId = isFanoutGroup(groupName) ? latestGroupMessageId(groupName) : 0;
+        sqlite3_bind_text(memberStmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(inboxStmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(inboxStmt, 3, latestId);
+        
+        results.reserve(usernames.size());
+        for (const auto& username : usernames) {
+            MembershipResult result;
+            result.username = username;
+            
+            sqlite3_bind_text(userStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+            bool exists = sqlite3_step(userStmt) == SQLITE_ROW;
+            sqlite3_reset(userStmt);
+            
+            if (!exists) {
+                result.outcome = MEMBER_NO_USER;
+            } else if (!stepDone(savepoint[0])) {
+                result.outcome = MEMBER_FAILED;
+            } else {
+                sqlite3_bind_text(memberStmt, 2, username.c_str(), -1, SQLITE_STATIC);
+                bool stepped = sqlite3_step(memberStmt) == SQLITE_DONE;
+                sqlite3_reset(memberStmt);
+                if (!stepped) {
+                    result.outcome = MEMBER_FAILED;
+                } else if (sqlite3_changes(db) == 0) {
+                    result.outcome = MEMBER_ALREADY;
+                } else {
+                    result.outcome = MEMBER_ADDED;
+                    if (latestId > 0) {
+                        sqlite3_bind_text(inboxStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+                        if (sqlite3_step(inboxStmt) != SQLITE_DONE) result.outcome = MEMBER_FAILED;
+                        sqlite3_reset(inboxStmt);
+                    }
+                }
+                ok = endMemberSavepoint(savepoint, result);
+            }
+            results.push_back(result);
+            if (!ok) break;
+        }
+    }
+    for (sqlite3_stmt* stmt : stmts) {
+        sqlite3_finalize(stmt);
+    }
+    
+    return finishBulk(ok, results);
+}
+
+bool Database::removeFromGroupBulk(const std::string& groupName, const std::vector<std::string>& usernames,
+                                   std::vector<MembershipResult>& results) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    results.clear();
+    if (!executeSQL("BEGIN IMMEDIATE")) return false;
+    
+    const char* const statements[] = {
+        "SELECT 1 FROM groups WHERE name = ?",
+        "DELETE FROM group_members WHERE group_name = ? AND username = ?",
+        "DELETE FROM group_inbox WHERE username = ? AND group_name = ?",
+        "SAVEPOINT bulk_member",
+        "ROLLBACK TO bulk_member",
+        "RELEASE bulk_member",
+    };
+    sqlite3_stmt* stmts[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+    bool ok = true;
+    for (int i = 0; i < 6 && ok; ++i) {
+        ok = sqlite3_prepare_v2(db, statements[i], -1, &stmts[i], NULL) == SQLITE_OK;
+    }
+    sqlite3_stmt* groupStmt = stmts[0];
+    sqlite3_stmt* memberStmt = stmts[1];
+    sqlite3_stmt* inboxStmt = stmts[2];
+    sqlite3_stmt* const savepoint[3] = { stmts[3], stmts[4], stmts[5] };
+    
+    if (ok) {
+        sqlite3_bind_text(groupStmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+        ok = sqlite3_step(groupStmt) == SQLITE_ROW;
+    }
+    
+    if (ok) {
+        sqlite3_bind_text(memberStmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(inboxStmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+        
+        results.reserve(usernames.size());
+        for (const auto& username : usernames) {
+            MembershipResult result;
+            result.username = username;
+            if (!stepDone(savepoint[0])) {
+                result.outcome = MEMBER_FAILED;
+                results.push_back(result);
+                continue;
+            }
+            
+            sqlite3_bind_text(memberStmt, 2, username.c_str(), -1, SQLITE_STATIC);
+            bool stepped = sqlite3_step(memberStmt) == SQLITE_DONE;
+            sqlite3_reset(memberStmt);
+            if (!stepped) {
+                result.outcome = MEMBER_FAILED;
+            } else if (sqlite3_changes(db) == 0) {
+                result.outcome = MEMBER_ABSENT;
+            } else {
+                result.outcome = MEMBER_REMOVED;
+                sqlite3_bind_text(inboxStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+                if (sqlite3_step(inboxStmt) != SQLITE_DONE) result.outcome = MEMBER_FAILED;
+                sqlite3_reset(inboxStmt);
+            }
+            ok = endMemberSavepoint(savepoint, result);
+            results.push_back(result);
+            if (!ok) break;
+        }
+    }
+    for (sqlite3_stmt* stmt : stmts) {
+        sqlite3_finalize(stmt);
+    }
+    
+    return finishBulk(ok, results);
+}
+
+bool Database::finishBulk(bool ok, std::vector<MembershipResult>& results) {
+    if (ok && executeSQL("COMMIT")) return true;
+    
+    executeSQL("ROLLBACK");
+    for (auto& result : results) {
+        result.outcome = MEMBER_FAILED;
+    }
+    return false;
+}
+
+int Database::importGroupMembers(const std::string& groupName, const std::vector<std::string>& usernames) {
+    std::vector<MembershipResult> results;
+    if (!joinGroupBulk(groupName, usernames, results)) return -1;
+    
+    int added = 0;
+    for (const auto& result : results) {
+        if (result.outcome == MEMBER_ADDED) ++added;
+    }
+    return added;
+}
+
 bool Database::isGroupCreator(const std::string& username, const std::string& groupName) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
     std::string sql = "SELECT creator FROM groups WHERE name = ?";
     sqlite3_stmt* stmt;
     
@@ -313,7 +961,22 @@ bool Database::isGroupCreator(const std::string& username, const std::string& gr
     return isCreator;
 }
 
+bool Database::isGroupMember(const std::string& username, const std::string& groupName) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM group_members WHERE group_name = ? AND username = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
 bool Database::verifySystemPassword(const std::string& password) {
+    Metrics::getInstance()->countQuery(QUERY_USER);
     std::string sql = "SELECT value FROM system_config WHERE key = 'admin_password'";
     sqlite3_stmt* stmt;
     
@@ -332,6 +995,7 @@ bool Database::verifySystemPassword(const std::string& password) {
 }
 
 std::vector<std::string> Database::getUserGroups(const std::string& username) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
     std::vector<std::string> groups;
     std::string sql = "SELECT group_name FROM group_members WHERE username = ?";
     sqlite3_stmt* stmt;
@@ -349,26 +1013,79 @@ std::vector<std::string> Database::getUserGroups(const std::string& username) {
     return groups;
 }
 
-std::vector<std::string> Database::getGroupMembers(const std::string& groupName) {
+std::vector<std::string> Database::getGroupMembers(const std::string& groupName, const std::string& afterUsername,
+                                                   int limit) {
     std::vector<std::string> members;
-    std::string sql = "SELECT username FROM group_members WHERE group_name = ?";
+    visitGroupMembersPage(groupName, afterUsername, limit, [&](const TextView& name) {
+        members.push_back(name.str());
+        return true;
+    });
+    return members;
+}
+
+bool Database::visitGroupMembersPage(const std::string& groupName, const std::string& afterUsername, int limit,
+                                     const NameVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    // 以上一页最后一个用户名为起点，翻到第几页都只读取本页的索引条目
+    std::string sql = "SELECT username FROM group_members WHERE group_name = ? AND username > ? "
+                      "ORDER BY username LIMIT ?";
     sqlite3_stmt* stmt;
     
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
-    if (rc != SQLITE_OK) return members;
+    if (rc != SQLITE_OK) return false;
     
     sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, afterUsername.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, limit);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        members.push_back((char*)sqlite3_column_text(stmt, 0));
+    return stepRows(stmt, [&](sqlite3_stmt* row) {
+        return visitor(columnView(row, 0));
+    });
+}
+
+long long Database::getGroupMemberCount(const std::string& groupName) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT members FROM group_member_counts WHERE group_name = ?", -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
     }
-    
+    sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    long long members = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
     sqlite3_finalize(stmt);
     return members;
 }
 
+std::vector<std::string> Database::getGroupMembers(const std::string& groupName) {
+    std::vector<std::string> members;
+    visitGroupMembers(groupName, [&](const TextView& name) {
+        members.push_back(name.str());
+        return true;
+    });
+    return members;
+}
+
+bool Database::visitGroupMembers(const std::string& groupName, const NameVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_GROUP);
+    std::string sql = "SELECT username FROM group_members WHERE group_name = ?";
+    sqlite3_stmt* stmt;
+    
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return false;
+    
+    sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    
+    return stepRows(stmt, [&](sqlite3_stmt* row) {
+        return visitor(columnView(row, 0));
+    });
+}
+
 bool Database::saveMessage(const std::string& sender, const std::string& receiver, 
                           const std::string& content, bool isGroup) {
+    Metrics::getInstance()->countQuery(QUERY_SEND);
+    if (isGroup && wantsWriteFanout(receiver)) {
+        return saveFanoutMessage(sender, receiver, content);
+    }
+    
     std::string sql = "INSERT INTO messages (sender, receiver, content, is_group) VALUES (?, ?, ?, ?)";
     sqlite3_stmt* stmt;
     
@@ -383,12 +1100,140 @@ bool Database::saveMessage(const std::string& sender, const std::string& receive
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
-    return rc == SQLITE_DONE;
+    if (rc != SQLITE_DONE) return false;
+    Metrics::getInstance()->countMessageSent(isGroup);
+    publishCommittedMessages();
+    return true;
+}
+
+bool Database::isFanoutGroup(const std::string& groupName) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM group_fanout WHERE group_name = ?", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool Database::wantsWriteFanout(const std::string& groupName) {
+    if (isFanoutGroup(groupName)) return true;
+    return options.fanoutMinMembers > 0 && getGroupMemberCount(groupName) >= options.fanoutMinMembers;
+}
+
+bool Database::saveFanoutMessage(const std::string& sender, const std::string& groupName,
+                                 const std::string& content) {
+    // 切换、写消息、更新收件箱必须同时生效，否则最近聊天列表会漏掉或重复这个群
+    if (!executeSQL("BEGIN IMMEDIATE")) return false;
+    
+    const char* const statements[] = {
+        "INSERT OR IGNORE INTO group_fanout (group_name) VALUES (?)",
+        "INSERT INTO messages (sender, receiver, content, is_group) VALUES (?, ?, ?, 1)",
+        "INSERT OR REPLACE INTO group_inbox (username, group_name, message_id) "
+        "SELECT username, group_name, ? FROM group_members WHERE group_name = ?",
+    };
+    
+    bool ok = true;
+    long long messageId = 0;
+    for (int i = 0; i < 3 && ok; ++i) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, statements[i], -1, &stmt, NULL) != SQLITE_OK) {
+            ok = false;
+            break;
+        }
+        if (i == 0) {
+            sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+        } else if (i == 1) {
+            sqlite3_bind_text(stmt, 1, sender.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, content.c_str(), -1, SQLITE_STATIC);
+        } else {
+            sqlite3_bind_int64(stmt, 1, messageId);
+            sqlite3_bind_text(stmt, 2, groupName.c_str(), -1, SQLITE_STATIC);
+        }
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+        if (i == 1) messageId = sqlite3_last_insert_rowid(db);
+    }
+    
+    if (!ok || !executeSQL("COMMIT")) {
+        executeSQL("ROLLBACK");
+        return false;
+    }
+    Metrics::getInstance()->countMessageSent(true);
+    publishCommittedMessages();
+    return true;
+}
+
+long long Database::latestGroupMessageId(const std::string& groupName) {
+    std::string sql = "SELECT id FROM messages WHERE receiver = ? AND is_group = 1 "
+                      "ORDER BY timestamp DESC, id DESC LIMIT 1";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return 0;
+    
+    sqlite3_bind_text(stmt, 1, groupName.c_str(), -1, SQLITE_STATIC);
+    long long id = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return id;
+}
+
+void Database::repointInbox(const std::string& groupName) {
+    long long latestId = latestGroupMessageId(groupName);
+    // 按成员逐个定位主键，不扫描整个收件箱
+    std::string sql = latestId > 0
+        ? "UPDATE group_inbox SET message_id = ? WHERE group_name = ? "
+          "AND username IN (SELECT username FROM group_members WHERE group_name = ?)"
+        : "DELETE FROM group_inbox WHERE group_name = ? "
+          "AND username IN (SELECT username FROM group_members WHERE group_name = ?)";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return;
+    
+    int param = 1;
+    if (latestId > 0) sqlite3_bind_int64(stmt, param++, latestId);
+    sqlite3_bind_text(stmt, param++, groupName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, param, groupName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
 }
 
 std::vector<Message> Database::getMessages(const std::string& user1, const std::string& user2, 
                                          bool isGroup) {
     std::vector<Message> messages;
+    visitMessages(user1, user2, isGroup, [&](const MessageView& view) {
+        messages.push_back(messageOf(view));
+        return true;
+    });
+    return messages;
+}
+
+int Database::bindConversation(sqlite3_stmt* stmt, const std::string& user1,
+                               const std::string& user2, bool isGroup) {
+    if (isGroup) {
+        sqlite3_bind_text(stmt, 1, user2.c_str(), -1, SQLITE_STATIC); // user2 是群名
+        return 2;
+    }
+    sqlite3_bind_text(stmt, 1, user1.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, user2.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, user2.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, user1.c_str(), -1, SQLITE_STATIC);
+    return 5;
+}
+
+MessageView Database::messageView(sqlite3_stmt* stmt, bool isGroup) {
+    MessageView view;
+    view.id = sqlite3_column_int(stmt, 0);
+    view.sender = columnView(stmt, 1);
+    view.receiver = columnView(stmt, 2);
+    view.content = columnView(stmt, 3);
+    view.timestamp = columnView(stmt, 4);
+    view.isGroup = isGroup;
+    return view;
+}
+
+bool Database::visitMessages(const std::string& user1, const std::string& user2, 
+                             bool isGroup, const MessageVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_HISTORY);
     std::string sql;
     
     if (isGroup) {
@@ -399,49 +1244,202 @@ std::vector<Message> Database::getMessages(const std::string& user1, const std::
     
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
-    if (rc != SQLITE_OK) return messages;
+    if (rc != SQLITE_OK) return false;
+    
+    bindConversation(stmt, user1, user2, isGroup);
+    
+    return stepRows(stmt, [&](sqlite3_stmt* row) {
+        return visitor(messageView(row, isGroup));
+    });
+}
+
+bool Database::visitMessagesSince(const std::string& user1, const std::string& user2, bool isGroup,
+                                  long long afterId, const MessageVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_HISTORY);
+    std::string sql;
     
     if (isGroup) {
-        sqlite3_bind_text(stmt, 1, user2.c_str(), -1, SQLITE_STATIC); // user2 是群名
+        sql = "SELECT id, sender, receiver, content, timestamp FROM messages WHERE receiver = ? AND is_group = 1 AND id > ? ORDER BY id";
     } else {
-        sqlite3_bind_text(stmt, 1, user1.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, user2.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, user2.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 4, user1.c_str(), -1, SQLITE_STATIC);
+        sql = "SELECT id, sender, receiver, content, timestamp FROM messages WHERE ((sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?)) AND is_group = 0 AND id > ? ORDER BY id";
     }
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Message msg;
-        msg.id = sqlite3_column_int(stmt, 0);
-        msg.sender = (char*)sqlite3_column_text(stmt, 1);
-        msg.receiver = (char*)sqlite3_column_text(stmt, 2);
-        msg.content = (char*)sqlite3_column_text(stmt, 3);
-        msg.timestamp = (char*)sqlite3_column_text(stmt, 4);
-        msg.isGroup = isGroup;
-        messages.push_back(msg);
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return false;
+    
+    int next = bindConversation(stmt, user1, user2, isGroup);
+    sqlite3_bind_int64(stmt, next, afterId);
+    
+    return stepRows(stmt, [&](sqlite3_stmt* row) {
+        return visitor(messageView(row, isGroup));
+    });
+}
+
+long long Database::getLastMessageId(const std::string& user1, const std::string& user2, bool isGroup) {
+    Metrics::getInstance()->countQuery(QUERY_HISTORY);
+    std::string sql;
+    
+    if (isGroup) {
+        sql = "SELECT MAX(id) FROM messages WHERE receiver = ? AND is_group = 1";
+    } else {
+        sql = "SELECT MAX(id) FROM messages WHERE ((sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?)) AND is_group = 0";
     }
     
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return 0;
+    
+    bindConversation(stmt, user1, user2, isGroup);
+    
+    long long id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
     sqlite3_finalize(stmt);
-    return messages;
+    return id;
+}
+
+CacheStamp Database::cacheStamp() {
+    CacheStamp stamp;
+    stamp.dataVersion = dataVersion();
+    stamp.totalChanges = sqlite3_total_changes(db);
+    return stamp;
+}
+
+bool Database::fetchLatestMessages(sqlite3* conn, const std::string& user1, const std::string& user2, bool isGroup,
+                                   int limit, std::vector<Message>& messages) {
+    std::string sql;
+    
+    // 倒序取最新的若干条，群聊沿 (receiver, is_group, timestamp) 索引反向读取后即可停止
+    if (isGroup) {
+        sql = "SELECT id, sender, receiver, content, timestamp FROM messages WHERE receiver = ? AND is_group = 1 ORDER BY timestamp DESC, id DESC LIMIT ?";
+    } else {
+        sql = "SELECT id, sender, receiver, content, timestamp FROM messages WHERE ((sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?)) AND is_group = 0 ORDER BY timestamp DESC, id DESC LIMIT ?";
+    }
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(conn, sql.c_str(), -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return false;
+    
+    int next = bindConversation(stmt, user1, user2, isGroup);
+    sqlite3_bind_int(stmt, next, limit);
+    
+    messages.clear();
+    bool ok = stepRows(stmt, [&](sqlite3_stmt* row) {
+        messages.push_back(messageOf(messageView(row, isGroup)));
+        return true;
+    });
+    std::reverse(messages.begin(), messages.end());
+    return ok;
 }
 
-std::vector<Database::RecentChat> Database::getRecentChats(const std::string& username) {
-    std::vector<RecentChat> recentChats;
+void Database::prefetchConversation(sqlite3* conn, const PrefetchTarget& target) {
+    std::string key = MessageNotifier::conversationKey(target.user1, target.user2, target.isGroup);
+    if (messageCache.contains(key)) return;
     
-    // 获取私聊的最近消息 - 修复查询逻辑
+    // 标记在提交时按主连接取得，早于这里的读取：期间有提交时首次打开会重新读取
+    std::vector<Message> messages;
+    if (fetchLatestMessages(conn, target.user1, target.user2, target.isGroup,
+                            (int)messageCache.getWindow(), messages)) {
+        messageCache.storePrefetched(key, messages, target.stamp);
+    }
+}
+
+void Database::prefetchConversations(const std::vector<PrefetchTarget>& targets) {
+    if (!prefetcher.isRunning()) return;
+    std::vector<PrefetchTarget> top(targets.begin(),
+                                    targets.begin() + std::min(targets.size(), (size_t)std::max(options.prefetchCount, 0)));
+    // 主连接只在拥有它的线程上使用，缓存标记在这里取好交给预取线程
+    CacheStamp stamp = cacheStamp();
+    for (auto& target : top) target.stamp = stamp;
+    prefetcher.submit(top);
+}
+
+bool Database::visitConversation(const std::string& user1, const std::string& user2, bool isGroup,
+                                 const MessageVisitor& visitor) {
+    Metrics::getInstance()->countQuery(QUERY_HISTORY);
+    std::string key = MessageNotifier::conversationKey(user1, user2, isGroup);
+    std::vector<Message> messages;
+    
+    if (messageCache.enabled()) {
+        // 标记取在读取之前：读取期间的提交会让下次查找走增量读取
+        CacheStamp stamp = cacheStamp();
+        long long maxId = 0;
+        CacheState state = messageCache.lookup(key, stamp, maxId);
+        
+        if (state == CACHE_MISSING) {
+            if (!fetchLatestMessages(db, user1, user2, isGroup, (int)messageCache.getWindow(), messages)) return false;
+            messageCache.store(key, messages, stamp);
+        } else if (state == CACHE_STALE) {
+            std::vector<Message> delta;
+            bool ok = visitMessagesSince(user1, user2, isGroup, maxId, [&](const MessageView& view) {
+                delta.push_back(messageOf(view));
+                return true;
+            });
+            if (!ok) return false;
+            messageCache.append(key, delta, stamp);
+        }
+        
+        if (messageCache.visit(key, visitor)) return true;
+        // 单个会话超出内存上限时不会留在缓存中
+        if (state != CACHE_MISSING && !fetchLatestMessages(db, user1, user2, isGroup, (int)messageCache.getWindow(), messages)) {
+            return false;
+        }
+    } else if (!fetchLatestMessages(db, user1, user2, isGroup, options.messageCacheWindow, messages)) {
+        return false;
+    }
+    
+    for (const auto& msg : messages) {
+        if (!visitor(viewOf(msg))) break;
+    }
+    return true;
+}
+
+std::vector<Database::RecentChat> Database::getRecentChats(const std::string& username, int limit, int offset,
+                                                           bool* hasMore) {
+    Metrics::getInstance()->countQuery(QUERY_RECENT);
+    if (offset < 0) offset = 0;
+    // 两个子查询各自只需排出前 offset + limit 条，多取一条用来判断是否还有下一页；负数表示不限
+    int needed = limit > 0 ? offset + limit + 1 : -1;
+    std::vector<RecentChat> privateChats;
+    std::vector<RecentChat> groupChats;
+    
+    // 获取私聊的最近消息：私聊只在好友之间进行，对每个好友沿 (sender, receiver, timestamp) 索引
+    // 两个方向各倒序取一条，取较新的一条；与私聊历史总量无关，排序只涉及好友数。
+    // 不加 INDEXED BY 时规划器可能改走 (receiver, is_group, timestamp)，要倒序读完对方收到的全部私聊
     std::string privateSql = R"(
         SELECT 
-            CASE 
-                WHEN sender = ? THEN receiver 
-                ELSE sender 
-            END as chat_partner,
-            content as last_message,
-            MAX(timestamp) as last_time,
+            f.partner as chat_partner,
+            m.content as last_message,
+            m.timestamp as last_time,
             0 as is_group
-        FROM messages 
-        WHERE (sender = ? OR receiver = ?) AND is_group = 0
-        GROUP BY chat_partner
+        FROM (
+            SELECT user2 as partner FROM friendships WHERE user1 = ?
+            UNION
+            SELECT user1 FROM friendships WHERE user2 = ?
+        ) f
+        INNER JOIN messages m ON m.id = (
+            SELECT id FROM (
+                SELECT id, timestamp FROM (
+                    SELECT id, timestamp FROM messages INDEXED BY idx_messages_sender
+                    WHERE sender = ? AND receiver = f.partner AND is_group = 0
+                    ORDER BY timestamp DESC, id DESC
+                    LIMIT 1
+                )
+                UNION ALL
+                SELECT id, timestamp FROM (
+                    SELECT id, timestamp FROM messages INDEXED BY idx_messages_sender
+                    WHERE sender = f.partner AND receiver = ? AND is_group = 0
+                    ORDER BY timestamp DESC, id DESC
+                    LIMIT 1
+                )
+            )
+            ORDER BY timestamp DESC, id DESC
+            LIMIT 1
+        )
         ORDER BY last_time DESC
+        LIMIT ?
     )";
     
     sqlite3_stmt* stmt;
@@ -450,6 +1448,8 @@ std::vector<Database::RecentChat> Database::getRecentChats(const std::string& us
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 3, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 5, needed);
         
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             RecentChat chat;
@@ -457,28 +1457,44 @@ std::vector<Database::RecentChat> Database::getRecentChats(const std::string& us
             chat.lastMessage = (char*)sqlite3_column_text(stmt, 1);
             chat.lastTime = (char*)sqlite3_column_text(stmt, 2);
             chat.isGroup = false;
-            recentChats.push_back(chat);
+            privateChats.push_back(chat);
         }
     }
     sqlite3_finalize(stmt);
     
-    // 获取群聊的最近消息 - 修复查询逻辑
+    // 获取群聊的最近消息：读扩散的群对每个所在群沿 (receiver, is_group, timestamp) 索引
+    // 倒序取一条，与群的消息数、成员数无关；写扩散的群直接按主键范围读取该用户的收件箱
     std::string groupSql = R"(
-        SELECT 
-            m.receiver as group_name,
-            m.content as last_message,
-            MAX(m.timestamp) as last_time,
-            1 as is_group
-        FROM messages m
-        INNER JOIN group_members gm ON m.receiver = gm.group_name
-        WHERE gm.username = ? AND m.is_group = 1
-        GROUP BY m.receiver
+        SELECT group_name, last_message, last_time, is_group FROM (
+            SELECT 
+                gm.group_name as group_name,
+                m.content as last_message,
+                m.timestamp as last_time,
+                1 as is_group
+            FROM group_members gm
+            INNER JOIN messages m ON m.id = (
+                SELECT id FROM messages
+                WHERE receiver = gm.group_name AND is_group = 1
+                ORDER BY timestamp DESC, id DESC
+                LIMIT 1
+            )
+            WHERE gm.username = ?
+              AND gm.group_name NOT IN (SELECT group_name FROM group_fanout)
+            UNION ALL
+            SELECT i.group_name, m.content, m.timestamp, 1
+            FROM group_inbox i
+            INNER JOIN messages m ON m.id = i.message_id
+            WHERE i.username = ?
+        )
         ORDER BY last_time DESC
+        LIMIT ?
     )";
     
     rc = sqlite3_prepare_v2(db, groupSql.c_str(), -1, &stmt, NULL);
     if (rc == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 3, needed);
         
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             RecentChat chat;
@@ -486,16 +1502,20 @@ std::vector<Database::RecentChat> Database::getRecentChats(const std::string& us
             chat.lastMessage = (char*)sqlite3_column_text(stmt, 1);
             chat.lastTime = (char*)sqlite3_column_text(stmt, 2);
             chat.isGroup = true;
-            recentChats.push_back(chat);
+            groupChats.push_back(chat);
         }
     }
     sqlite3_finalize(stmt);
     
-    // 按时间排序 - 确保最新的在前面
-    std::sort(recentChats.begin(), recentChats.end(), 
-              [](const RecentChat& a, const RecentChat& b) {
-                  return a.lastTime > b.lastTime;
-              });
-    
-    return recentChats;
+    // 两路结果都已按时间倒序，归并即可，无需整体排序
+    std::vector<RecentChat> merged(privateChats.size() + groupChats.size());
+    std::merge(privateChats.begin(), privateChats.end(), groupChats.begin(), groupChats.end(), merged.begin(),
+               [](const RecentChat& a, const RecentChat& b) {
+                   return a.lastTime > b.lastTime;
+               });
+    
+    size_t begin = std::min(merged.size(), (size_t)offset);
+    size_t end = limit > 0 ? std::min(merged.size(), begin + (size_t)limit) : merged.size();
+    if (hasMore) *hasMore = end < merged.size();
+    return std::vector<RecentChat>(merged.begin() + begin, merged.begin() + end);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ui.h"
+#include <cstdio>
 #include <iostream>
 #include <locale>
 
@@ -16,6 +17,10 @@ int main() {
         SetConsoleCP(CP_UTF8);
         SetConsoleOutputCP(CP_UTF8);
 
+#else
+        // 聊天窗口的事件循环直接 poll/read 描述符 0，
+        // 标准输入不能在 stdio 缓冲中预读，否则已到达的输入不会再触发可读
+        setvbuf(stdin, NULL, _IONBF, 0);
 #endif
         
         // 设置本地化 - 使用更安全的方式
@@ -0,0 +1,174 @@
+#include "metrics.h"
+#include "database.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+Metrics* Metrics::instance = nullptr;
+
+static const char* const kQueryTypeNames[QUERY_TYPE_COUNT] = {
+    "user", "friend", "group", "history", "send", "recent"
+};
+
+MetricsOptions::MetricsOptions() : path(""), intervalSec(15), renderStats(false) {}
+
+MetricsOptions MetricsOptions::fromEnvironment() {
+    MetricsOptions opts;
+    const char* value;
+
+    if ((value = std::getenv("OICQ_METRICS_FILE"))) opts.path = value;
+    if ((value = std::getenv("OICQ_METRICS_INTERVAL")) && *value) opts.intervalSec = std::atoi(value);
+    if (opts.intervalSec < 1) opts.intervalSec = 1;
+    if ((value = std::getenv("OICQ_RENDER_STATS")) && *value) opts.renderStats = std::atoi(value) != 0;
+
+    return opts;
+}
+
+Metrics::Metrics()
+    : refreshPolls(0), refreshUpdates(0), renderFrames(0), renderBytes(0), renderMicros(0), stopping(false) {
+    for (auto& counter : messagesSent) counter.store(0);
+    for (auto& counter : queries) counter.store(0);
+}
+
+Metrics* Metrics::getInstance() {
+    if (instance == nullptr) {
+        instance = new Metrics();
+    }
+    return instance;
+}
+
+static long long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long long)st.st_size : 0;
+}
+
+static void writeHeader(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+std::string Metrics::render() {
+    std::ostringstream out;
+
+    writeHeader(out, "oicq_messages_sent_total", "counter", "Messages saved by this process.");
+    out << "oicq_messages_sent_total{type=\"private\"} " << messagesSent[0].load(std::memory_order_relaxed) << "\n";
+    out << "oicq_messages_sent_total{type=\"group\"} " << messagesSent[1].load(std::memory_order_relaxed) << "\n";
+
+    writeHeader(out, "oicq_queries_total", "counter", "Database operations by type.");
+    for (int i = 0; i < QUERY_TYPE_COUNT; ++i) {
+        out << "oicq_queries_total{type=\"" << kQueryTypeNames[i] << "\"} "
+            << queries[i].load(std::memory_order_relaxed) << "\n";
+    }
+
+    writeHeader(out, "oicq_refresh_polls_total", "counter", "Chat window refresh polls.");
+    out << "oicq_refresh_polls_total " << refreshPolls.load(std::memory_order_relaxed) << "\n";
+    writeHeader(out, "oicq_refresh_updates_total", "counter", "Refresh polls that found new messages.");
+    out << "oicq_refresh_updates_total " << refreshUpdates.load(std::memory_order_relaxed) << "\n";
+
+    writeHeader(out, "oicq_render_frames_total", "counter", "Terminal frames rendered.");
+    out << "oicq_render_frames_total " << renderFrames.load(std::memory_order_relaxed) << "\n";
+    writeHeader(out, "oicq_render_bytes_total", "counter", "Bytes written to the terminal by the renderer.");
+    out << "oicq_render_bytes_total " << renderBytes.load(std::memory_order_relaxed) << "\n";
+    writeHeader(out, "oicq_render_seconds_total", "counter", "Time spent diffing and writing frames.");
+    out << "oicq_render_seconds_total " << renderMicros.load(std::memory_order_relaxed) / 1e6 << "\n";
+
+    // 页缓存与文件大小在导出时采样，不占用热路径
+    Database* db = Database::getInstance();
+    long long hits = 0, misses = 0;
+    db->getCacheStats(hits, misses);
+    writeHeader(out, "oicq_page_cache_hits_total", "counter", "SQLite page cache hits.");
+    out << "oicq_page_cache_hits_total " << hits << "\n";
+    writeHeader(out, "oicq_page_cache_misses_total", "counter", "SQLite page cache misses.");
+    out << "oicq_page_cache_misses_total " << misses << "\n";
+    writeHeader(out, "oicq_page_cache_hit_ratio", "gauge", "SQLite page cache hit ratio since open.");
+    out << "oicq_page_cache_hit_ratio " << (hits + misses > 0 ? (double)hits / (hits + misses) : 0.0) << "\n";
+
+    MessageCacheStats cache = db->getMessageCacheStats();
+    writeHeader(out, "oicq_message_cache_lookups_total", "counter", "Conversation cache lookups by result.");
+    out << "oicq_message_cache_lookups_total{result=\"hit\"} " << cache.hits << "\n";
+    out << "oicq_message_cache_lookups_total{result=\"delta\"} " << cache.deltaHits << "\n";
+    out << "oicq_message_cache_lookups_total{result=\"miss\"} " << cache.misses << "\n";
+    writeHeader(out, "oicq_message_cache_evictions_total", "counter", "Conversations evicted from the cache.");
+    out << "oicq_message_cache_evictions_total " << cache.evictions << "\n";
+    writeHeader(out, "oicq_message_cache_prefetches_total", "counter", "Conversations loaded by the background prefetcher.");
+    out << "oicq_message_cache_prefetches_total " << cache.prefetches << "\n";
+    writeHeader(out, "oicq_message_cache_prefetch_hits_total", "counter", "Prefetched conversations that were later opened.");
+    out << "oicq_message_cache_prefetch_hits_total " << cache.prefetchHits << "\n";
+    writeHeader(out, "oicq_message_cache_entries", "gauge", "Conversations currently cached.");
+    out << "oicq_message_cache_entries " << cache.entries << "\n";
+    writeHeader(out, "oicq_message_cache_bytes", "gauge", "Approximate memory held by the conversation cache.");
+    out << "oicq_message_cache_bytes " << cache.bytes << "\n";
+
+    const std::string& path = db->getOptions().path;
+    writeHeader(out, "oicq_db_size_bytes", "gauge", "Size of the database file.");
+    out << "oicq_db_size_bytes " << fileSize(path) << "\n";
+    writeHeader(out, "oicq_wal_size_bytes", "gauge", "Size of the write-ahead log file.");
+    out << "oicq_wal_size_bytes " << fileSize(path + "-wal") << "\n";
+
+    return out.str();
+}
+
+bool Metrics::writeFile(const std::string& path) {
+    std::string tmp = path + ".tmp";
+    FILE* file = std::fopen(tmp.c_str(), "w");
+    if (!file) return false;
+
+    std::string text = render();
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    // Windows 上 rename 不会覆盖已有文件
+    std::remove(path.c_str());
+#endif
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+void Metrics::startExporter(const MetricsOptions& opts) {
+    stopExporter();
+    options = opts;
+    if (options.path.empty()) return;
+
+    // 同一主机上多个会话各写一个文件
+    outputPath = options.path;
+    size_t pos = outputPath.find("%p");
+    if (pos != std::string::npos) {
+        outputPath.replace(pos, 2, std::to_string((long long)getpid()));
+    }
+
+    stopping = false;
+    exporter = std::thread(&Metrics::exportLoop, this);
+}
+
+void Metrics::exportLoop() {
+    std::unique_lock<std::mutex> lock(exporterMutex);
+    while (!stopping) {
+        lock.unlock();
+        writeFile(outputPath);
+        lock.lock();
+        exporterWake.wait_for(lock, std::chrono::seconds(options.intervalSec), [this] { return stopping; });
+    }
+}
+
+void Metrics::stopExporter() {
+    if (!exporter.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(exporterMutex);
+        stopping = true;
+    }
+    exporterWake.notify_all();
+    exporter.join();
+    std::remove(outputPath.c_str());
+}
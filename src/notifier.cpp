@@ -0,0 +1,95 @@
+#include "notifier.h"
+
+std::string MessageNotifier::conversationKey(const std::string& user1, const std::string& user2, bool isGroup) {
+    if (isGroup) {
+        return "g:" + user2;
+    }
+    // 用户名中不会出现的分隔符
+    return user1 < user2 ? "p:" + user1 + '\x1f' + user2 : "p:" + user2 + '\x1f' + user1;
+}
+
+MessageNotifier::Subscription* MessageNotifier::subscribe(const std::string& key, const std::string& ignoreSender,
+                                                          Listener listener) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscriptions.emplace_back();
+    Subscription& sub = subscriptions.back();
+    sub.key = key;
+    sub.ignoreSender = ignoreSender;
+    sub.resync = false;
+    sub.cancelled = false;
+    sub.listener = listener;
+    return &sub;
+}
+
+void MessageNotifier::unsubscribe(Subscription* sub) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it) {
+        if (&*it == sub) {
+            subscriptions.erase(it);
+            return;
+        }
+    }
+}
+
+void MessageNotifier::cancel(Subscription* sub) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sub->cancelled = true;
+        if (sub->listener) sub->listener();
+    }
+    sub->wake.notify_all();
+}
+
+bool MessageNotifier::hasSubscribers() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !subscriptions.empty();
+}
+
+NotifyResult MessageNotifier::wait(Subscription* sub, std::chrono::milliseconds timeout,
+                                   std::vector<MessageNotice>& notices, bool& resync) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto ready = [sub] { return sub->cancelled || sub->resync || !sub->notices.empty(); };
+    if (timeout.count() > 0) {
+        sub->wake.wait_for(lock, timeout, ready);
+    } else {
+        sub->wake.wait(lock, ready);
+    }
+
+    if (sub->cancelled) return NOTIFY_CANCELLED;
+    if (!sub->resync && sub->notices.empty()) return NOTIFY_TIMEOUT;
+    notices.clear();
+    notices.swap(sub->notices);
+    resync = sub->resync;
+    sub->resync = false;
+    return NOTIFY_MESSAGE;
+}
+
+bool MessageNotifier::take(Subscription* sub, std::vector<MessageNotice>& notices, bool& resync) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!sub->resync && sub->notices.empty()) return false;
+    notices.clear();
+    notices.swap(sub->notices);
+    resync = sub->resync;
+    sub->resync = false;
+    return true;
+}
+
+void MessageNotifier::publish(const MessageNotice& notice) {
+    std::string key = conversationKey(notice);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& sub : subscriptions) {
+        if (sub.key != key || notice.sender == sub.ignoreSender) continue;
+        sub.notices.push_back(notice);
+        sub.wake.notify_all();
+        if (sub.listener) sub.listener();
+    }
+}
+
+void MessageNotifier::publishResync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& sub : subscriptions) {
+        sub.resync = true;
+        sub.wake.notify_all();
+        if (sub.listener) sub.listener();
+    }
+}
@@ -0,0 +1,78 @@
+#include "prefetch.h"
+#include <string>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+Prefetcher::Prefetcher() : conn(nullptr), stopping(false) {}
+
+Prefetcher::~Prefetcher() {
+    stop();
+}
+
+bool Prefetcher::start(const std::string& path, long long mmapSize, Loader newLoader) {
+    stop();
+    if (path.empty() || path == ":memory:") return false;
+
+    // 只读连接不参与写锁竞争，WAL 模式下与写入方互不阻塞
+    if (sqlite3_open_v2(path.c_str(), &conn, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        sqlite3_close(conn);
+        conn = nullptr;
+        return false;
+    }
+    sqlite3_busy_timeout(conn, 1000);
+    std::string pragmas = "PRAGMA query_only = 1; PRAGMA mmap_size = " + std::to_string(mmapSize) + ";";
+    sqlite3_exec(conn, pragmas.c_str(), NULL, NULL, NULL);
+
+    loader = newLoader;
+    stopping = false;
+    worker = std::thread(&Prefetcher::run, this);
+    return true;
+}
+
+void Prefetcher::stop() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            queue.clear();
+        }
+        wake.notify_all();
+        worker.join();
+    }
+    if (conn) {
+        sqlite3_close(conn);
+        conn = nullptr;
+    }
+}
+
+void Prefetcher::submit(const std::vector<PrefetchTarget>& targets) {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // 倒序存放，从尾部取出即为原顺序
+        queue.assign(targets.rbegin(), targets.rend());
+    }
+    wake.notify_all();
+}
+
+void Prefetcher::run() {
+#ifdef __linux__
+    // Linux 上 nice 值按线程生效，前台操作优先获得 CPU
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) break;
+
+        PrefetchTarget target = queue.back();
+        queue.pop_back();
+        lock.unlock();
+        loader(conn, target);
+        lock.lock();
+    }
+}
@@ -0,0 +1,191 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+LatencyHistogram::LatencyHistogram()
+    : buckets((64 - kSubBucketBits + 1) * kSubBuckets, 0), total(0), sum(0), maxValue(0) {}
+
+int LatencyHistogram::bucketIndex(unsigned long long value) {
+    if (value < (unsigned long long)kSubBuckets) {
+        return (int)value;
+    }
+    // 最高位所在的 2 的幂区间，再取其后 kSubBucketBits 位作为子桶
+    int msb = 63;
+    while (!(value >> msb)) --msb;
+    int shift = msb - kSubBucketBits;
+    int sub = (int)((value >> shift) & (kSubBuckets - 1));
+    return (shift + 1) * kSubBuckets + sub;
+}
+
+unsigned long long LatencyHistogram::bucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+        return (unsigned long long)index;
+    }
+    int shift = index / kSubBuckets - 1;
+    unsigned long long sub = (unsigned long long)(index % kSubBuckets);
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(unsigned long long micros) {
+    buckets[bucketIndex(micros)]++;
+    total++;
+    sum += micros;
+    if (micros > maxValue) maxValue = micros;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += other.buckets[i];
+    total += other.total;
+    sum += other.sum;
+    if (other.maxValue > maxValue) maxValue = other.maxValue;
+}
+
+unsigned long long LatencyHistogram::percentile(double p) const {
+    if (total == 0) return 0;
+    unsigned long long rank = (unsigned long long)(p / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound((int)i), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+StatementStats::StatementStats()
+    : calls(0), fullScanSteps(0), vmSteps(0), sorts(0), autoIndexRows(0) {}
+
+QueryProfiler::QueryProfiler() : slowThresholdMs(0) {}
+
+void QueryProfiler::attach(sqlite3* db) {
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, traceCallback, this);
+}
+
+void QueryProfiler::setSlowLog(const std::string& path, double thresholdMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slowLog.is_open()) slowLog.close();
+    slowLogPath = path;
+    slowThresholdMs = thresholdMs;
+}
+
+int QueryProfiler::traceCallback(unsigned type, void* context, void* p, void* x) {
+    QueryProfiler* profiler = (QueryProfiler*)context;
+    if (type == SQLITE_TRACE_STMT) {
+        profiler->start((sqlite3_stmt*)p, (const char*)x);
+    } else if (type == SQLITE_TRACE_PROFILE) {
+        profiler->record((sqlite3_stmt*)p, *(sqlite3_int64*)x);
+    }
+    return 0;
+}
+
+void QueryProfiler::start(sqlite3_stmt* stmt, const char* text) {
+    // 触发器子程序也会触发 TRACE_STMT，此时 text 是 "-- TRIGGER ..." 注释而非语句本身
+    const char* sql = sqlite3_sql(stmt);
+    if (!sql || !text || std::strcmp(sql, text) != 0) return;
+    
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    running[stmt] = now;
+}
+
+void QueryProfiler::record(sqlite3_stmt* stmt, long long nanos) {
+    // 只使用未展开参数的 SQL 文本，避免密码等绑定值进入统计和日志
+    const char* sql = sqlite3_sql(stmt);
+    if (!sql) return;
+
+    // 读取后清零，语句对象被复用时每次执行单独计数
+    long long fullScan = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    long long vmSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+    long long sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    long long autoIndex = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+
+    Clock::time_point end = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto started = running.find(stmt);
+    if (started != running.end()) {
+        nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end - started->second).count();
+        running.erase(started);
+    }
+    
+    StatementStats& s = stats[sql];
+    if (s.calls == 0) s.sql = sql;
+    s.calls++;
+    s.fullScanSteps += fullScan;
+    s.vmSteps += vmSteps;
+    s.sorts += sorts;
+    s.autoIndexRows += autoIndex;
+    s.latency.record((unsigned long long)(nanos / 1000));
+
+    double ms = nanos / 1e6;
+    if (!slowLogPath.empty() && ms >= slowThresholdMs) {
+        writeSlowLog(sql, ms, fullScan, vmSteps);
+    }
+}
+
+void QueryProfiler::writeSlowLog(const char* sql, double ms, long long fullScanSteps, long long vmSteps) {
+    if (!slowLog.is_open()) {
+        slowLog.open(slowLogPath.c_str(), std::ios::app);
+        if (!slowLog.is_open()) return;
+    }
+
+    time_t now = time(NULL);
+    char timeBuf[20];
+    std::strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+    slowLog << "[" << timeBuf << "] " << ms << "ms fullscan=" << fullScanSteps
+            << " vm=" << vmSteps << " " << summarizeSql(sql) << std::endl;
+}
+
+std::vector<StatementStats> QueryProfiler::snapshot() const {
+    std::vector<StatementStats> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : stats) {
+            result.push_back(entry.second);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const StatementStats& a, const StatementStats& b) {
+        return a.latency.totalMicros() > b.latency.totalMicros();
+    });
+    return result;
+}
+
+void QueryProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.clear();
+}
+
+std::string QueryProfiler::summarizeSql(const std::string& sql, size_t maxBytes) {
+    std::string result;
+    bool space = false;
+    size_t i = 0;
+    
+    while (i < sql.size()) {
+        char c = sql[i];
+        if (result.empty() && c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            // 跳过语句开头的整行注释
+            size_t eol = sql.find('\n', i);
+            i = eol == std::string::npos ? sql.size() : eol + 1;
+            continue;
+        }
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+            space = !result.empty();
+        } else {
+            if (space) result += ' ';
+            result += c;
+            space = false;
+        }
+        ++i;
+    }
+    
+    if (maxBytes > 3 && result.size() > maxBytes) {
+        size_t cut = maxBytes - 3;
+        while (cut > 0 && ((unsigned char)result[cut] & 0xC0) == 0x80) --cut;
+        result = result.substr(0, cut) + "...";
+    }
+    return result;
+}
@@ -0,0 +1,457 @@
+#include "protocol.h"
+#include <cstring>
+
+namespace protocol {
+
+// 消息与最近聊天条目的标志位
+static const uint8_t kFlagGroup = 0x01;
+static const uint8_t kFlagSameSender = 0x02;
+static const uint8_t kFlagSameReceiver = 0x04;
+static const uint8_t kFlagRawTime = 0x08;
+static const uint8_t kMessageFlags = kFlagGroup | kFlagSameSender | kFlagSameReceiver | kFlagRawTime;
+static const uint8_t kChatFlags = kFlagGroup | kFlagRawTime;
+
+// 差值在无符号域中累加，损坏的输入不会触发有符号溢出
+static long long addDelta(long long base, int64_t delta) {
+    return (long long)((uint64_t)base + (uint64_t)delta);
+}
+
+FrameStatus peekFrame(const char* data, size_t size, size_t maxBody,
+                      const char*& body, size_t& bodySize, size_t& frameSize) {
+    uint64_t length = 0;
+    size_t header = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (header >= size) return FRAME_INCOMPLETE;
+        // 上限远小于 2^63，超过 9 个字节的前缀必然非法
+        if (header >= 9) return FRAME_INVALID;
+        uint8_t byte = (uint8_t)data[header++];
+        length |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    if (length == 0 || length > maxBody) return FRAME_INVALID;
+    if (size - header < length) return FRAME_INCOMPLETE;
+    body = data + header;
+    bodySize = (size_t)length;
+    frameSize = header + (size_t)length;
+    return FRAME_OK;
+}
+
+bool Reader::readByte(uint8_t& value) {
+    if (!valid || p == end) return fail();
+    value = *p++;
+    return true;
+}
+
+bool Reader::readVarint(uint64_t& value) {
+    if (!valid) return false;
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return fail();
+        uint8_t byte = *p++;
+        // 第 10 个字节只能携带最高位
+        if (shift == 63 && byte > 1) return fail();
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return fail();
+}
+
+bool Reader::readSigned(int64_t& value) {
+    uint64_t raw;
+    if (!readVarint(raw)) return false;
+    value = (int64_t)((raw >> 1) ^ (~(raw & 1) + 1));
+    return true;
+}
+
+bool Reader::readText(TextView& value) {
+    uint64_t size;
+    if (!readVarint(size)) return false;
+    if (size > (uint64_t)(end - p)) return fail();
+    value.data = (const char*)p;
+    value.size = (int)size;
+    p += size;
+    return true;
+}
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+void putSigned(std::string& out, int64_t value) {
+    putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void putText(std::string& out, const char* data, size_t size) {
+    putVarint(out, size);
+    out.append(data, size);
+}
+
+size_t beginFrame(std::string& out, Opcode op) {
+    size_t start = out.size();
+    // 大多数帧不足 128 字节，一个字节的前缀无需移动正文
+    out += '\0';
+    out += (char)op;
+    return start;
+}
+
+void endFrame(std::string& out, size_t start) {
+    size_t length = out.size() - start - 1;
+    if (length < 0x80) {
+        out[start] = (char)length;
+        return;
+    }
+    std::string header;
+    putVarint(header, length);
+    out.replace(start, 1, header);
+}
+
+void encodeStatus(std::string& out, Opcode op) {
+    size_t start = beginFrame(out, op);
+    endFrame(out, start);
+}
+
+void encodeError(std::string& out, const std::string& reason) {
+    size_t start = beginFrame(out, OP_ERR);
+    putText(out, reason.data(), reason.size());
+    endFrame(out, start);
+}
+
+void encodeRequest(std::string& out, const Request& request) {
+    size_t start = beginFrame(out, request.op);
+    switch (request.op) {
+        case OP_REGISTER:
+        case OP_LOGIN:
+            putText(out, request.text1.data, request.text1.size);
+            putText(out, request.text2.data, request.text2.size);
+            break;
+        case OP_FRIEND:
+        case OP_CREATE_GROUP:
+        case OP_JOIN_GROUP:
+            putText(out, request.text1.data, request.text1.size);
+            break;
+        case OP_SEND:
+            putText(out, request.text1.data, request.text1.size);
+            out += (char)(request.isGroup ? 1 : 0);
+            putText(out, request.text2.data, request.text2.size);
+            break;
+        case OP_HISTORY:
+            putText(out, request.text1.data, request.text1.size);
+            out += (char)(request.isGroup ? 1 : 0);
+            putSigned(out, request.number1);
+            break;
+        case OP_RECENT:
+            putSigned(out, request.number1);
+            putSigned(out, request.number2);
+            break;
+        case OP_WATCH:
+            putText(out, request.text1.data, request.text1.size);
+            out += (char)(request.isGroup ? 1 : 0);
+            break;
+        default:
+            break;
+    }
+    endFrame(out, start);
+}
+
+static bool readFlag(Reader& reader, bool& value) {
+    uint8_t byte;
+    if (!reader.readByte(byte)) return false;
+    if (byte > 1) return reader.fail();
+    value = byte == 1;
+    return true;
+}
+
+static bool readNumber(Reader& reader, long long& value) {
+    int64_t raw;
+    if (!reader.readSigned(raw)) return false;
+    value = (long long)raw;
+    return true;
+}
+
+bool decodeRequest(const char* body, size_t size, Request& request) {
+    Reader reader(body, size);
+    uint8_t op;
+    if (!reader.readByte(op)) return false;
+
+    request.op = (Opcode)op;
+    request.text1.data = request.text2.data = "";
+    request.text1.size = request.text2.size = 0;
+    request.isGroup = false;
+    request.number1 = request.number2 = 0;
+
+    switch (op) {
+        case OP_PING:
+        case OP_UNWATCH:
+        case OP_QUIT:
+            break;
+        case OP_REGISTER:
+        case OP_LOGIN:
+            reader.readText(request.text1) && reader.readText(request.text2);
+            break;
+        case OP_FRIEND:
+        case OP_CREATE_GROUP:
+        case OP_JOIN_GROUP:
+            reader.readText(request.text1);
+            break;
+        case OP_SEND:
+            reader.readText(request.text1) && readFlag(reader, request.isGroup) && reader.readText(request.text2);
+            break;
+        case OP_HISTORY:
+            reader.readText(request.text1) && readFlag(reader, request.isGroup) && readNumber(reader, request.number1);
+            break;
+        case OP_RECENT:
+            readNumber(reader, request.number1) && readNumber(reader, request.number2);
+            break;
+        case OP_WATCH:
+            reader.readText(request.text1) && readFlag(reader, request.isGroup);
+            break;
+        default:
+            return false;
+    }
+    return reader.ok() && reader.atEnd();
+}
+
+// 公历日期与 1970-01-01 起天数互转（proleptic Gregorian）
+static long long daysFromCivil(long long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+static void civilFromDays(long long z, long long& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    y = (long long)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y += m <= 2;
+}
+
+static bool readDigits(const char* text, int count, unsigned& value) {
+    value = 0;
+    for (int i = 0; i < count; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        value = value * 10 + (unsigned)(text[i] - '0');
+    }
+    return true;
+}
+
+static void writeDigits(char* out, unsigned value, int count) {
+    for (int i = count - 1; i >= 0; --i) {
+        out[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// 0000-01-01 00:00:00 与 9999-12-31 23:59:59
+static const long long kMinSeconds = -62167219200LL;
+static const long long kMaxSeconds = 253402300799LL;
+
+bool parseTimestamp(const char* text, size_t size, long long& seconds) {
+    if (size != 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+    unsigned year, month, day, hour, minute, second;
+    if (!readDigits(text, 4, year) || !readDigits(text + 5, 2, month) || !readDigits(text + 8, 2, day) ||
+        !readDigits(text + 11, 2, hour) || !readDigits(text + 14, 2, minute) || !readDigits(text + 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) return false;
+    seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+
+    // 2 月 30 日之类会被换算到下个月，还原后不一致的按原文传输，保证无损
+    char check[20];
+    formatTimestamp(seconds, check);
+    return std::memcmp(check, text, 19) == 0;
+}
+
+void formatTimestamp(long long seconds, char* out) {
+    if (seconds < kMinSeconds) seconds = kMinSeconds;
+    if (seconds > kMaxSeconds) seconds = kMaxSeconds;
+    long long days = seconds / 86400;
+    long long rest = seconds % 86400;
+    if (rest < 0) {
+        rest += 86400;
+        --days;
+    }
+    long long year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    writeDigits(out, (unsigned)year, 4);
+    out[4] = '-';
+    writeDigits(out + 5, month, 2);
+    out[7] = '-';
+    writeDigits(out + 8, day, 2);
+    out[10] = ' ';
+    writeDigits(out + 11, (unsigned)(rest / 3600), 2);
+    out[13] = ':';
+    writeDigits(out + 14, (unsigned)(rest / 60 % 60), 2);
+    out[16] = ':';
+    writeDigits(out + 17, (unsigned)(rest % 60), 2);
+    out[19] = '\0';
+}
+
+// 写入时间：可还原的时间写差值，否则写原文并在 flagOffset 处的标志字节上置位
+static void putTime(std::string& out, const TextView& timestamp, long long& lastTime, size_t flagOffset) {
+    long long seconds;
+    if (parseTimestamp(timestamp.data, (size_t)timestamp.size, seconds)) {
+        putSigned(out, (int64_t)((uint64_t)seconds - (uint64_t)lastTime));
+        lastTime = seconds;
+        return;
+    }
+    putText(out, timestamp.data, (size_t)timestamp.size);
+    out[flagOffset] = (char)(out[flagOffset] | kFlagRawTime);
+}
+
+// 原文时间不参与差值，下一条仍相对上一个可还原的时间
+static bool readTime(Reader& reader, bool raw, long long& lastTime, long long& time, TextView& rawTime) {
+    if (raw) {
+        time = 0;
+        return reader.readText(rawTime);
+    }
+    int64_t delta;
+    if (!reader.readSigned(delta)) return false;
+    time = lastTime = addDelta(lastTime, delta);
+    rawTime.data = nullptr;
+    rawTime.size = 0;
+    return true;
+}
+
+MessageBatchWriter::MessageBatchWriter(std::string& out, Opcode op)
+    : out(out), lastId(0), lastTime(0), senderOffset(0), senderSize(0),
+      receiverOffset(0), receiverSize(0), hasLast(false) {
+    start = beginFrame(out, op);
+    moreOffset = out.size();
+    out += '\0';
+}
+
+void MessageBatchWriter::add(const MessageView& msg) {
+    size_t senderLen = (size_t)msg.sender.size;
+    size_t receiverLen = (size_t)msg.receiver.size;
+    bool sameSender = hasLast && senderLen == senderSize &&
+                      std::memcmp(out.data() + senderOffset, msg.sender.data, senderLen) == 0;
+    bool sameReceiver = hasLast && receiverLen == receiverSize &&
+                        std::memcmp(out.data() + receiverOffset, msg.receiver.data, receiverLen) == 0;
+
+    size_t flagOffset = out.size();
+    out += (char)((msg.isGroup ? kFlagGroup : 0) | (sameSender ? kFlagSameSender : 0) |
+                  (sameReceiver ? kFlagSameReceiver : 0));
+    putSigned(out, (int64_t)((uint64_t)(long long)msg.id - (uint64_t)lastId));
+    lastId = msg.id;
+    if (!sameSender) {
+        putVarint(out, senderLen);
+        senderOffset = out.size();
+        senderSize = senderLen;
+        out.append(msg.sender.data, senderLen);
+    }
+    if (!sameReceiver) {
+        putVarint(out, receiverLen);
+        receiverOffset = out.size();
+        receiverSize = receiverLen;
+        out.append(msg.receiver.data, receiverLen);
+    }
+    putTime(out, msg.timestamp, lastTime, flagOffset);
+    putText(out, msg.content.data, (size_t)msg.content.size);
+    hasLast = true;
+}
+
+void MessageBatchWriter::finish(bool more) {
+    out[moreOffset] = (char)(more ? 1 : 0);
+    endFrame(out, start);
+}
+
+MessageBatchReader::MessageBatchReader(const char* body, size_t size)
+    : reader(body, size), lastTime(0), hasLast(false), more(false) {
+    last.id = 0;
+    readFlag(reader, more);
+}
+
+bool MessageBatchReader::next(WireMessage& msg) {
+    if (!reader.ok() || reader.atEnd()) return false;
+
+    uint8_t flags;
+    int64_t idDelta;
+    if (!reader.readByte(flags) || !reader.readSigned(idDelta)) return false;
+    if ((flags & ~kMessageFlags) || (!hasLast && (flags & (kFlagSameSender | kFlagSameReceiver)))) {
+        return reader.fail();
+    }
+
+    last.id = addDelta(last.id, idDelta);
+    last.isGroup = (flags & kFlagGroup) != 0;
+    if (!(flags & kFlagSameSender) && !reader.readText(last.sender)) return false;
+    if (!(flags & kFlagSameReceiver) && !reader.readText(last.receiver)) return false;
+    if (!readTime(reader, (flags & kFlagRawTime) != 0, lastTime, last.time, last.rawTime) ||
+        !reader.readText(last.content)) {
+        return false;
+    }
+
+    hasLast = true;
+    msg = last;
+    return true;
+}
+
+ChatBatchWriter::ChatBatchWriter(std::string& out, bool hasMore) : out(out), lastTime(0) {
+    start = beginFrame(out, OP_CHATS);
+    out += (char)(hasMore ? 1 : 0);
+}
+
+void ChatBatchWriter::add(const TextView& name, bool isGroup, const TextView& lastTimeText,
+                          const TextView& lastMessage) {
+    size_t flagOffset = out.size();
+    out += (char)(isGroup ? kFlagGroup : 0);
+    putText(out, name.data, (size_t)name.size);
+    putTime(out, lastTimeText, lastTime, flagOffset);
+    putText(out, lastMessage.data, (size_t)lastMessage.size);
+}
+
+void ChatBatchWriter::finish() {
+    endFrame(out, start);
+}
+
+ChatBatchReader::ChatBatchReader(const char* body, size_t size) : reader(body, size), lastTime(0), more(false) {
+    readFlag(reader, more);
+}
+
+bool ChatBatchReader::next(WireChat& chat) {
+    if (!reader.ok() || reader.atEnd()) return false;
+
+    uint8_t flags;
+    if (!reader.readByte(flags)) return false;
+    if (flags & ~kChatFlags) return reader.fail();
+    chat.isGroup = (flags & kFlagGroup) != 0;
+    return reader.readText(chat.name) &&
+           readTime(reader, (flags & kFlagRawTime) != 0, lastTime, chat.time, chat.rawTime) &&
+           reader.readText(chat.lastMessage);
+}
+
+std::string timeText(long long time, const TextView& rawTime) {
+    if (rawTime.data) return rawTime.str();
+    char buffer[20];
+    formatTimestamp(time, buffer);
+    return std::string(buffer, 19);
+}
+
+Message toMessage(const WireMessage& msg) {
+    Message result;
+    result.id = (int)msg.id;
+    result.sender = msg.sender.str();
+    result.receiver = msg.receiver.str();
+    result.content = msg.content.str();
+    result.timestamp = timeText(msg.time, msg.rawTime);
+    result.isGroup = msg.isGroup;
+    return result;
+}
+
+}  // namespace protocol
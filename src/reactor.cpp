@@ -0,0 +1,269 @@
+#include "reactor.h"
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+Reactor::Reactor() : inputOpen(false), running(false), wakeRead(-1), wakeWrite(-1) {
+#ifdef _WIN32
+    woken = false;
+    inputEof = false;
+    lineHandled = true;
+#elif defined(__linux__)
+    wakeRead = wakeWrite = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    int fds[2];
+    if (pipe(fds) == 0) {
+        for (int i = 0; i < 2; ++i) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        wakeRead = fds[0];
+        wakeWrite = fds[1];
+    }
+#endif
+}
+
+Reactor::~Reactor() {
+#ifdef _WIN32
+    if (inputThread.joinable()) inputThread.join();
+#else
+    if (wakeRead >= 0) close(wakeRead);
+    if (wakeWrite >= 0 && wakeWrite != wakeRead) close(wakeWrite);
+#endif
+}
+
+int Reactor::addEvent(Task handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(handler);
+    pending.push_back(false);
+    return (int)events.size() - 1;
+}
+
+void Reactor::signal(int event) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending[event]) return;     // 已有一次唤醒在途
+        pending[event] = true;
+    }
+    notifyLoop();
+}
+
+void Reactor::addTimer(int intervalMs, Task task) {
+    Timer timer;
+    timer.interval = std::chrono::milliseconds(intervalMs);
+    timer.due = std::chrono::steady_clock::now() + timer.interval;
+    timer.task = task;
+    timers.push_back(timer);
+}
+
+void Reactor::watchInput(LineHandler lineHandler, Task eofHandler) {
+    onLine = lineHandler;
+    onEof = eofHandler;
+    inputOpen = true;
+}
+
+void Reactor::dispatchEvents() {
+    std::vector<int> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (!pending[i]) continue;
+            pending[i] = false;
+            ready.push_back((int)i);
+        }
+    }
+    for (int event : ready) {
+        if (!running) return;
+        events[event]();
+    }
+}
+
+void Reactor::runTimers() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& timer : timers) {
+        if (!running) return;
+        if (timer.due > now) continue;
+        timer.due = now + timer.interval;
+        timer.task();
+    }
+}
+
+int Reactor::nextTimeout() const {
+    if (timers.empty()) return -1;
+    auto now = std::chrono::steady_clock::now();
+    auto next = timers[0].due;
+    for (const auto& timer : timers) {
+        if (timer.due < next) next = timer.due;
+    }
+    if (next <= now) return 0;
+    // 向上取整，避免提前醒来空转一次
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() + 1;
+}
+
+#ifndef _WIN32
+
+void Reactor::notifyLoop() {
+    // 写满或被打断都无妨：只要描述符可读，事件循环就会醒来检查 pending
+#ifdef __linux__
+    unsigned long long one = 1;
+    ssize_t n = write(wakeWrite, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t n = write(wakeWrite, &one, sizeof(one));
+#endif
+    (void)n;
+}
+
+void Reactor::drainWakeup() {
+    char buffer[64];
+    while (read(wakeRead, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+void Reactor::readInput() {
+    // 逐字节读到行尾：不越过当前行多读，离开聊天窗口后剩余的输入仍留给后续菜单
+    int available = 0;
+    if (ioctl(STDIN_FILENO, FIONREAD, &available) != 0 || available < 1) available = 1;
+
+    for (int i = 0; i < available && running; ++i) {
+        char c;
+        ssize_t n = read(STDIN_FILENO, &c, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        if (n <= 0) {
+            // 读错误也按输入结束处理，否则 poll 会一直报告就绪
+            inputOpen = false;
+            if (onEof) onEof();
+            return;
+        }
+        if (c != '\n') {
+            inputBuffer += c;
+            continue;
+        }
+        std::string line;
+        line.swap(inputBuffer);
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        onLine(line);
+    }
+}
+
+void Reactor::run() {
+    running = true;
+    // 菜单输出可能还在流缓冲中
+    std::cout.flush();
+
+    while (running) {
+        struct pollfd fds[2];
+        nfds_t count = 0;
+        fds[count].fd = wakeRead;
+        fds[count].events = POLLIN;
+        fds[count++].revents = 0;
+        if (inputOpen) {
+            fds[count].fd = STDIN_FILENO;
+            fds[count].events = POLLIN;
+            fds[count++].revents = 0;
+        }
+
+        int ready = poll(fds, count, nextTimeout());
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) drainWakeup();
+        dispatchEvents();
+        if (running && count > 1 && fds[1].revents) readInput();
+        if (running) runTimers();
+    }
+}
+
+#else
+
+void Reactor::notifyLoop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        woken = true;
+    }
+    wakeup.notify_all();
+}
+
+void Reactor::drainWakeup() {}
+void Reactor::readInput() {}
+
+// 读行线程每次只交出一行，等事件循环处理完再读下一行：
+// 回调调用 stop() 后线程随即退出，不会吞掉属于后续菜单的输入
+void Reactor::readLines() {
+    std::string line;
+    while (true) {
+        bool ok = (bool)std::getline(std::cin, line);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (ok) {
+            lines.push_back(line);
+            lineHandled = false;
+        } else {
+            inputEof = true;
+        }
+        woken = true;
+        wakeup.notify_all();
+        if (!ok) return;
+        wakeup.wait(lock, [this] { return lineHandled || !running; });
+        if (!running) return;
+    }
+}
+
+void Reactor::run() {
+    running = true;
+    std::cout.flush();
+    if (inputOpen && !inputThread.joinable()) {
+        inputThread = std::thread(&Reactor::readLines, this);
+    }
+
+    while (running) {
+        std::vector<std::string> input;
+        bool eof = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            int timeout = nextTimeout();
+            auto ready = [this] { return woken; };
+            if (timeout < 0) {
+                wakeup.wait(lock, ready);
+            } else {
+                wakeup.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+            }
+            woken = false;
+            input.swap(lines);
+            eof = inputEof && inputOpen;
+            if (eof) inputOpen = false;
+        }
+
+        dispatchEvents();
+        for (const auto& line : input) {
+            if (!running) break;
+            onLine(line);
+        }
+        if (running && eof && onEof) onEof();
+        if (!input.empty()) {
+            // 放行读行线程；若已 stop() 则让它退出
+            std::lock_guard<std::mutex> lock(mutex);
+            lineHandled = true;
+            wakeup.notify_all();
+        }
+        if (running) runTimers();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeup.notify_all();
+    }
+    if (inputThread.joinable()) inputThread.join();
+}
+
+#endif
@@ -0,0 +1,360 @@
+#include "ring.h"
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+SharedRing::SharedRing()
+    : header(nullptr), slots(nullptr), mappedSize(0), pid(0), fd(-1), stalled(false), stalledCursor(0),
+      stalledSinceMs(0) {}
+
+SharedRing::~SharedRing() {
+    close();
+}
+
+#ifdef __linux__
+
+static const unsigned int kRingMagic = 0x4f494351;     // "OICQ"
+static const unsigned int kRingVersion = 2;
+
+struct SharedRing::Header {
+    std::atomic<unsigned int> magic;    // 创建方初始化完成后最后写入
+    unsigned int version;
+    unsigned int capacity;
+    unsigned int slotSize;
+    std::atomic<unsigned long long> head;       // 下一个待领取的序号
+    std::atomic<unsigned int> wake;             // futex 唤醒字，每完成一条通知加一
+    std::atomic<unsigned int> waiters;          // 正在 futex 上等待的线程数，为 0 时写入方省去系统调用
+    unsigned int attached;                      // 附加的进程数，持有段文件的 flock 时读写
+    char padding[60];
+};
+
+// 槽位内容按固定长度存放，名字放不下时只能让读取方回数据库
+struct SlotData {
+    long long messageId;
+    int pid;
+    unsigned char isGroup;
+    unsigned char complete;
+    unsigned char overflow;
+    unsigned char senderLen;
+    unsigned char receiverLen;
+    unsigned char timestampLen;
+    unsigned short contentLen;
+    char sender[32];
+    char receiver[64];
+    char timestamp[24];
+    char content[256];
+};
+
+struct SharedRing::Slot {
+    std::atomic<unsigned long long> version;    // 2*序号+1 写入中，2*序号+2 已完成
+    SlotData data;
+};
+
+static_assert(sizeof(std::atomic<unsigned int>) == sizeof(int), "futex word must be 32 bits");
+
+static long futex(std::atomic<unsigned int>* word, int op, unsigned int value, const struct timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<int*>(word), op, value, timeout, NULL, 0);
+}
+
+// 按 UTF-8 字符边界截断复制，返回复制的字节数
+static size_t copyText(char* dest, size_t capacity, const std::string& text) {
+    size_t len = text.size();
+    if (len > capacity) {
+        len = capacity;
+        while (len > 0 && ((unsigned char)text[len] & 0xC0) == 0x80) --len;
+    }
+    std::memcpy(dest, text.data(), len);
+    return len;
+}
+
+static long long steadyMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool SharedRing::open(const std::string& dbPath) {
+    close();
+
+    // 同一数据库文件的所有进程共用一个段，不同数据库互不干扰
+    char resolved[PATH_MAX];
+    struct stat dbStat;
+    if (!realpath(dbPath.c_str(), resolved) || stat(resolved, &dbStat) != 0) return false;
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char* p = resolved; *p; ++p) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    char path[64];
+    std::snprintf(path, sizeof(path), "/dev/shm/oicq-%016llx.ring", hash);
+    // 与数据库文件相同的访问权限，能打开数据库的用户都能使用通知环
+    mode_t mode = dbStat.st_mode & 0666;
+
+    size_t size = sizeof(Header) + (size_t)kCapacity * sizeof(Slot);
+    int file = -1;
+    bool creator = false;
+    // 段可能在打开和加锁之间被最后一个分离的进程删除，此时重新打开
+    for (int attempt = 0; attempt < 3 && file < 0; ++attempt) {
+        creator = true;
+        file = ::open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (file < 0) {
+            if (errno != EEXIST) return false;
+            creator = false;
+            file = ::open(path, O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+            if (file < 0) continue;
+        }
+
+        struct stat st;
+        if (!creator) {
+            // 创建方可能还没来得及加锁
+            for (int i = 0; i < 100 && fstat(file, &st) == 0 && (size_t)st.st_size != size; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if (flock(file, LOCK_EX) != 0) {
+            ::close(file);
+            return false;
+        }
+        if (creator) {
+            if (fchmod(file, mode) != 0 || ftruncate(file, (off_t)size) != 0) {
+                unlink(path);
+                ::close(file);
+                return false;
+            }
+        } else {
+            struct stat linked;
+            if (fstat(file, &st) != 0 || st.st_nlink == 0 || stat(path, &linked) != 0 ||
+                linked.st_ino != st.st_ino || linked.st_dev != st.st_dev) {
+                ::close(file);
+                file = -1;
+                continue;
+            }
+            // /dev/shm 所有用户可写：拒绝别人预先创建或权限放宽过的段，否则对方可读取和伪造通知
+            if (!S_ISREG(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 0777 & ~mode) != 0 ||
+                (size_t)st.st_size != size) {
+                ::close(file);
+                return false;
+            }
+        }
+    }
+    if (file < 0) return false;
+
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (memory == MAP_FAILED) {
+        if (creator) unlink(path);
+        ::close(file);
+        return false;
+    }
+
+    Header* h = (Header*)memory;
+    if (creator) {
+        // ftruncate 后内容全为 0，计数器无需再初始化
+        h->version = kRingVersion;
+        h->capacity = kCapacity;
+        h->slotSize = sizeof(Slot);
+        h->magic.store(kRingMagic, std::memory_order_release);
+    } else if (h->magic.load(std::memory_order_acquire) != kRingMagic || h->version != kRingVersion ||
+               h->capacity != kCapacity || h->slotSize != sizeof(Slot)) {
+        munmap(memory, size);
+        ::close(file);
+        return false;
+    }
+    h->attached++;
+    flock(file, LOCK_UN);
+
+    header = h;
+    slots = (Slot*)((char*)memory + sizeof(Header));
+    mappedSize = size;
+    pid = (int)getpid();
+    fd = file;
+    name = path;
+    stalled = false;
+    return true;
+}
+
+void SharedRing::close() {
+    if (header) {
+        // 最后一个分离的进程删除段；加锁期间新的附加方要么已计入，要么会发现段已删除而重新创建
+        flock(fd, LOCK_EX);
+        if (--header->attached == 0) unlink(name.c_str());
+        flock(fd, LOCK_UN);
+        munmap(header, mappedSize);
+        ::close(fd);
+        header = nullptr;
+        slots = nullptr;
+        mappedSize = 0;
+        fd = -1;
+        name.clear();
+    }
+}
+
+void SharedRing::publish(const MessageNotice& notice) {
+    if (!header) return;
+
+    unsigned long long ticket = header->head.fetch_add(1);
+    Slot& slot = slots[ticket % kCapacity];
+    slot.version.store(2 * ticket + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    SlotData& data = slot.data;
+    data.messageId = notice.id;
+    data.pid = pid;
+    data.isGroup = notice.isGroup ? 1 : 0;
+    data.overflow = notice.sender.size() > sizeof(data.sender) ||
+                    notice.receiver.size() > sizeof(data.receiver) ||
+                    notice.timestamp.size() > sizeof(data.timestamp);
+    data.senderLen = (unsigned char)copyText(data.sender, sizeof(data.sender), notice.sender);
+    data.receiverLen = (unsigned char)copyText(data.receiver, sizeof(data.receiver), notice.receiver);
+    data.timestampLen = (unsigned char)copyText(data.timestamp, sizeof(data.timestamp), notice.timestamp);
+    // 超长内容只放预览，读取方需要时回数据库读全文
+    data.contentLen = (unsigned short)copyText(data.content, sizeof(data.content), notice.content);
+    data.complete = notice.complete && data.contentLen == notice.content.size();
+
+    slot.version.store(2 * ticket + 2, std::memory_order_release);
+
+    header->wake.fetch_add(1);
+    if (header->waiters.load() > 0) {
+        futex(&header->wake, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+void SharedRing::read(unsigned long long& cursor, std::vector<MessageNotice>& notices, bool& lost) {
+    lost = false;
+    if (!header) return;
+
+    unsigned long long head = header->head.load(std::memory_order_acquire);
+    if (head > cursor + kCapacity) {
+        // 落后超过一圈，最旧的通知已被覆盖
+        lost = true;
+        cursor = head - kCapacity;
+    }
+
+    while (cursor < head) {
+        Slot& slot = slots[cursor % kCapacity];
+        unsigned long long expected = 2 * cursor + 2;
+        unsigned long long before = slot.version.load(std::memory_order_acquire);
+
+        if (before < expected) {
+            // 写入方还没写完；落后很多或等待超时仍未完成说明写入进程已退出，跳过该槽位
+            if (head - cursor <= kCapacity / 2 && !stallExpired(cursor)) break;
+            lost = true;
+            ++cursor;
+            continue;
+        }
+        if (before > expected) {
+            lost = true;
+            ++cursor;
+            continue;
+        }
+
+        // 乐观复制后再次检查版本，期间被覆盖则丢弃
+        SlotData data;
+        std::memcpy(&data, &slot.data, sizeof(data));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != expected) {
+            lost = true;
+            ++cursor;
+            continue;
+        }
+        ++cursor;
+
+        if (data.pid == pid) continue;
+        if (data.overflow) {
+            lost = true;
+            continue;
+        }
+
+        MessageNotice notice;
+        notice.id = data.messageId;
+        notice.sender.assign(data.sender, data.senderLen);
+        notice.receiver.assign(data.receiver, data.receiverLen);
+        notice.timestamp.assign(data.timestamp, data.timestampLen);
+        notice.content.assign(data.content, data.contentLen);
+        notice.isGroup = data.isGroup != 0;
+        notice.complete = data.complete != 0;
+        notices.push_back(notice);
+    }
+    if (stalled && cursor != stalledCursor) stalled = false;
+}
+
+bool SharedRing::stallExpired(unsigned long long cursor) {
+    long long now = steadyMillis();
+    if (!stalled || stalledCursor != cursor) {
+        stalled = true;
+        stalledCursor = cursor;
+        stalledSinceMs = now;
+        return false;
+    }
+    return now - stalledSinceMs >= kStalledSlotMs;
+}
+
+unsigned long long SharedRing::head() const {
+    return header ? header->head.load(std::memory_order_acquire) : 0;
+}
+
+unsigned int SharedRing::wakeWord() const {
+    return header ? header->wake.load() : 0;
+}
+
+void SharedRing::wait(unsigned int word, int timeoutMs) {
+    if (!header) return;
+
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+
+    // 先登记再检查唤醒字：写入方要么看到等待者，要么唤醒字已变化使 FUTEX_WAIT 立即返回
+    header->waiters.fetch_add(1);
+    futex(&header->wake, FUTEX_WAIT, word, timeoutMs > 0 ? &timeout : NULL);
+    header->waiters.fetch_sub(1);
+}
+
+void SharedRing::wakeAll() {
+    if (!header) return;
+    header->wake.fetch_add(1);
+    futex(&header->wake, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+#else
+
+bool SharedRing::open(const std::string&) {
+    return false;
+}
+
+void SharedRing::close() {}
+void SharedRing::publish(const MessageNotice&) {}
+
+void SharedRing::read(unsigned long long&, std::vector<MessageNotice>&, bool& lost) {
+    lost = false;
+}
+
+bool SharedRing::stallExpired(unsigned long long) {
+    return true;
+}
+
+unsigned long long SharedRing::head() const {
+    return 0;
+}
+
+unsigned int SharedRing::wakeWord() const {
+    return 0;
+}
+
+void SharedRing::wait(unsigned int, int) {}
+void SharedRing::wakeAll() {}
+
+#endif
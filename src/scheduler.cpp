@@ -0,0 +1,235 @@
+#include "scheduler.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// 当前线程所属的调度器与工作线程编号，用于把工作线程提交的任务放进自己的队列
+static thread_local const Scheduler* currentScheduler = nullptr;
+static thread_local int currentWorker = -1;
+
+Scheduler::Scheduler() : queued(0), sleepers(0), nextWorker(0), stopping(false) {}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+bool Scheduler::start(int count, bool pinCores) {
+    stop();
+    if (count <= 0) count = (int)std::max(1u, std::thread::hardware_concurrency());
+    stopping = false;
+    for (int i = 0; i < count; ++i) workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    // 全部队列就绪后再启动线程，窃取时不会看到尚未创建的队列
+    for (int i = 0; i < count; ++i) workers[i]->thread = std::thread(&Scheduler::run, this, i, pinCores);
+    return true;
+}
+
+void Scheduler::stop() {
+    if (workers.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    idleWake.notify_all();
+    for (auto& worker : workers) worker->thread.join();
+    workers.clear();
+}
+
+void Scheduler::submit(Task task, int affinity) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    int n = (int)workers.size();
+    int target;
+    if (affinity >= 0) target = affinity % n;
+    else if (currentScheduler == this) target = currentWorker;
+    else target = (int)(nextWorker.fetch_add(1, std::memory_order_relaxed) % (unsigned)n);
+
+    Item item;
+    item.task = std::move(task);
+    item.queuedAt = Clock::now();
+    item.queue = target;
+    item.hinted = affinity >= 0;
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(item));
+    }
+
+    // 先计数再看有没有睡眠的线程；睡眠方先登记再检查计数，两边至少有一方看到对方
+    queued.fetch_add(1);
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        // 首选线程可能正在睡眠，但条件变量无法指定唤醒谁；醒来的线程会去窃取
+        idleWake.notify_one();
+    }
+}
+
+bool Scheduler::take(int self, Item& item) {
+    if (queued.load(std::memory_order_relaxed) <= 0) return false;
+
+    if (self >= 0) {
+        Worker& own = *workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            item = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // 从下一个队列开始轮一圈，避免所有窃取方都挤在 0 号队列上
+    int n = (int)workers.size();
+    int start = self >= 0 ? self + 1 : (int)(nextWorker.load(std::memory_order_relaxed) % (unsigned)n);
+    for (int i = 0; i < n; ++i) {
+        int victim = (start + i) % n;
+        if (victim == self) continue;
+        Worker& other = *workers[victim];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            item = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::execute(Worker& stats, int self, Item& item) {
+    Clock::time_point started = Clock::now();
+    item.task();
+    Clock::time_point finished = Clock::now();
+
+    std::lock_guard<std::mutex> lock(stats.statsMutex);
+    stats.queueLatency.record((unsigned long long)
+        std::chrono::duration_cast<std::chrono::microseconds>(started - item.queuedAt).count());
+    stats.runLatency.record((unsigned long long)
+        std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count());
+    if (item.hinted) {
+        ++stats.affinityTasks;
+        if (item.queue == self) ++stats.affinityHits;
+    }
+    if (self >= 0 && item.queue != self) ++stats.stolen;
+}
+
+void Scheduler::run(int index, bool pinCore) {
+#ifdef __linux__
+    if (pinCore) {
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)pinCore;
+#endif
+    currentScheduler = this;
+    currentWorker = index;
+    Worker& self = *workers[index];
+
+    while (true) {
+        Item item;
+        if (take(index, item)) {
+            execute(self, index, item);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        sleepers.fetch_add(1);
+        if (queued.load() > 0) {
+            sleepers.fetch_sub(1);
+            continue;
+        }
+        if (stopping) {
+            sleepers.fetch_sub(1);
+            break;
+        }
+        idleWake.wait(lock);
+        sleepers.fetch_sub(1);
+    }
+
+    currentScheduler = nullptr;
+    currentWorker = -1;
+}
+
+bool Scheduler::runPending() {
+    if (workers.empty()) return false;
+    Item item;
+    if (currentScheduler == this) {
+        if (!take(currentWorker, item)) return false;
+        execute(*workers[currentWorker], currentWorker, item);
+        return true;
+    }
+    if (!take(-1, item)) return false;
+    execute(helper, -1, item);
+    return true;
+}
+
+Scheduler::Stats Scheduler::stats() {
+    LatencyHistogram queue, run;
+    Stats result = Stats();
+    std::vector<Worker*> all;
+    for (auto& worker : workers) all.push_back(worker.get());
+    all.push_back(&helper);
+    for (Worker* worker : all) {
+        std::lock_guard<std::mutex> lock(worker->statsMutex);
+        queue.merge(worker->queueLatency);
+        run.merge(worker->runLatency);
+        result.stolen += worker->stolen;
+        result.affinityHits += worker->affinityHits;
+        result.affinityTasks += worker->affinityTasks;
+        if (worker == &helper) result.helped = worker->runLatency.count();
+    }
+    result.tasks = run.count();
+    result.queueP50 = queue.percentile(50);
+    result.queueP99 = queue.percentile(99);
+    result.queueMax = queue.max();
+    result.runP50 = run.percentile(50);
+    result.runP99 = run.percentile(99);
+    result.runMax = run.max();
+    return result;
+}
+
+void Scheduler::resetStats() {
+    std::vector<Worker*> all;
+    for (auto& worker : workers) all.push_back(worker.get());
+    all.push_back(&helper);
+    for (Worker* worker : all) {
+        std::lock_guard<std::mutex> lock(worker->statsMutex);
+        worker->queueLatency = LatencyHistogram();
+        worker->runLatency = LatencyHistogram();
+        worker->stolen = worker->affinityHits = worker->affinityTasks = 0;
+    }
+}
+
+TaskGroup::TaskGroup(Scheduler& owner) : scheduler(owner), pending(0) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(Scheduler::Task task, int affinity) {
+    pending.fetch_add(1);
+    scheduler.submit([this, task]() {
+        task();
+        // 在锁内减计数：等待方拿到锁后，这里已不再访问 TaskGroup
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.fetch_sub(1) == 1) done.notify_all();
+    }, affinity);
+}
+
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (scheduler.runPending()) continue;
+        // 剩下的任务都在执行中
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending.load() == 0; });
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+}
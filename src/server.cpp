@@ -0,0 +1,887 @@
+#include "server.h"
+#include "database.h"
+#include "protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// 一次读写的缓冲区大小
+static const size_t kReadChunk = 16 * 1024;
+// 积压的待发送数据上限：客户端长期不读时断开，避免推送把内存撑满
+static const size_t kMaxPendingOutput = 4 * 1024 * 1024;
+// 最近聊天列表单页上限
+static const int kMaxRecentPage = 200;
+// 没有变更监视时轮询其它进程写入的间隔
+static const int kExternalCheckMs = 3000;
+// 一次唤醒要推送的连接达到这个数时，PUSH 帧的编码分给工作线程池；太少时分发的开销不划算
+static const size_t kParallelPushSessions = 32;
+// 消息日志单次写入上限
+static const size_t kLogChunk = 64 * 1024;
+
+// io_uring 提交队列长度；一轮循环的请求超过它时会提前提交一次
+static const unsigned kUringEntries = 256;
+// 接收缓冲区从固定缓冲区中分配的连接数，更多的连接单独分配、用普通读请求
+static const size_t kUringFixedSessions = 256;
+// 一次发送请求的上限，与 HISTORY 的分帧大小一致
+static const size_t kUringSendChunk = protocol::kBatchBytes;
+// 完成事件的 user_data：连接指针的低位标记读或写；指针部分为 0 时是服务端自身的请求
+static const uint64_t kTagRead = 1;
+static const uint64_t kTagWrite = 2;
+static const uint64_t kTagMask = 7;
+enum ServerTag {
+    TAG_ACCEPT_TCP = 1,
+    TAG_ACCEPT_UNIX,
+    TAG_WAKE,
+    TAG_TIMER,
+    TAG_LOG
+};
+
+ServerOptions::ServerOptions() : host("127.0.0.1"), port(7700), maxClients(1024), ioBackend("epoll"), workers(0) {}
+
+ServerOptions ServerOptions::fromEnvironment() {
+    ServerOptions opts;
+    const char* value;
+
+    if ((value = std::getenv("OICQ_SERVER_HOST"))) opts.host = value;
+    if ((value = std::getenv("OICQ_SERVER_PORT")) && *value) opts.port = std::atoi(value);
+    if ((value = std::getenv("OICQ_SERVER_SOCKET"))) opts.unixPath = value;
+    if ((value = std::getenv("OICQ_SERVER_MAX_CLIENTS")) && *value) opts.maxClients = std::atoi(value);
+    if ((value = std::getenv("OICQ_SERVER_IO")) && *value) opts.ioBackend = value;
+    if ((value = std::getenv("OICQ_SERVER_MESSAGE_LOG"))) opts.messageLogPath = value;
+    if ((value = std::getenv("OICQ_SERVER_WORKERS")) && *value) opts.workers = std::atoi(value);
+
+    return opts;
+}
+
+ChatServer::ChatServer()
+    : epollFd(-1), wakeFd(-1), tcpFd(-1), unixFd(-1), boundPort(0), stopping(false),
+      externalChanged(false), logFd(-1),
+      requestsHandled(0), syscalls(0), useUring(false), logInFlight(0), logWritten(0), logWriting(false),
+      timerArmed(false) {}
+
+#ifdef __linux__
+
+// 日志一行一条消息，字段以制表符分隔，文本中的反斜杠、制表符和换行转义
+static void appendEscaped(std::string& out, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            case '\n': out += "\\n"; break;
+            default: out += c;
+        }
+    }
+}
+
+ChatServer::~ChatServer() {
+    // 监视回调会写 wakeFd
+    Database::getInstance()->stopChangeWatcher();
+    while (!sessions.empty()) closeSession(sessions.begin()->second);
+    // 环关闭时内核取消全部未完成的请求，之后才能释放这些连接的接收缓冲区
+    ring.close();
+    for (Session* session : retired) {
+        if (session->recvSlot < 0) delete[] session->recvBuffer;
+        delete session;
+    }
+    if (logFd >= 0) close(logFd);
+    if (tcpFd >= 0) close(tcpFd);
+    if (unixFd >= 0) {
+        close(unixFd);
+        unlink(options.unixPath.c_str());
+    }
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+bool ChatServer::start(const ServerOptions& opts) {
+    options = opts;
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) return false;
+
+    // 内核不支持或被禁用时退回 epoll，ioBackend() 报告实际使用的后端
+    if (options.ioBackend == "io_uring") useUring = startUring();
+    if (!useUring) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) return false;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = wakeFd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) != 0) return false;
+    }
+
+    if (!options.host.empty() && !listenTcp()) return false;
+    if (!options.unixPath.empty() && !listenUnix()) return false;
+    if (tcpFd < 0 && unixFd < 0) return false;
+
+    if (!options.messageLogPath.empty()) {
+        logFd = open(options.messageLogPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (logFd < 0) return false;
+    }
+
+    if (options.workers > 0) pool.start(options.workers);
+
+    // 其它 oicq 进程写入的消息也要推送给订阅者；监视线程只唤醒事件循环，
+    // 由事件循环线程检查数据库。监视不可用时 run() 定时轮询
+    Database::getInstance()->startChangeWatcher([this]() {
+        externalChanged = true;
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    });
+    return true;
+}
+
+bool ChatServer::listenTcp() {
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) return false;
+
+    // io_uring 的 accept 在没有连接时挂起等待，监听套接字保持阻塞，避免旧内核直接返回 EAGAIN
+    tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | (useUring ? 0 : SOCK_NONBLOCK), 0);
+    if (tcpFd < 0) return false;
+    int on = 1;
+    setsockopt(tcpFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(tcpFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(tcpFd, SOMAXCONN) != 0) {
+        close(tcpFd);
+        tcpFd = -1;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(tcpFd, (struct sockaddr*)&addr, &len);
+    boundPort = ntohs(addr.sin_port);
+    if (useUring) return true;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = tcpFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, tcpFd, &ev) == 0;
+}
+
+bool ChatServer::listenUnix() {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (options.unixPath.size() >= sizeof(addr.sun_path)) return false;
+    std::strcpy(addr.sun_path, options.unixPath.c_str());
+
+    unixFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | (useUring ? 0 : SOCK_NONBLOCK), 0);
+    if (unixFd < 0) return false;
+    // 上次异常退出留下的套接字文件会让 bind 失败
+    unlink(options.unixPath.c_str());
+    if (bind(unixFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(unixFd, SOMAXCONN) != 0) {
+        close(unixFd);
+        unixFd = -1;
+        return false;
+    }
+    if (useUring) return true;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = unixFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, unixFd, &ev) == 0;
+}
+
+void ChatServer::run() {
+    if (useUring) {
+        runUring();
+        return;
+    }
+    Database* db = Database::getInstance();
+    struct epoll_event events[64];
+    std::chrono::steady_clock::time_point lastCheck = std::chrono::steady_clock::now();
+
+    while (!stopping) {
+        bool polling = !db->isWatchingChanges();
+        int n = epoll_wait(epollFd, events, 64, polling ? kExternalCheckMs : -1);
+        ++syscalls;
+        if (n < 0 && errno != EINTR) break;
+
+        bool woken = false;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t count;
+                ssize_t drained = read(wakeFd, &count, sizeof(count));
+                (void)drained;
+                ++syscalls;
+                woken = true;
+                continue;
+            }
+            if (fd == tcpFd || fd == unixFd) {
+                acceptClients(fd);
+                continue;
+            }
+            std::unordered_map<int, Session*>::iterator it = sessions.find(fd);
+            if (it == sessions.end()) continue;
+            Session* session = it->second;
+            if (events[i].events & EPOLLOUT) {
+                if (!flushSession(session)) continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readSession(session);
+        }
+
+        if (woken) {
+            if (externalChanged.exchange(false)) db->checkExternalChanges();
+            deliverPushes();
+        }
+        if (polling) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now - lastCheck >= std::chrono::milliseconds(kExternalCheckMs)) {
+                lastCheck = now;
+                db->checkExternalChanges();
+                deliverPushes();
+            }
+        }
+        flushMessageLog();
+    }
+
+    while (!sessions.empty()) closeSession(sessions.begin()->second);
+    flushMessageLog();
+}
+
+void ChatServer::stop() {
+    stopping = true;
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+ChatServer::Session* ChatServer::newSession(int fd) {
+    Session* session = new Session();
+    session->fd = fd;
+    session->outputSent = 0;
+    session->sub = nullptr;
+    session->watchGroup = false;
+    session->lastPushedId = 0;
+    session->writable = false;
+    session->closing = false;
+    session->recvBuffer = nullptr;
+    session->recvSlot = -1;
+    session->reading = false;
+    session->sending = false;
+    session->closed = false;
+    return session;
+}
+
+void ChatServer::acceptClients(int listenFd) {
+    while (true) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        ++syscalls;
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if ((int)sessions.size() >= options.maxClients) {
+            close(fd);
+            continue;
+        }
+        if (listenFd == tcpFd) {
+            // 请求和推送都是小包，不等待合并
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        Session* session = newSession(fd);
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            delete session;
+            continue;
+        }
+        sessions[fd] = session;
+    }
+}
+
+void ChatServer::readSession(Session* session) {
+    char buffer[kReadChunk];
+    bool peerClosed = false;
+    while (true) {
+        ssize_t n = recv(session->fd, buffer, sizeof(buffer), 0);
+        ++syscalls;
+        if (n > 0) {
+            session->input.append(buffer, n);
+            if (session->input.size() > protocol::kMaxRequestBytes) break;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        peerClosed = true;
+        break;
+    }
+
+    // 与 FIN 一起到达的整帧照常处理（如写完 SEND 后立即关闭），应答尽量写出后再关闭
+    if (!processInput(session) || !flushSession(session)) return;
+    if (peerClosed) closeSession(session);
+}
+
+bool ChatServer::processInput(Session* session) {
+    // 请求直接从接收缓冲区解码，处理完一批后再整体前移
+    size_t start = 0;
+    while (!session->closing) {
+        const char* body;
+        size_t bodySize, frameSize;
+        protocol::FrameStatus status = protocol::peekFrame(session->input.data() + start, session->input.size() - start,
+                                                           protocol::kMaxRequestBytes, body, bodySize, frameSize);
+        if (status == protocol::FRAME_INCOMPLETE) break;
+        // 长度前缀损坏后无法再找到帧边界
+        if (status == protocol::FRAME_INVALID) {
+            closeSession(session);
+            return false;
+        }
+        handleFrame(session, body, bodySize);
+        start += frameSize;
+    }
+    session->input.erase(0, start);
+    return true;
+}
+
+bool ChatServer::flushSession(Session* session) {
+    if (useUring) return flushUring(session);
+    while (session->outputSent < session->output.size()) {
+        ssize_t n = send(session->fd, session->output.data() + session->outputSent,
+                         session->output.size() - session->outputSent, MSG_NOSIGNAL);
+        ++syscalls;
+        if (n > 0) {
+            session->outputSent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closeSession(session);
+            return false;
+        }
+    }
+
+    if (session->outputSent == session->output.size()) {
+        session->output.clear();
+        session->outputSent = 0;
+        if (session->closing) {
+            closeSession(session);
+            return false;
+        }
+    } else if (session->output.size() - session->outputSent > kMaxPendingOutput) {
+        closeSession(session);
+        return false;
+    }
+
+    bool wantWrite = !session->output.empty();
+    if (wantWrite != session->writable) {
+        struct epoll_event ev;
+        ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = session->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, session->fd, &ev);
+        ++syscalls;
+        session->writable = wantWrite;
+    }
+    return true;
+}
+
+void ChatServer::closeSession(Session* session) {
+    if (useUring) {
+        closeUring(session);
+        return;
+    }
+    unwatch(session);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    sessions.erase(session->fd);
+    delete session;
+}
+
+void ChatServer::handleFrame(Session* session, const char* body, size_t size) {
+    ++requestsHandled;
+    protocol::Request request;
+    if (!protocol::decodeRequest(body, size, request)) {
+        protocol::encodeError(session->output, "无法解析的请求");
+        return;
+    }
+    handleRequest(session, request);
+}
+
+bool ChatServer::canChat(const Session* session, const std::string& target, bool isGroup) {
+    Database* db = Database::getInstance();
+    return isGroup ? db->isGroupMember(session->username, target) : db->areFriends(session->username, target);
+}
+
+void ChatServer::handleRequest(Session* session, const protocol::Request& request) {
+    Database* db = Database::getInstance();
+    std::string& out = session->output;
+
+    switch (request.op) {
+        case protocol::OP_PING:
+            protocol::encodeStatus(out, protocol::OP_PONG);
+            return;
+        case protocol::OP_QUIT:
+            protocol::encodeStatus(out, protocol::OP_BYE);
+            session->closing = true;
+            return;
+        case protocol::OP_REGISTER: {
+            std::string username = request.text1.str();
+            if (username.empty() || request.text2.size == 0) protocol::encodeError(out, "用户名和密码不能为空");
+            else if (db->userExists(username)) protocol::encodeError(out, "用户名已存在");
+            else if (!db->createUser(username, request.text2.str())) protocol::encodeError(out, "注册失败");
+            else protocol::encodeStatus(out, protocol::OP_OK);
+            return;
+        }
+        case protocol::OP_LOGIN: {
+            std::string username = request.text1.str();
+            if (!db->validateUser(username, request.text2.str())) {
+                protocol::encodeError(out, "用户名或密码错误");
+                return;
+            }
+            unwatch(session);
+            session->username = username;
+            protocol::encodeStatus(out, protocol::OP_OK);
+            return;
+        }
+        default:
+            break;
+    }
+
+    if (session->username.empty()) {
+        protocol::encodeError(out, "未登录");
+        return;
+    }
+    const std::string& user = session->username;
+    std::string target = request.text1.str();
+
+    switch (request.op) {
+        case protocol::OP_FRIEND:
+            if (target == user || !db->userExists(target)) protocol::encodeError(out, "用户不存在");
+            else if (!db->addFriend(user, target)) protocol::encodeError(out, "已经是好友");
+            else protocol::encodeStatus(out, protocol::OP_OK);
+            break;
+        case protocol::OP_CREATE_GROUP:
+            if (target.empty() || !db->createGroup(target, user)) protocol::encodeError(out, "群组已存在");
+            else protocol::encodeStatus(out, protocol::OP_OK);
+            break;
+        case protocol::OP_JOIN_GROUP:
+            if (!db->joinGroup(user, target)) protocol::encodeError(out, "加入群组失败");
+            else protocol::encodeStatus(out, protocol::OP_OK);
+            break;
+        case protocol::OP_SEND:
+            if (request.text2.size == 0) protocol::encodeError(out, "消息不能为空");
+            else if (!canChat(session, target, request.isGroup)) protocol::encodeError(out, request.isGroup ? "不是群成员" : "不是好友");
+            else if (!db->saveMessage(user, target, request.text2.str(), request.isGroup)) protocol::encodeError(out, "发送失败");
+            else {
+                appendMessageLog(user, target, request.isGroup, request.text2);
+                protocol::encodeStatus(out, protocol::OP_OK);
+            }
+            break;
+        case protocol::OP_HISTORY: {
+            if (!canChat(session, target, request.isGroup)) {
+                protocol::encodeError(out, request.isGroup ? "不是群成员" : "不是好友");
+                break;
+            }
+            // 行视图直接编码进发送缓冲区；正文超过 kBatchBytes 时另起一帧
+            std::unique_ptr<protocol::MessageBatchWriter> batch(new protocol::MessageBatchWriter(out, protocol::OP_MESSAGES));
+            MessageVisitor visitor = [&](const MessageView& msg) {
+                if (batch->bodySize() >= protocol::kBatchBytes) {
+                    batch->finish(true);
+                    batch.reset(new protocol::MessageBatchWriter(out, protocol::OP_MESSAGES));
+                }
+                batch->add(msg);
+                return true;
+            };
+            // 打开会话时取最新一屏（走会话缓存），断线重连时按 id 增量补齐
+            if (request.number1 > 0) db->visitMessagesSince(user, target, request.isGroup, request.number1, visitor);
+            else db->visitConversation(user, target, request.isGroup, visitor);
+            batch->finish(false);
+            break;
+        }
+        case protocol::OP_RECENT: {
+            int limit = (int)request.number1;
+            int offset = (int)request.number2;
+            if (request.number1 <= 0 || request.number1 > kMaxRecentPage) limit = kMaxRecentPage;
+            if (request.number2 < 0 || request.number2 > 1000000) offset = 0;
+            bool hasMore = false;
+            std::vector<Database::RecentChat> chats = db->getRecentChats(user, limit, offset, &hasMore);
+            protocol::ChatBatchWriter batch(out, hasMore);
+            for (const auto& chat : chats) {
+                batch.add(protocol::textOf(chat.name), chat.isGroup, protocol::textOf(chat.lastTime),
+                          protocol::textOf(chat.lastMessage));
+            }
+            batch.finish();
+            break;
+        }
+        case protocol::OP_WATCH:
+            if (!canChat(session, target, request.isGroup)) {
+                protocol::encodeError(out, request.isGroup ? "不是群成员" : "不是好友");
+                break;
+            }
+            watch(session, target, request.isGroup);
+            protocol::encodeStatus(out, protocol::OP_OK);
+            break;
+        case protocol::OP_UNWATCH:
+            unwatch(session);
+            protocol::encodeStatus(out, protocol::OP_OK);
+            break;
+        default:
+            protocol::encodeError(out, "无法解析的请求");
+    }
+}
+
+void ChatServer::watch(Session* session, const std::string& target, bool isGroup) {
+    Database* db = Database::getInstance();
+    unwatch(session);
+
+    session->watchTarget = target;
+    session->watchGroup = isGroup;
+    session->lastPushedId = db->getLastMessageId(session->username, target, isGroup);
+
+    // 监听器在发布方线程、持有通知器锁时调用，只登记连接并唤醒事件循环
+    int fd = session->fd;
+    session->sub = db->getNotifier().subscribe(
+        MessageNotifier::conversationKey(session->username, target, isGroup), session->username,
+        [this, fd]() {
+            {
+                std::lock_guard<std::mutex> lock(readyMutex);
+                readyFds.push_back(fd);
+            }
+            uint64_t one = 1;
+            ssize_t written = write(wakeFd, &one, sizeof(one));
+            (void)written;
+        });
+}
+
+void ChatServer::unwatch(Session* session) {
+    if (!session->sub) return;
+    Database::getInstance()->getNotifier().unsubscribe(session->sub);
+    session->sub = nullptr;
+    session->watchTarget.clear();
+}
+
+void ChatServer::deliverPushes() {
+    std::vector<int> ready;
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        ready.swap(readyFds);
+    }
+    // 每条通知登记一次，同一连接常出现多次；一个连接只建一个任务，
+    // 否则两个任务会在同一个发送缓冲区上各开一帧（还可能被不同的工作线程同时编码）
+    std::sort(ready.begin(), ready.end());
+    ready.erase(std::unique(ready.begin(), ready.end()), ready.end());
+
+    // 先在事件循环线程上取走通知，编码可以分给工作线程；每个任务只写自己连接的发送缓冲区
+    Database* db = Database::getInstance();
+    std::vector<PushJob> jobs;
+    jobs.reserve(ready.size());
+    for (size_t i = 0; i < ready.size(); ++i) {
+        // 连接可能已关闭，描述符也可能已被新连接复用；新连接没有订阅或通知为空时什么也不做
+        std::unordered_map<int, Session*>::iterator it = sessions.find(ready[i]);
+        if (it == sessions.end() || !it->second->sub) continue;
+        PushJob job;
+        job.session = it->second;
+        job.resync = false;
+        if (!db->getNotifier().take(job.session->sub, job.notices, job.resync)) continue;
+        jobs.push_back(std::move(job));
+    }
+
+    if (pool.isRunning() && jobs.size() >= kParallelPushSessions) {
+        // 同一连接的编码总是优先交给同一个工作线程
+        TaskGroup group(pool);
+        for (PushJob& job : jobs) {
+            PushJob* target = &job;
+            group.run([target]() { encodePush(*target); }, target->session->fd);
+        }
+        group.wait();
+    } else {
+        for (PushJob& job : jobs) encodePush(job);
+    }
+
+    for (PushJob& job : jobs) {
+        Session* session = job.session;
+        // 通知不完整时从数据库补齐，只能在事件循环线程上进行
+        if (job.resync) {
+            db->visitMessagesSince(session->username, session->watchTarget, session->watchGroup,
+                                   session->lastPushedId, [&](const MessageView& msg) {
+                session->lastPushedId = msg.id;
+                // 自己发出的消息客户端已回显
+                if (!(msg.sender == session->username)) {
+                    job.batch->add(msg);
+                    ++job.added;
+                }
+                return true;
+            });
+        }
+        // 一次唤醒积累的通知合成一个 PUSH 帧，一条也没有时撤销
+        if (job.added > 0) job.batch->finish(false);
+        else session->output.resize(job.before);
+        job.batch.reset();
+        flushSession(session);
+    }
+}
+
+void ChatServer::encodePush(PushJob& job) {
+    Session* session = job.session;
+    job.before = session->output.size();
+    job.added = 0;
+    job.batch.reset(new protocol::MessageBatchWriter(session->output, protocol::OP_PUSH));
+    for (const auto& notice : job.notices) {
+        if (!notice.complete) job.resync = true;
+        if (job.resync || notice.id <= session->lastPushedId) continue;
+        MessageView view;
+        view.id = (int)notice.id;
+        view.sender = protocol::textOf(notice.sender);
+        view.receiver = protocol::textOf(notice.receiver);
+        view.content = protocol::textOf(notice.content);
+        view.timestamp = protocol::textOf(notice.timestamp);
+        view.isGroup = notice.isGroup;
+        job.batch->add(view);
+        ++job.added;
+        session->lastPushedId = notice.id;
+    }
+}
+
+void ChatServer::appendMessageLog(const std::string& sender, const std::string& target, bool isGroup,
+                                  const TextView& content) {
+    if (logFd < 0) return;
+    char stamp[20];
+    protocol::formatTimestamp((long long)std::time(nullptr), stamp);
+    logPending.append(stamp, 19);
+    logPending += '\t';
+    appendEscaped(logPending, sender.data(), sender.size());
+    logPending += '\t';
+    appendEscaped(logPending, target.data(), target.size());
+    logPending += isGroup ? "\t1\t" : "\t0\t";
+    appendEscaped(logPending, content.data, (size_t)content.size);
+    logPending += '\n';
+}
+
+void ChatServer::flushMessageLog() {
+    if (logFd < 0 || logPending.empty()) return;
+    if (useUring) {
+        // 同一时刻只有一个写请求，保证日志行的顺序；日志缓冲区位于固定缓冲区开头
+        if (logWriting) return;
+        logInFlight = std::min(logPending.size(), kLogChunk);
+        std::memcpy(&fixedArena[0], logPending.data(), logInFlight);
+        logPending.erase(0, logInFlight);
+        logWritten = 0;
+        ring.prepWrite(logFd, &fixedArena[0], (unsigned)logInFlight, TAG_LOG);
+        logWriting = true;
+        return;
+    }
+
+    size_t written = 0;
+    while (written < logPending.size()) {
+        ssize_t n = write(logFd, logPending.data() + written, logPending.size() - written);
+        ++syscalls;
+        if (n < 0 && errno == EINTR) continue;
+        // 写失败（如磁盘已满）时丢弃本批日志，不影响消息收发
+        if (n <= 0) break;
+        written += n;
+    }
+    logPending.clear();
+}
+
+bool ChatServer::startUring() {
+    if (!ring.init(kUringEntries)) return false;
+
+    size_t slots = std::min((size_t)std::max(options.maxClients, 1), kUringFixedSessions);
+    fixedArena.assign(kLogChunk + slots * kReadChunk, 0);
+    // 超出 RLIMIT_MEMLOCK 时缩小注册范围，落在范围外的连接改用普通读请求
+    for (size_t count = slots;; count /= 2) {
+        if (ring.registerBuffer(&fixedArena[0], kLogChunk + count * kReadChunk) || count == 0) break;
+    }
+    for (size_t i = slots; i-- > 0;) freeSlots.push_back((int)i);
+    return true;
+}
+
+void ChatServer::runUring() {
+    Database* db = Database::getInstance();
+    if (tcpFd >= 0) ring.prepAccept(tcpFd, TAG_ACCEPT_TCP);
+    if (unixFd >= 0) ring.prepAccept(unixFd, TAG_ACCEPT_UNIX);
+    ring.prepPollIn(wakeFd, TAG_WAKE);
+
+    IoUring::Completion completion;
+    while (!stopping) {
+        if (!timerArmed && !db->isWatchingChanges()) {
+            ring.prepTimeout(kExternalCheckMs, TAG_TIMER);
+            timerArmed = true;
+        }
+        flushMessageLog();
+        if (!ring.submitAndWait()) break;
+        while (ring.popCompletion(completion)) onUringCompletion(completion);
+    }
+
+    while (!sessions.empty()) closeSession(sessions.begin()->second);
+    flushMessageLog();
+    // 等已关闭连接的读写和日志写入返回后再释放缓冲区
+    while ((!retired.empty() || logWriting) && ring.submitAndWait()) {
+        while (ring.popCompletion(completion)) onUringCompletion(completion);
+    }
+}
+
+void ChatServer::onUringCompletion(const IoUring::Completion& completion) {
+    int result = completion.result;
+    Session* session = (Session*)(uintptr_t)(completion.userData & ~kTagMask);
+
+    if (!session) {
+        switch (completion.userData) {
+            case TAG_ACCEPT_TCP:
+            case TAG_ACCEPT_UNIX: {
+                bool tcp = completion.userData == TAG_ACCEPT_TCP;
+                if (result >= 0) {
+                    if (stopping || (int)sessions.size() >= options.maxClients) {
+                        close(result);
+                    } else {
+                        if (tcp) {
+                            int on = 1;
+                            setsockopt(result, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                        }
+                        Session* accepted = newSession(result);
+                        if (!freeSlots.empty()) {
+                            accepted->recvSlot = freeSlots.back();
+                            freeSlots.pop_back();
+                            accepted->recvBuffer = &fixedArena[kLogChunk + (size_t)accepted->recvSlot * kReadChunk];
+                        } else {
+                            accepted->recvBuffer = new char[kReadChunk];
+                        }
+                        sessions[result] = accepted;
+                        queueRecv(accepted);
+                    }
+                }
+                // 监听套接字失效时不再挂 accept
+                if (!stopping && result != -EBADF && result != -EINVAL) {
+                    ring.prepAccept(tcp ? tcpFd : unixFd, completion.userData);
+                }
+                return;
+            }
+            case TAG_WAKE: {
+                uint64_t count;
+                ssize_t drained = read(wakeFd, &count, sizeof(count));
+                (void)drained;
+                ++syscalls;
+                if (externalChanged.exchange(false)) Database::getInstance()->checkExternalChanges();
+                deliverPushes();
+                if (!stopping) ring.prepPollIn(wakeFd, TAG_WAKE);
+                return;
+            }
+            case TAG_TIMER:
+                timerArmed = false;
+                Database::getInstance()->checkExternalChanges();
+                deliverPushes();
+                return;
+            case TAG_LOG:
+                logWriting = false;
+                if (result > 0) {
+                    logWritten += result;
+                    if (logWritten < logInFlight) {
+                        ring.prepWrite(logFd, &fixedArena[logWritten], (unsigned)(logInFlight - logWritten), TAG_LOG);
+                        logWriting = true;
+                        return;
+                    }
+                }
+                flushMessageLog();
+                return;
+            default:
+                return;
+        }
+    }
+
+    if (completion.userData & kTagRead) {
+        session->reading = false;
+        if (session->closed) {
+            releaseIfIdle(session);
+        } else if (result == -EINTR || result == -EAGAIN) {
+            queueRecv(session);
+        } else if (result <= 0) {
+            closeSession(session);
+        } else {
+            session->input.append(session->recvBuffer, result);
+            if (processInput(session) && flushSession(session) && !session->closing) queueRecv(session);
+        }
+    } else {
+        session->sending = false;
+        if (session->closed) {
+            releaseIfIdle(session);
+        } else if (result < 0 && result != -EINTR && result != -EAGAIN) {
+            closeSession(session);
+        } else {
+            if (result > 0) session->outputSent += result;
+            flushSession(session);
+        }
+    }
+}
+
+void ChatServer::queueRecv(Session* session) {
+    ring.prepRead(session->fd, session->recvBuffer, (unsigned)kReadChunk, (uint64_t)(uintptr_t)session | kTagRead);
+    session->reading = true;
+}
+
+bool ChatServer::flushUring(Session* session) {
+    // 一个连接同一时刻只有一个发送请求，完成后再发下一段
+    if (session->sending) return true;
+    if (session->outputSent == session->output.size()) {
+        session->output.clear();
+        session->outputSent = 0;
+        if (session->closing) {
+            closeSession(session);
+            return false;
+        }
+        return true;
+    }
+    size_t pending = session->output.size() - session->outputSent;
+    if (pending > kMaxPendingOutput) {
+        closeSession(session);
+        return false;
+    }
+    session->sendStage.assign(session->output, session->outputSent, std::min(pending, kUringSendChunk));
+    ring.prepSend(session->fd, session->sendStage.data(), (unsigned)session->sendStage.size(),
+                  (uint64_t)(uintptr_t)session | kTagWrite);
+    session->sending = true;
+    return true;
+}
+
+void ChatServer::closeUring(Session* session) {
+    unwatch(session);
+    sessions.erase(session->fd);
+    // 关闭后描述符可能被新连接复用；未完成的请求仍持有原套接字，shutdown 让挂起的读立即返回
+    shutdown(session->fd, SHUT_RDWR);
+    close(session->fd);
+    session->closed = true;
+    retired.push_back(session);
+    releaseIfIdle(session);
+}
+
+void ChatServer::releaseIfIdle(Session* session) {
+    if (session->reading || session->sending) return;
+    if (session->recvSlot >= 0) freeSlots.push_back(session->recvSlot);
+    else delete[] session->recvBuffer;
+    retired.erase(std::find(retired.begin(), retired.end(), session));
+    delete session;
+}
+
+#else
+
+// 其它平台没有 epoll，服务端不可用
+ChatServer::~ChatServer() {}
+bool ChatServer::start(const ServerOptions& opts) { options = opts; return false; }
+void ChatServer::run() {}
+void ChatServer::stop() { stopping = true; }
+
+#endif
@@ -0,0 +1,299 @@
+#include "session.h"
+#include "client.h"
+#include <chrono>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// 一次读的缓冲区大小
+static const size_t kReadChunk = 16 * 1024;
+
+AsyncSession::AsyncSession()
+    : fd(-1), outputSent(0), writable(false), awaiting(false), failed(false), wakeAt(0),
+      queuedWake(0) {
+    reply.op = 0;
+    reply.hasMore = false;
+}
+
+AsyncSession::~AsyncSession() {
+#ifdef __linux__
+    if (fd >= 0) close(fd);
+#endif
+}
+
+double AsyncSession::nowMicros() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AsyncSession::request(protocol::Opcode op, const std::string& text1, const std::string& text2, bool isGroup,
+                           long long number1, long long number2) {
+    reply.op = 0;
+    reply.error.clear();
+    reply.messages.clear();
+    reply.chats.clear();
+    reply.hasMore = false;
+    if (failed) return;
+
+    protocol::Request r;
+    r.op = op;
+    r.text1 = protocol::textOf(text1);
+    r.text2 = protocol::textOf(text2);
+    r.isGroup = isGroup;
+    r.number1 = number1;
+    r.number2 = number2;
+    protocol::encodeRequest(output, r);
+    awaiting = true;
+}
+
+bool AsyncSession::replyOk() const {
+    if (failed) return false;
+    switch (reply.op) {
+        case protocol::OP_OK:
+        case protocol::OP_PONG:
+        case protocol::OP_BYE:
+        case protocol::OP_MESSAGES:
+        case protocol::OP_CHATS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool AsyncSession::timerDue() const {
+    return failed || wakeAt <= 0 || nowMicros() >= wakeAt;
+}
+
+void AsyncSession::fail() {
+    failed = true;
+    awaiting = false;
+}
+
+void AsyncSession::handleFrame(const char* body, size_t size) {
+    int op = (uint8_t)body[0];
+    if (op == protocol::OP_PUSH) {
+        protocol::MessageBatchReader batch(body + 1, size - 1);
+        protocol::WireMessage msg;
+        while (batch.next(msg)) pushes.push_back(protocol::toMessage(msg));
+        return;
+    }
+    // 没有未完成的请求时不应收到其它应答，忽略
+    if (!awaiting) return;
+
+    if (op == protocol::OP_MESSAGES) {
+        protocol::MessageBatchReader batch(body + 1, size - 1);
+        protocol::WireMessage msg;
+        while (batch.next(msg)) reply.messages.push_back(protocol::toMessage(msg));
+        if (!batch.ok()) {
+            fail();
+            return;
+        }
+        // 同一请求还有后续批次
+        if (batch.hasMore()) return;
+    } else if (op == protocol::OP_CHATS) {
+        protocol::ChatBatchReader batch(body + 1, size - 1);
+        protocol::WireChat wire;
+        while (batch.next(wire)) {
+            Database::RecentChat chat;
+            chat.name = wire.name.str();
+            chat.isGroup = wire.isGroup;
+            chat.lastTime = protocol::timeText(wire.time, wire.rawTime);
+            chat.lastMessage = wire.lastMessage.str();
+            reply.chats.push_back(chat);
+        }
+        if (!batch.ok()) {
+            fail();
+            return;
+        }
+        reply.hasMore = batch.hasMore();
+    } else if (op == protocol::OP_ERR) {
+        protocol::Reader reader(body + 1, size - 1);
+        TextView reason;
+        if (reader.readText(reason)) reply.error = reason.str();
+    }
+    reply.op = op;
+    awaiting = false;
+}
+
+SessionLoop::SessionLoop() : epollFd(-1), active(0) {}
+
+#ifdef __linux__
+
+SessionLoop::~SessionLoop() {
+    if (epollFd >= 0) close(epollFd);
+}
+
+bool SessionLoop::start() {
+    if (epollFd < 0) epollFd = epoll_create1(EPOLL_CLOEXEC);
+    return epollFd >= 0;
+}
+
+bool SessionLoop::add(AsyncSession* session, const std::string& address) {
+    if (epollFd < 0) return false;
+    // 连接本身是阻塞的，建立后改为非阻塞交给事件循环
+    ChatClient client;
+    if (!client.connect(address)) return false;
+    session->fd = client.release();
+    fcntl(session->fd, F_SETFL, fcntl(session->fd, F_GETFL) | O_NONBLOCK);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = session;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, session->fd, &ev) != 0) {
+        close(session->fd);
+        session->fd = -1;
+        return false;
+    }
+    ++active;
+    step(session);
+    return true;
+}
+
+void SessionLoop::step(AsyncSession* session) {
+    if (session->fd < 0) return;
+    session->resume();
+    if (!session->isDone() && !session->failed) {
+        if (flush(session)) {
+            if (session->wakeAt > 0 && session->wakeAt != session->queuedWake) {
+                session->queuedWake = session->wakeAt;
+                timers.push(TimerEntry(session->wakeAt, session));
+            }
+            return;
+        }
+        // 写出时连接断开，让协程看到失败
+        session->resume();
+    } else if (!session->failed) {
+        // 协程结束前发出的最后一个请求（如 QUIT）尽量写出
+        flush(session);
+    }
+    finish(session);
+}
+
+bool SessionLoop::flush(AsyncSession* session) {
+    while (session->outputSent < session->output.size()) {
+        ssize_t n = send(session->fd, session->output.data() + session->outputSent,
+                         session->output.size() - session->outputSent, MSG_NOSIGNAL);
+        if (n > 0) {
+            session->outputSent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            session->fail();
+            return false;
+        }
+    }
+    if (session->outputSent == session->output.size()) {
+        session->output.clear();
+        session->outputSent = 0;
+    }
+
+    bool wantWrite = !session->output.empty();
+    if (wantWrite != session->writable) {
+        struct epoll_event ev;
+        ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.ptr = session;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, session->fd, &ev);
+        session->writable = wantWrite;
+    }
+    return true;
+}
+
+void SessionLoop::readFrom(AsyncSession* session) {
+    char buffer[kReadChunk];
+    bool closed = false;
+    while (true) {
+        ssize_t n = recv(session->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            session->input.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closed = true;
+        break;
+    }
+
+    // 断开前已收到的整帧照常处理（如 QUIT 的 BYE 与连接关闭同时到达）
+    size_t start = 0;
+    while (true) {
+        const char* body;
+        size_t bodySize, frameSize;
+        protocol::FrameStatus status = protocol::peekFrame(session->input.data() + start, session->input.size() - start,
+                                                           protocol::kMaxResponseBytes, body, bodySize, frameSize);
+        if (status == protocol::FRAME_INCOMPLETE) break;
+        if (status == protocol::FRAME_INVALID) {
+            session->fail();
+            break;
+        }
+        session->handleFrame(body, bodySize);
+        start += frameSize;
+    }
+    session->input.erase(0, start);
+    if (closed) session->fail();
+    step(session);
+}
+
+void SessionLoop::finish(AsyncSession* session) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->fd = -1;
+    session->queuedWake = 0;
+    --active;
+}
+
+void SessionLoop::run() {
+    struct epoll_event events[64];
+    while (active > 0) {
+        // 丢弃已被改期或会话已结束的定时
+        while (!timers.empty() && timers.top().first != timers.top().second->queuedWake) timers.pop();
+        int timeout = -1;
+        if (!timers.empty()) {
+            double left = timers.top().first - AsyncSession::nowMicros();
+            timeout = left <= 0 ? 0 : (int)(left / 1000) + 1;
+        }
+
+        int n = epoll_wait(epollFd, events, 64, timeout);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            AsyncSession* session = (AsyncSession*)events[i].data.ptr;
+            if (session->fd < 0) continue;
+            if ((events[i].events & EPOLLOUT) && !flush(session)) {
+                step(session);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readFrom(session);
+        }
+
+        double now = AsyncSession::nowMicros();
+        while (!timers.empty() && timers.top().first <= now) {
+            TimerEntry entry = timers.top();
+            timers.pop();
+            AsyncSession* session = entry.second;
+            if (entry.first != session->queuedWake) continue;
+            session->queuedWake = 0;
+            session->wakeAt = 0;
+            step(session);
+        }
+    }
+    // 会话可能在返回后被释放，不再保留指向它们的定时
+    while (!timers.empty()) timers.pop();
+}
+
+#else
+
+SessionLoop::~SessionLoop() {}
+bool SessionLoop::start() { return false; }
+bool SessionLoop::add(AsyncSession*, const std::string&) { return false; }
+void SessionLoop::step(AsyncSession*) {}
+bool SessionLoop::flush(AsyncSession*) { return false; }
+void SessionLoop::readFrom(AsyncSession*) {}
+void SessionLoop::finish(AsyncSession*) {}
+void SessionLoop::run() {}
+
+#endif
@@ -0,0 +1,257 @@
+#include "terminal.h"
+#include "metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+Terminal* Terminal::instance = nullptr;
+
+Terminal::Terminal() : rows(0), cols(0), ansi(true) {
+    last.micros = 0;
+    last.bytes = 0;
+    last.rowsWritten = 0;
+#ifdef _WIN32
+    // Windows 10 以后的控制台需要显式开启 ANSI 转义序列
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    ansi = GetConsoleMode(out, &mode) && SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+Terminal* Terminal::getInstance() {
+    if (instance == nullptr) {
+        instance = new Terminal();
+    }
+    return instance;
+}
+
+void Terminal::querySize(int& r, int& c) {
+    r = 24;
+    c = 80;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        r = info.srWindow.Bottom - info.srWindow.Top + 1;
+        c = info.srWindow.Right - info.srWindow.Left + 1;
+    }
+#else
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        r = size.ws_row;
+        c = size.ws_col;
+    }
+#endif
+    if (r < 2) r = 2;
+    if (c < 2) c = 2;
+}
+
+void Terminal::writeOut(const std::string& data) {
+    // 先冲掉流缓冲中其它界面输出的内容，保证顺序
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    std::fwrite(data.data(), 1, data.size(), stdout);
+    std::fflush(stdout);
+#else
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(STDOUT_FILENO, data.data() + done, data.size() - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+#endif
+}
+
+void Terminal::clearLocked() {
+    screen.clear();
+    if (ansi) {
+        writeOut("\x1b[H\x1b[2J");
+    } else {
+        std::cout.flush();
+        system("cls");
+    }
+}
+
+void Terminal::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearLocked();
+}
+
+void Terminal::inputEchoed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (screen.empty()) return;
+    // 不可能与任何帧内容相等的占位符
+    screen.back() = "\x01";
+    screen.push_back("\x01");
+}
+
+FrameStats Terminal::lastFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last;
+}
+
+// 新帧是否是屏幕内容整体上移若干行的结果（聊天追加新消息的常见情形）：
+// 选取上移后能复用最多行的位移，不值得滚动时返回 0
+static int findShift(const std::vector<std::string>& screen, const std::vector<std::string>& frame) {
+    if (screen.empty() || frame.empty()) return 0;
+    auto matches = [&](size_t shift) {
+        int count = 0;
+        for (size_t i = 0; i < frame.size() && i + shift < screen.size(); ++i) {
+            if (screen[i + shift] == frame[i]) count++;
+        }
+        return count;
+    };
+
+    int best = 0;
+    int bestScore = matches(0);
+    for (size_t shift = 1; shift < screen.size(); ++shift) {
+        if (screen[shift] != frame[0]) continue;
+        int score = matches(shift) - 1;
+        if (score > bestScore) {
+            best = (int)shift;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void Terminal::render(const std::vector<std::string>& lines) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto start = std::chrono::steady_clock::now();
+
+    std::string out;
+    int r, c;
+    querySize(r, c);
+    if (r != rows || c != cols) {
+        // 窗口大小变化后折行结果全部失效，清屏后整帧重画
+        rows = r;
+        cols = c;
+        screen.clear();
+        out = "\x1b[H\x1b[2J";
+    }
+
+    // 末列写满后再清行会误删最后一个字符，因此少用一列
+    std::vector<std::string> frame;
+    for (const auto& line : lines) {
+        wrapLine(line, cols - 1, frame);
+    }
+    if (frame.empty()) frame.push_back("");
+    size_t height = (size_t)(rows - 1);
+    if (frame.size() > height) {
+        frame.erase(frame.begin(), frame.end() - height);
+    }
+
+    int written = 0;
+    if (!ansi) {
+        // 不支持转义序列时只能整屏重画
+        out.clear();
+        clearLocked();
+        for (size_t i = 0; i < frame.size(); ++i) {
+            out += frame[i];
+            if (i + 1 < frame.size()) out += "\n";
+        }
+        written = (int)frame.size();
+    } else {
+        int shift = findShift(screen, frame);
+        if (shift > 0) {
+            // 光标移到最后一行再换行，终端自行滚动
+            out += "\x1b[" + std::to_string(rows) + ";1H" + std::string(shift, '\n');
+            screen.erase(screen.begin(), screen.begin() + shift);
+        }
+
+        for (size_t i = 0; i < frame.size(); ++i) {
+            if (i < screen.size() && screen[i] == frame[i]) continue;
+            out += "\x1b[" + std::to_string(i + 1) + ";1H" + frame[i] + "\x1b[K";
+            written++;
+        }
+        if (screen.size() > frame.size()) {
+            out += "\x1b[" + std::to_string(frame.size() + 1) + ";1H\x1b[J";
+        }
+        out += "\x1b[" + std::to_string(frame.size()) + ";" +
+               std::to_string(displayWidth(frame.back()) + 1) + "H";
+    }
+    screen.swap(frame);
+    writeOut(out);
+
+    last.micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    last.bytes = out.size();
+    last.rowsWritten = written;
+    Metrics::getInstance()->countFrame(last.bytes, last.micros);
+}
+
+// 解码一个 UTF-8 字符，返回字节数
+static int decodeUtf8(const std::string& text, size_t pos, unsigned int& codepoint) {
+    unsigned char c = (unsigned char)text[pos];
+    int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+    if (pos + len > text.size()) len = 1;
+    codepoint = len == 1 ? c : (c & (0xFF >> (len + 1)));
+    for (int i = 1; i < len; ++i) {
+        codepoint = (codepoint << 6) | ((unsigned char)text[pos + i] & 0x3F);
+    }
+    return len;
+}
+
+static int codepointWidth(unsigned int cp) {
+    if (cp < 0x20 || cp == 0x7F) return 0;
+    // 东亚宽字符与常用 emoji
+    if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+        (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+        (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+        (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) ||
+        (cp >= 0x1F900 && cp <= 0x1F9FF) || (cp >= 0x20000 && cp <= 0x3FFFD)) {
+        return 2;
+    }
+    return 1;
+}
+
+int Terminal::displayWidth(const std::string& text) {
+    int width = 0;
+    unsigned int cp;
+    for (size_t pos = 0; pos < text.size(); ) {
+        pos += decodeUtf8(text, pos, cp);
+        width += codepointWidth(cp);
+    }
+    return width;
+}
+
+void Terminal::wrapLine(const std::string& line, int width, std::vector<std::string>& out) {
+    std::string current;
+    int currentWidth = 0;
+    unsigned int cp;
+    for (size_t pos = 0; pos < line.size(); ) {
+        int len = decodeUtf8(line, pos, cp);
+        if (cp == '\n') {
+            out.push_back(current);
+            current.clear();
+            currentWidth = 0;
+            pos += len;
+            continue;
+        }
+        int w = codepointWidth(cp);
+        if (w == 0) {
+            // 控制字符会打乱光标位置，直接丢弃
+            pos += len;
+            continue;
+        }
+        if (currentWidth + w > width) {
+            out.push_back(current);
+            current.clear();
+            currentWidth = 0;
+        }
+        current.append(line, pos, len);
+        currentWidth += w;
+        pos += len;
+    }
+    out.push_back(current);
+}
@@ -0,0 +1,71 @@
+#include "timefmt.h"
+#include <cstring>
+
+TimeFormatter::TimeFormatter() : dayStart(0), nextMidnight(0) {
+    std::memset(today, 0, sizeof(today));
+    refresh();
+}
+
+void TimeFormatter::recompute(std::time_t now) {
+    struct tm local;
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char buffer[16];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &local);
+    std::memcpy(today, buffer, sizeof(today));
+
+    // 交给 mktime 处理月末进位和夏令时切换
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    dayStart = std::mktime(&local);
+    local.tm_mday += 1;
+    local.tm_isdst = -1;
+    nextMidnight = std::mktime(&local);
+}
+
+size_t TimeFormatter::copyRaw(const char* timestamp, size_t len, char* out) {
+    // 格式不符时原样输出，超长部分截断
+    if (len > kBufferSize - 1) len = kBufferSize - 1;
+    std::memcpy(out, timestamp, len);
+    out[len] = '\0';
+    return len;
+}
+
+size_t TimeFormatter::formatMessageTime(const char* timestamp, size_t len, char* out) const {
+    if (len < 19) return copyRaw(timestamp, len, out);
+
+    char* p = out;
+    if (std::memcmp(timestamp, today, sizeof(today)) != 0) {
+        std::memcpy(p, timestamp + 5, 5);       // MM-DD
+        p[5] = ' ';
+        p += 6;
+    }
+    std::memcpy(p, timestamp + 11, 8);          // HH:MM:SS
+    p += 8;
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+size_t TimeFormatter::formatListTime(const char* timestamp, size_t len, char* out) const {
+    if (len < 19) return copyRaw(timestamp, len, out);
+
+    static const char kToday[] = "今天 ";
+    char* p = out;
+    if (std::memcmp(timestamp, today, sizeof(today)) == 0) {
+        std::memcpy(p, kToday, sizeof(kToday) - 1);
+        p += sizeof(kToday) - 1;
+    } else {
+        std::memcpy(p, timestamp + 5, 5);       // MM-DD
+        p[5] = ' ';
+        p += 6;
+    }
+    std::memcpy(p, timestamp + 11, 5);          // HH:MM
+    p += 5;
+    *p = '\0';
+    return (size_t)(p - out);
+}
@@ -1,11 +1,14 @@
 #include "ui.h"
 #include "database.h"
+#include "metrics.h"
+#include "terminal.h"
 #include <iostream>
 #include <limits>
 #include <cstdlib>
 #include <thread>
 #include <chrono>
 #include <ios>
+#include <cstdio>
 
 #ifdef _WIN32
 #include <conio.h>
@@ -24,11 +27,15 @@ UI::~UI() {
 
 void UI::run() {
     // 初始化数据库
+    // 交互界面是本机多个会话互相通知的场景，默认开启通知环
+    DatabaseOptions defaults;
+    defaults.shmRing = true;
     Database* db = Database::getInstance();
-    if (!db->initialize()) {
+    if (!db->initialize(DatabaseOptions::fromEnvironment(defaults))) {
         std::cerr << "数据库初始化失败！" << std::endl;
         return;
     }
+    Metrics::getInstance()->startExporter(MetricsOptions::fromEnvironment());
     
     std::cout << "========== 欢迎使用即时通讯系统 ==========" << std::endl;
     std::cout << "默认管理员密码: admin123" << std::endl;
@@ -49,10 +56,11 @@ void UI::showMainMenu() {
     std::cout << "1. 用户注册" << std::endl;
     std::cout << "2. 用户登录" << std::endl;
     std::cout << "3. 删除用户 (需要管理员密码)" << std::endl;
-    std::cout << "4. 退出程序" << std::endl;
+    std::cout << "4. SQL 性能统计 (需要管理员密码)" << std::endl;
+    std::cout << "5. 退出程序" << std::endl;
     std::cout << "===========================" << std::endl;
     
-    int choice = getChoice(1, 4);
+    int choice = getChoice(1, 5);
     
     switch (choice) {
         case 1:
@@ -68,7 +76,12 @@ void UI::showMainMenu() {
             handleDeleteUser();
             break;
         case 4:
+            clearScreen();
+            handleSqlStats();
+            break;
+        case 5:
             std::cout << "再见！" << std::endl;
+            Metrics::getInstance()->stopExporter();
             exit(0);
         default:
             std::cout << "无效选择！" << std::endl;
@@ -84,10 +97,12 @@ void UI::showUserMenu() {
     std::cout << "3. 创建群组" << std::endl;
     std::cout << "4. 加入群组" << std::endl;
     std::cout << "5. 移除群成员 (需要权限)" << std::endl;
-    std::cout << "6. 退出登录" << std::endl;
+    std::cout << "6. 批量邀请入群 (需要权限)" << std::endl;
+    std::cout << "7. 批量移除群成员 (需要权限)" << std::endl;
+    std::cout << "8. 退出登录" << std::endl;
     std::cout << "=============================" << std::endl;
     
-    int choice = getChoice(1, 6);
+    int choice = getChoice(1, 8);
     
     switch (choice) {
         case 1:
@@ -111,6 +126,14 @@ void UI::showUserMenu() {
             handleRemoveFromGroup();
             break;
         case 6:
+            clearScreen();
+            handleBulkMembership(true);
+            break;
+        case 7:
+            clearScreen();
+            handleBulkMembership(false);
+            break;
+        case 8:
             delete currentUser;
             currentUser = nullptr;
             delete chat;
@@ -129,10 +152,11 @@ void UI::showChatMenu() {
     std::cout << "2. 查看好友和群组列表" << std::endl;
     std::cout << "3. 发起私聊" << std::endl;
     std::cout << "4. 发起群聊" << std::endl;
-    std::cout << "5. 返回上级菜单" << std::endl;
+    std::cout << "5. 查看群成员" << std::endl;
+    std::cout << "6. 返回上级菜单" << std::endl;
     std::cout << "=============================" << std::endl;
     
-    int choice = getChoice(1, 5);
+    int choice = getChoice(1, 6);
     
     switch (choice) {
         case 1:
@@ -153,6 +177,10 @@ void UI::showChatMenu() {
             handleGroupChat();
             break;
         case 5:
+            clearScreen();
+            handleGroupMembers();
+            break;
+        case 6:
             return;
         default:
             std::cout << "无效选择！" << std::endl;
@@ -201,6 +229,48 @@ void UI::handleDeleteUser() {
     pauseScreen();
 }
 
+void UI::handleSqlStats() {
+    std::cout << "========== SQL 性能统计 ==========" << std::endl;
+    std::string adminPassword = getPassword("请输入管理员密码: ");
+    
+    if (!User::verifyAdminPassword(adminPassword)) {
+        std::cout << "管理员密码错误！" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    Database* db = Database::getInstance();
+    std::vector<StatementStats> stats = db->getProfiler().snapshot();
+    
+    if (stats.empty()) {
+        std::cout << "暂无统计数据（可设置 OICQ_PROFILE=1 开启）" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    std::cout << "按总耗时排序，延迟单位为微秒" << std::endl;
+    printf("%-4s %8s %10s %8s %8s %8s %10s %12s  %s\n",
+           "序号", "调用次数", "总耗时(ms)", "p50", "p99", "max", "全表扫描行", "VM步数/次", "SQL");
+    std::cout << "------------------------------------------------------------------------------------------" << std::endl;
+    
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const StatementStats& s = stats[i];
+        
+        std::string sql = QueryProfiler::summarizeSql(s.sql, 60);
+        
+        printf("%-4zu %8lld %10.1f %8llu %8llu %8llu %10lld %12lld  %s\n",
+               i + 1, s.calls, s.latency.totalMicros() / 1000.0,
+               s.latency.percentile(50), s.latency.percentile(99), s.latency.max(),
+               s.fullScanSteps, s.calls > 0 ? s.vmSteps / s.calls : 0, sql.c_str());
+    }
+    
+    const DatabaseOptions& options = db->getOptions();
+    if (!options.slowLogPath.empty()) {
+        std::cout << "\n超过 " << options.slowQueryMs << "ms 的语句记录在 " << options.slowLogPath << std::endl;
+    }
+    pauseScreen();
+}
+
 void UI::handleAddFriend() {
     std::cout << "========== 添加好友 ==========" << std::endl;
     std::string friendName = getInput("请输入要添加的好友用户名: ");
@@ -280,6 +350,62 @@ void UI::handleRemoveFromGroup() {
     pauseScreen();
 }
 
+void UI::handleBulkMembership(bool join) {
+    std::cout << (join ? "========== 批量邀请入群 ==========" : "========== 批量移除群成员 ==========") << std::endl;
+    std::string groupName = getInput("请输入群组名称: ");
+    std::string line = getInput("请输入用户名（以空格或逗号分隔）: ");
+    std::string adminPassword = getPassword("请输入管理员密码 (如果您是群创建者请随意输入): ");
+    
+    std::vector<std::string> targets;
+    std::string name;
+    for (char c : line) {
+        if (c == ' ' || c == ',' || c == '\t') {
+            if (!name.empty()) targets.push_back(name);
+            name.clear();
+        } else {
+            name += c;
+        }
+    }
+    if (!name.empty()) targets.push_back(name);
+    
+    if (targets.empty()) {
+        std::cout << "未输入用户名！" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    if (!currentUser->canManageGroup(groupName, adminPassword)) {
+        std::cout << "权限不足！只有群创建者或系统管理员可以管理群成员！" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    std::vector<Database::MembershipResult> results;
+    bool ok = join ? currentUser->addUsersToGroup(targets, groupName, adminPassword, results)
+                   : currentUser->removeUsersFromGroup(targets, groupName, adminPassword, results);
+    if (!ok && results.empty()) {
+        std::cout << "操作失败！群组可能不存在。" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    int changed = 0;
+    for (const auto& r : results) {
+        const char* text = "写入失败";
+        switch (r.outcome) {
+            case Database::MEMBER_ADDED:   text = "已加入"; ++changed; break;
+            case Database::MEMBER_ALREADY: text = "已在群中"; break;
+            case Database::MEMBER_REMOVED: text = "已移除"; ++changed; break;
+            case Database::MEMBER_ABSENT:  text = "不在群中"; break;
+            case Database::MEMBER_NO_USER: text = "用户不存在"; break;
+            case Database::MEMBER_FAILED:  break;
+        }
+        printf("  %-20s %s\n", r.username.c_str(), text);
+    }
+    std::cout << "共 " << results.size() << " 人，" << (join ? "加入 " : "移除 ") << changed << " 人" << std::endl;
+    pauseScreen();
+}
+
 void UI::handleChatList() {
     chat->showChatList();
     pauseScreen();
@@ -291,14 +417,14 @@ void UI::handlePrivateChat() {
     
     // 检查是否为好友
     Database* db = Database::getInstance();
-    std::vector<std::string> friends = db->getFriends(currentUser->username);
     bool isFriend = false;
-    for (const auto& f : friends) {
+    db->visitFriends(currentUser->username, [&](const TextView& f) {
         if (f == friendName) {
             isFriend = true;
-            break;
+            return false;
         }
-    }
+        return true;
+    });
     
     if (!isFriend) {
         std::cout << "该用户不是您的好友！" << std::endl;
@@ -335,6 +461,30 @@ void UI::handleGroupChat() {
     chat->interactiveChat(groupName, true);
 }
 
+void UI::handleGroupMembers() {
+    std::cout << "========== 查看群成员 ==========" << std::endl;
+    std::string groupName = getInput("请输入群组名称: ");
+    
+    // 只允许查看自己所在的群
+    Database* db = Database::getInstance();
+    std::vector<std::string> groups = db->getUserGroups(currentUser->username);
+    bool inGroup = false;
+    for (const auto& g : groups) {
+        if (g == groupName) {
+            inGroup = true;
+            break;
+        }
+    }
+    
+    if (!inGroup) {
+        std::cout << "您不在该群组中！" << std::endl;
+        pauseScreen();
+        return;
+    }
+    
+    chat->showGroupMembers(groupName);
+}
+
 std::string UI::getInput(const std::string& prompt) {
     std::cout << prompt;
     std::string input;
@@ -388,11 +538,7 @@ int UI::getChoice(int min, int max) {
 }
 
 void UI::clearScreen() {
-#ifdef _WIN32
-    system("cls");
-#else
-    system("clear");
-#endif
+    Terminal::getInstance()->clear();
 }
 
 void UI::pauseScreen() {
@@ -0,0 +1,224 @@
+#include "uring.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+IoUring::IoUring()
+    : ringFd(-1), sqRing(nullptr), cqRing(nullptr), sqes(nullptr), sqRingSize(0), cqRingSize(0), sqesSize(0),
+      sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr), cqHead(nullptr), cqTail(nullptr),
+      cqMask(nullptr), cqes(nullptr), sqEntries(0), localTail(0), fixedBase(nullptr), fixedSize(0), enters(0) {
+    timeoutSpec[0] = timeoutSpec[1] = 0;
+}
+
+IoUring::~IoUring() {
+    close();
+}
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+bool IoUring::init(unsigned entries) {
+    close();
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return false;
+    ringFd = fd;
+
+    // 完成队列满时暂存溢出事件（5.5）；套接字读写就绪前不占用内核工作线程（5.7），
+    // 同时保证了 ACCEPT / READ / WRITE 等操作码可用
+    if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_FAST_POLL)) {
+        close();
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        close();
+        return false;
+    }
+    if (single) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            close();
+            return false;
+        }
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        sqes = nullptr;
+        close();
+        return false;
+    }
+
+    char* sq = (char*)sqRing;
+    char* cq = (char*)cqRing;
+    sqHead = (unsigned*)(sq + params.sq_off.head);
+    sqTail = (unsigned*)(sq + params.sq_off.tail);
+    sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    sqArray = (unsigned*)(sq + params.sq_off.array);
+    cqHead = (unsigned*)(cq + params.cq_off.head);
+    cqTail = (unsigned*)(cq + params.cq_off.tail);
+    cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    sqEntries = params.sq_entries;
+    localTail = *sqTail;
+    return true;
+}
+
+void IoUring::close() {
+    if (sqes) munmap(sqes, sqesSize);
+    if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing) munmap(sqRing, sqRingSize);
+    if (ringFd >= 0) ::close(ringFd);
+    ringFd = -1;
+    sqRing = cqRing = sqes = nullptr;
+    fixedBase = nullptr;
+    fixedSize = 0;
+}
+
+bool IoUring::registerBuffer(void* data, size_t size) {
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, &iov, 1) != 0) return false;
+    fixedBase = (const char*)data;
+    fixedSize = size;
+    return true;
+}
+
+bool IoUring::isFixed(const void* data, size_t size) const {
+    const char* p = (const char*)data;
+    return fixedBase && p >= fixedBase && p + size <= fixedBase + fixedSize;
+}
+
+void IoUring::publish() {
+    __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+}
+
+void* IoUring::nextSqe() {
+    // 提交队列满时先把已有请求交给内核（不等待完成）
+    while (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+        publish();
+        ++enters;
+        syscall(__NR_io_uring_enter, ringFd, localTail - *sqHead, 0, 0, nullptr, 0);
+    }
+    unsigned index = localTail & *sqMask;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++localTail;
+    return sqe;
+}
+
+void IoUring::prepAccept(int fd, uint64_t userData) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepRead(int fd, void* data, unsigned size, uint64_t userData) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = isFixed(data, size) ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = size;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepWrite(int fd, const void* data, unsigned size, uint64_t userData) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = isFixed(data, size) ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = size;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepSend(int fd, const void* data, unsigned size, uint64_t userData) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = size;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepPollIn(int fd, uint64_t userData) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepTimeout(int ms, uint64_t userData) {
+    timeoutSpec[0] = ms / 1000;
+    timeoutSpec[1] = (long long)(ms % 1000) * 1000000;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)nextSqe();
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)timeoutSpec;
+    sqe->len = 1;
+    sqe->user_data = userData;
+}
+
+bool IoUring::submitAndWait() {
+    publish();
+    unsigned pending = localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    bool ready = *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    ++enters;
+    long rc = syscall(__NR_io_uring_enter, ringFd, pending, ready ? 0 : 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    // EBUSY / EAGAIN：溢出的完成事件尚未取走，先处理已有事件
+    return rc >= 0 || errno == EINTR || errno == EBUSY || errno == EAGAIN;
+}
+
+bool IoUring::popCompletion(Completion& completion) {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false;
+    const struct io_uring_cqe* cqe = (const struct io_uring_cqe*)cqes + (head & *cqMask);
+    completion.userData = cqe->user_data;
+    completion.result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+bool IoUring::init(unsigned) { return false; }
+void IoUring::close() {}
+bool IoUring::registerBuffer(void*, size_t) { return false; }
+bool IoUring::isFixed(const void*, size_t) const { return false; }
+void IoUring::publish() {}
+void* IoUring::nextSqe() { return nullptr; }
+void IoUring::prepAccept(int, uint64_t) {}
+void IoUring::prepRead(int, void*, unsigned, uint64_t) {}
+void IoUring::prepWrite(int, const void*, unsigned, uint64_t) {}
+void IoUring::prepSend(int, const void*, unsigned, uint64_t) {}
+void IoUring::prepPollIn(int, uint64_t) {}
+void IoUring::prepTimeout(int, uint64_t) {}
+bool IoUring::submitAndWait() { return false; }
+bool IoUring::popCompletion(Completion&) { return false; }
+
+#endif
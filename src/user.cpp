@@ -107,24 +107,45 @@ std::vector<std::string> User::getGroups() {
     return db->getUserGroups(this->username);
 }
 
-bool User::removeUserFromGroup(const std::string& targetUser, const std::string& groupName, const std::string& adminPassword) {
+bool User::canManageGroup(const std::string& groupName, const std::string& adminPassword) {
     Database* db = Database::getInstance();
     
     // 验证权限：必须是群创建者或系统管理员
-    bool hasPermission = false;
-    
     // 检查是否为群创建者
     if (db->isGroupCreator(this->username, groupName)) {
-        hasPermission = true;
+        return true;
     }
     // 或者验证系统管理员密码
-    else if (verifyAdminPassword(adminPassword)) {
-        hasPermission = true;
+    return verifyAdminPassword(adminPassword);
+}
+
+bool User::removeUserFromGroup(const std::string& targetUser, const std::string& groupName, const std::string& adminPassword) {
+    if (!canManageGroup(groupName, adminPassword)) {
+        return false;
     }
     
-    if (!hasPermission) {
+    Database* db = Database::getInstance();
+    return db->removeFromGroup(targetUser, groupName);
+}
+
+bool User::addUsersToGroup(const std::vector<std::string>& targetUsers, const std::string& groupName,
+                           const std::string& adminPassword, std::vector<Database::MembershipResult>& results) {
+    results.clear();
+    if (!canManageGroup(groupName, adminPassword)) {
         return false;
     }
     
-    return db->removeFromGroup(targetUser, groupName);
+    Database* db = Database::getInstance();
+    return db->joinGroupBulk(groupName, targetUsers, results);
+}
+
+bool User::removeUsersFromGroup(const std::vector<std::string>& targetUsers, const std::string& groupName,
+                                const std::string& adminPassword, std::vector<Database::MembershipResult>& results) {
+    results.clear();
+    if (!canManageGroup(groupName, adminPassword)) {
+        return false;
+    }
+    
+    Database* db = Database::getInstance();
+    return db->removeFromGroupBulk(groupName, targetUsers, results);
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "watcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+ChangeWatcher::ChangeWatcher() : inotifyFd(-1) {
+    stopPipe[0] = stopPipe[1] = -1;
+}
+
+ChangeWatcher::~ChangeWatcher() {
+    stop();
+}
+
+#ifdef __linux__
+
+bool ChangeWatcher::start(const std::string& dbPath, const std::function<void()>& callback) {
+    stop();
+
+    // -wal 文件会被创建和删除，因此监视所在目录而不是文件本身
+    size_t slash = dbPath.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : dbPath.substr(0, slash));
+    dbFile = slash == std::string::npos ? dbPath : dbPath.substr(slash + 1);
+    walFile = dbFile + "-wal";
+    onChange = callback;
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) return false;
+    if (inotify_add_watch(inotifyFd, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0 ||
+        pipe(stopPipe) != 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    thread = std::thread(&ChangeWatcher::run, this);
+    return true;
+}
+
+void ChangeWatcher::run() {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2];
+    fds[0].fd = inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopPipe[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) continue;
+        if (fds[1].revents) break;
+
+        // 读空队列，只要有一条事件落在数据库文件上就回调一次
+        bool relevant = false;
+        ssize_t len;
+        while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + len; ) {
+                struct inotify_event* event = (struct inotify_event*)p;
+                if (event->len > 0 && (dbFile == event->name || walFile == event->name)) {
+                    relevant = true;
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (relevant) onChange();
+    }
+}
+
+void ChangeWatcher::stop() {
+    if (thread.joinable()) {
+        char c = 0;
+        ssize_t written = write(stopPipe[1], &c, 1);
+        (void)written;
+        thread.join();
+    }
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (stopPipe[0] >= 0) close(stopPipe[0]);
+    if (stopPipe[1] >= 0) close(stopPipe[1]);
+    inotifyFd = -1;
+    stopPipe[0] = stopPipe[1] = -1;
+}
+
+#else
+
+bool ChangeWatcher::start(const std::string&, const std::function<void()>&) {
+    return false;
+}
+
+void ChangeWatcher::stop() {}
+
+#endif
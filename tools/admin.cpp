@@ -0,0 +1,107 @@
+// 无界面的管理命令：批量加入/移出群成员，供脚本和运维工具调用
+//
+// 每个用户一行输出 "用户名<TAB>结果"，结果为 added / already-member / removed /
+// not-member / no-such-user / failed，便于 grep/awk 处理；汇总写到标准错误。
+// 命令行未给出用户名时从标准输入逐行读取（忽略空行和 # 开头的行）。
+//
+// 用法: ./oicq_admin [--db 路径] [--password 管理员密码] <join|remove> <群名> [用户名...]
+//       管理员密码也可以通过环境变量 OICQ_ADMIN_PASSWORD 传入，避免出现在进程列表中
+// 退出码: 0 全部用户处于目标状态，1 参数/权限/数据库错误，2 部分用户未能处理
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "database.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char* outcomeName(Database::MembershipOutcome outcome) {
+    switch (outcome) {
+        case Database::MEMBER_ADDED:   return "added";
+        case Database::MEMBER_ALREADY: return "already-member";
+        case Database::MEMBER_REMOVED: return "removed";
+        case Database::MEMBER_ABSENT:  return "not-member";
+        case Database::MEMBER_NO_USER: return "no-such-user";
+        case Database::MEMBER_FAILED:  return "failed";
+    }
+    return "failed";
+}
+
+static int usage(const char* argv0) {
+    std::cerr << "用法: " << argv0 << " [--db 路径] [--password 管理员密码] <join|remove> <群名> [用户名...]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    DatabaseOptions opts = DatabaseOptions::fromEnvironment();
+    const char* envPassword = std::getenv("OICQ_ADMIN_PASSWORD");
+    std::string password = envPassword ? envPassword : "";
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) opts.path = argv[++i];
+        else if (!strcmp(argv[i], "--password") && i + 1 < argc) password = argv[++i];
+        else if (argv[i][0] == '-' && argv[i][1] == '-') return usage(argv[0]);
+        else args.push_back(argv[i]);
+    }
+    if (args.size() < 2 || (args[0] != "join" && args[0] != "remove")) return usage(argv[0]);
+
+    bool join = args[0] == "join";
+    std::string groupName = args[1];
+    std::vector<std::string> usernames(args.begin() + 2, args.end());
+    if (usernames.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.pop_back();
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] == '#') continue;
+            usernames.push_back(line.substr(start));
+        }
+    }
+
+    // 管理工具不需要通知环和后台预取，也不写慢查询日志
+    opts.shmRing = false;
+    opts.prefetchCount = 0;
+    opts.slowLogPath = "";
+    Database* db = Database::getInstance();
+    if (!db->initialize(opts)) return 1;
+
+    if (!db->verifySystemPassword(password)) {
+        std::cerr << "管理员密码错误" << std::endl;
+        db->close();
+        return 1;
+    }
+
+    std::vector<Database::MembershipResult> results;
+    bool ok = join ? db->joinGroupBulk(groupName, usernames, results)
+                   : db->removeFromGroupBulk(groupName, usernames, results);
+    if (!ok && results.empty()) {
+        std::cerr << "群组不存在或数据库忙: " << groupName << std::endl;
+        db->close();
+        return 1;
+    }
+
+    int changed = 0, unchanged = 0, failed = 0;
+    for (const auto& r : results) {
+        std::printf("%s\t%s\n", r.username.c_str(), outcomeName(r.outcome));
+        switch (r.outcome) {
+            case Database::MEMBER_ADDED:
+            case Database::MEMBER_REMOVED:
+                ++changed;
+                break;
+            case Database::MEMBER_ALREADY:
+            case Database::MEMBER_ABSENT:
+                ++unchanged;
+                break;
+            default:
+                ++failed;
+        }
+    }
+    std::fprintf(stderr, "%s %s: %zu 人，变更 %d，无需变更 %d，失败 %d\n",
+                 join ? "join" : "remove", groupName.c_str(), results.size(), changed, unchanged, failed);
+
+    db->close();
+    return failed == 0 ? 0 : 2;
+}
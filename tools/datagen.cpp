@@ -0,0 +1,586 @@
+// 合成数据集生成器：按生产环境的分布特征生成 chat.db
+//
+// - N 个用户，好友关系服从幂律分布（少数人好友很多，多数人很少）
+// - 群组规模服从重尾 (Pareto) 分布
+// - M 条消息，时间戳带有昼夜/周末活跃度起伏，中文与英文内容长度分别采样
+//
+// 生成速度：工作窃取线程池并行合成消息内容，主线程按批次在事务中顺序写入；
+// 每个批次使用由 (种子, 批次号) 派生的独立随机数，结果与线程数无关、可复现
+//
+// 用法: ./oicq_datagen --db 路径 [--users N] [--avg-friends F] [--groups G]
+//                      [--messages M] [--days D] [--seed S] [--threads T] ...
+// 需在项目根目录运行（读取 database/init.sql 建表）
+
+#include "database.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 每条多行 INSERT 语句携带的消息数 (5 个参数/行，远低于 SQLite 参数上限)
+static const int kRowsPerInsert = 64;
+
+struct GenOptions {
+    std::string path;
+    int users;
+    double avgFriends;
+    int groups;
+    int minGroupSize;
+    int maxGroupSize;
+    long long messages;
+    int days;
+    double groupRatio;      // 群聊消息比例
+    double cjkRatio;        // 中文消息比例
+    int batchSize;
+    int threads;
+    unsigned long long seed;
+    long long endTime;      // 时间轴终点 (Unix 秒)，0 表示当前时间
+
+    GenOptions()
+        : path("synthetic.db"), users(10000), avgFriends(20.0), groups(500),
+          minGroupSize(3), maxGroupSize(5000), messages(1000000), days(180),
+          groupRatio(0.3), cjkRatio(0.6), batchSize(50000),
+          threads((int)std::max(1u, std::thread::hardware_concurrency())), seed(20240601), endTime(0) {}
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 由全局种子和流编号派生独立随机流 (splitmix64)
+static unsigned long long deriveSeed(unsigned long long seed, unsigned long long stream) {
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL * (stream + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 幂律采样器：第 i 个元素的权重为 (i+1)^(-exponent)
+class PowerLawSampler {
+private:
+    std::vector<double> cdf;
+    std::vector<int> order;    // 打乱编号，避免热门用户总是 user0, user1...
+
+public:
+    PowerLawSampler(int n, double exponent, unsigned long long seed) : cdf(n), order(n) {
+        double total = 0.0;
+        for (int i = 0; i < n; ++i) {
+            total += std::pow(i + 1.0, -exponent);
+            cdf[i] = total;
+            order[i] = i;
+        }
+        std::mt19937_64 rng(seed);
+        std::shuffle(order.begin(), order.end(), rng);
+    }
+
+    int sample(std::mt19937_64& rng) const {
+        std::uniform_real_distribution<double> u(0.0, cdf.back());
+        size_t idx = std::upper_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+        return order[std::min(idx, cdf.size() - 1)];
+    }
+};
+
+// 按加权的离散分布采样（群组按规模加权选择）
+class WeightedSampler {
+private:
+    std::vector<double> cdf;
+
+public:
+    explicit WeightedSampler(const std::vector<double>& weights) : cdf(weights.size()) {
+        double total = 0.0;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            total += weights[i];
+            cdf[i] = total;
+        }
+    }
+
+    int sample(std::mt19937_64& rng) const {
+        std::uniform_real_distribution<double> u(0.0, cdf.back());
+        size_t idx = std::upper_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+        return (int)std::min(idx, cdf.size() - 1);
+    }
+};
+
+// 时间轴：按小时累积活跃度，把 [0,1) 上的分位数映射到具体时刻，
+// 消息编号递增时时间戳单调递增
+class ActivityTimeline {
+private:
+    long long startEpoch;
+    std::vector<double> cdf;
+
+public:
+    ActivityTimeline(long long endEpoch, int days) : cdf((size_t)days * 24) {
+        // 凌晨低谷、午间和晚间两个高峰
+        static const double hourly[24] = {
+            0.30, 0.15, 0.08, 0.05, 0.05, 0.08, 0.20, 0.45, 0.70, 0.85, 0.90, 0.95,
+            1.00, 0.90, 0.80, 0.80, 0.85, 0.90, 1.00, 1.10, 1.20, 1.25, 1.00, 0.60
+        };
+        startEpoch = endEpoch - (long long)days * 86400;
+        startEpoch -= startEpoch % 3600;
+        double total = 0.0;
+        for (size_t h = 0; h < cdf.size(); ++h) {
+            long long t = startEpoch + (long long)h * 3600;
+            int weekday = (int)((t / 86400 + 4) % 7);   // 1970-01-01 是星期四
+            double weekend = (weekday == 0 || weekday == 6) ? 1.2 : 1.0;
+            total += hourly[(t / 3600) % 24] * weekend;
+            cdf[h] = total;
+        }
+    }
+
+    long long at(double quantile) const {
+        double target = quantile * cdf.back();
+        size_t h = std::lower_bound(cdf.begin(), cdf.end(), target) - cdf.begin();
+        if (h >= cdf.size()) h = cdf.size() - 1;
+        double lo = h == 0 ? 0.0 : cdf[h - 1];
+        double frac = (target - lo) / (cdf[h] - lo);
+        return startEpoch + (long long)h * 3600 + (long long)(frac * 3600);
+    }
+};
+
+// 线程安全的 UTC 时间格式化 "YYYY-MM-DD HH:MM:SS"，out 至少 48 字节
+static void formatTimestamp(long long epoch, char* out) {
+    long long days = epoch / 86400;
+    unsigned secs = (unsigned)(epoch % 86400);
+    // civil_from_days 算法
+    long long z = days + 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long y = (long long)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    if (m <= 2) ++y;
+    snprintf(out, 48, "%04lld-%02u-%02u %02u:%02u:%02u", y, m, d, secs / 3600, (secs / 60) % 60, secs % 60);
+}
+
+static const char* const kAsciiWords[] = {
+    "ok", "hi", "hello", "thanks", "lol", "sure", "see", "you", "later", "meeting", "lunch",
+    "today", "tomorrow", "the", "a", "is", "on", "my", "way", "done", "what", "about", "this",
+    "code", "review", "please", "check", "build", "release", "test", "fixed", "bug", "good",
+    "night", "morning", "yes", "no", "maybe", "call", "me", "when", "free", "deploy", "now"
+};
+
+// 常用汉字及标点，按 UTF-8 逐字存储
+static const char kCjkChars[] =
+    "的一是不了人我在有他这中大来上国个到说们为子和你地出道也时年得就那要下以生会自着去之过家学对可她里后小么心多天而能好都然没日于起还发成事只作当想看文无开手十用主行方又如前所本见经头面公同三已老从动两长知民样现分将外但身些与高意进把法此实回二理美点月明其种声全工己话儿者向情部正名定女问力机给等几很业最间新什打便位因重被走电四第门相次东政海口使教西再平真听世气信北少关并内加化由却代军产入先山五太水万市眼体别处总才场师书比住员九笑性通目华报立马命张活难神数件安表原车白应路期叫死常提感金何更反合放做系计或司利受光王果亲界及今京务制解各任至清物台象记边共风战干接它许八特觉望直服毛林题建南度统色字请交爱让认算论百吃义科怎元社术结六功指思非流每青管夫连远资队跟带花快条院变联言权往展该领传近留红治决周保达办运武半候七必城父强步完革深区即求品士转量空甚众技轻程告江语英基派满式李息写呢识极令黄德收脸钱党倒未持取设始版双历越史商千片容研像找友孩站广改议形委早房音火际则首单据导影失拿网香似斯专石若兵弟谁校读志飞观争究包组造落视济喜离虽坐集编宝谈府拉黑且随格尽剑讲布杀微怕母调局根曾准团段终乐切级克精哪官示冷域读";
+static const char* const kCjkPunct[] = { "，", "。", "！", "？", "～", "…" };
+
+static void appendAsciiContent(std::string& out, std::mt19937_64& rng) {
+    std::lognormal_distribution<double> lenDist(std::log(18.0), 0.8);
+    std::uniform_int_distribution<int> word(0, (int)(sizeof(kAsciiWords) / sizeof(kAsciiWords[0])) - 1);
+    size_t target = (size_t)std::min(500.0, std::max(1.0, lenDist(rng)));
+    size_t begin = out.size();
+    while (out.size() - begin < target) {
+        if (out.size() > begin) out += ' ';
+        out += kAsciiWords[word(rng)];
+    }
+}
+
+static void appendCjkContent(std::string& out, std::mt19937_64& rng) {
+    static const int charCount = (int)(sizeof(kCjkChars) - 1) / 3;
+    std::lognormal_distribution<double> lenDist(std::log(9.0), 0.7);
+    std::uniform_int_distribution<int> pick(0, charCount - 1);
+    std::uniform_int_distribution<int> punct(0, 5);
+    int chars = (int)std::min(300.0, std::max(1.0, lenDist(rng)));
+    for (int i = 0; i < chars; ++i) {
+        if (i > 0 && i % 12 == 11) {
+            out += kCjkPunct[punct(rng)];
+        } else {
+            out.append(kCjkChars + pick(rng) * 3, 3);
+        }
+    }
+}
+
+// 一批已合成的消息，字符串集中存放在 arena 中以减少分配
+struct MessageBatch {
+    struct Row {
+        unsigned sender, senderLen;
+        unsigned receiver, receiverLen;
+        unsigned content, contentLen;
+        unsigned timestamp;
+        bool isGroup;
+    };
+    std::string arena;
+    std::vector<Row> rows;
+};
+
+struct World {
+    const GenOptions* opts;
+    const PowerLawSampler* activity;
+    const ActivityTimeline* timeline;
+    const WeightedSampler* groupPicker;
+    std::vector<std::vector<int> > friends;
+    std::vector<std::vector<int> > members;
+};
+
+static unsigned appendName(std::string& arena, const char* prefix, int id, unsigned& len) {
+    unsigned offset = (unsigned)arena.size();
+    char buf[32];
+    len = (unsigned)snprintf(buf, sizeof(buf), "%s%d", prefix, id);
+    arena.append(buf, len);
+    return offset;
+}
+
+static MessageBatch synthesizeBatch(const World& world, long long first, int count) {
+    const GenOptions& opts = *world.opts;
+    std::mt19937_64 rng(deriveSeed(opts.seed, 1000 + (unsigned long long)first / opts.batchSize));
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    MessageBatch batch;
+    batch.rows.resize(count);
+    batch.arena.reserve((size_t)count * 64);
+
+    for (int i = 0; i < count; ++i) {
+        MessageBatch::Row& row = batch.rows[i];
+        long long index = first + i;
+
+        row.isGroup = !world.members.empty() && coin(rng) < opts.groupRatio;
+        if (row.isGroup) {
+            int g = world.groupPicker->sample(rng);
+            const std::vector<int>& m = world.members[g];
+            row.sender = appendName(batch.arena, "user", m[rng() % m.size()], row.senderLen);
+            row.receiver = appendName(batch.arena, "group", g, row.receiverLen);
+        } else {
+            int s = world.activity->sample(rng);
+            const std::vector<int>& f = world.friends[s];
+            int r = f.empty() ? world.activity->sample(rng) : f[rng() % f.size()];
+            if (r == s) r = (s + 1) % opts.users;
+            row.sender = appendName(batch.arena, "user", s, row.senderLen);
+            row.receiver = appendName(batch.arena, "user", r, row.receiverLen);
+        }
+
+        row.content = (unsigned)batch.arena.size();
+        if (coin(rng) < opts.cjkRatio) {
+            appendCjkContent(batch.arena, rng);
+        } else {
+            appendAsciiContent(batch.arena, rng);
+        }
+        row.contentLen = (unsigned)batch.arena.size() - row.content;
+
+        row.timestamp = (unsigned)batch.arena.size();
+        char ts[48];
+        formatTimestamp(world.timeline->at((index + coin(rng)) / (double)opts.messages), ts);
+        batch.arena.append(ts, 19);
+    }
+    return batch;
+}
+
+static bool exec(sqlite3* conn, const std::string& sql) {
+    char* errMsg = 0;
+    if (sqlite3_exec(conn, sql.c_str(), 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL错误: " << (errMsg ? errMsg : "") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+static void buildFriendGraph(World& world, const GenOptions& opts, sqlite3* conn) {
+    std::mt19937_64 rng(deriveSeed(opts.seed, 1));
+    long long edges = (long long)(opts.users * opts.avgFriends / 2);
+    world.friends.assign(opts.users, std::vector<int>());
+
+    // Chung-Lu 模型：两个端点都按幂律权重抽取
+    for (long long e = 0; e < edges; ++e) {
+        int a = world.activity->sample(rng);
+        int b = world.activity->sample(rng);
+        if (a == b) continue;
+        world.friends[a].push_back(b);
+        world.friends[b].push_back(a);
+    }
+
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO friendships (user1, user2) VALUES (?, ?)", -1, &stmt, NULL);
+    exec(conn, "BEGIN");
+    char a[32], b[32];
+    for (int u = 0; u < opts.users; ++u) {
+        std::vector<int>& f = world.friends[u];
+        std::sort(f.begin(), f.end());
+        f.erase(std::unique(f.begin(), f.end()), f.end());
+        snprintf(a, sizeof(a), "user%d", u);
+        for (int v : f) {
+            // 邻接表已对称，每个方向各插入一次，与 Database::addFriend 一致
+            snprintf(b, sizeof(b), "user%d", v);
+            sqlite3_bind_text(stmt, 1, a, -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, b, -1, SQLITE_STATIC);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+    }
+    exec(conn, "COMMIT");
+    sqlite3_finalize(stmt);
+}
+
+static void buildGroups(World& world, const GenOptions& opts, sqlite3* conn) {
+    std::mt19937_64 rng(deriveSeed(opts.seed, 2));
+    std::uniform_real_distribution<double> u(1e-9, 1.0);
+    int cap = std::min(opts.maxGroupSize, opts.users);
+    world.members.assign(opts.groups, std::vector<int>());
+
+    sqlite3_stmt* groupStmt;
+    sqlite3_stmt* memberStmt;
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO groups (name, creator) VALUES (?, ?)", -1, &groupStmt, NULL);
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO group_members (group_name, username) VALUES (?, ?)", -1, &memberStmt, NULL);
+    exec(conn, "BEGIN");
+
+    char name[32], user[32];
+    for (int g = 0; g < opts.groups; ++g) {
+        // Pareto(alpha=1.1)：大多数小群，少数超大群
+        int size = (int)std::min((double)cap, opts.minGroupSize / std::pow(u(rng), 1.0 / 1.1));
+        std::vector<int>& m = world.members[g];
+        for (int i = 0; i < size * 2 && (int)m.size() < size; ++i) {
+            m.push_back(world.activity->sample(rng));
+            if (i % 64 == 63 || (int)m.size() == size) {
+                std::sort(m.begin(), m.end());
+                m.erase(std::unique(m.begin(), m.end()), m.end());
+            }
+        }
+        // 幂律抽样重复过多时用均匀抽样补足
+        while ((int)m.size() < size) {
+            for (int missing = size - (int)m.size(); missing > 0; --missing) {
+                m.push_back((int)(rng() % opts.users));
+            }
+            std::sort(m.begin(), m.end());
+            m.erase(std::unique(m.begin(), m.end()), m.end());
+        }
+
+        snprintf(name, sizeof(name), "group%d", g);
+        snprintf(user, sizeof(user), "user%d", m[0]);
+        sqlite3_bind_text(groupStmt, 1, name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(groupStmt, 2, user, -1, SQLITE_STATIC);
+        sqlite3_step(groupStmt);
+        sqlite3_reset(groupStmt);
+
+        for (int member : m) {
+            snprintf(user, sizeof(user), "user%d", member);
+            sqlite3_bind_text(memberStmt, 1, name, -1, SQLITE_STATIC);
+            sqlite3_bind_text(memberStmt, 2, user, -1, SQLITE_STATIC);
+            sqlite3_step(memberStmt);
+            sqlite3_reset(memberStmt);
+        }
+    }
+
+    exec(conn, "COMMIT");
+    sqlite3_finalize(groupStmt);
+    sqlite3_finalize(memberStmt);
+}
+
+static void insertUsers(const GenOptions& opts, sqlite3* conn) {
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO users (username, password) VALUES (?, '123')", -1, &stmt, NULL);
+    exec(conn, "BEGIN");
+    char name[32];
+    for (int i = 0; i < opts.users; ++i) {
+        snprintf(name, sizeof(name), "user%d", i);
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    exec(conn, "COMMIT");
+    sqlite3_finalize(stmt);
+}
+
+static void usage(const char* prog) {
+    std::cerr << "用法: " << prog << " [选项]\n"
+              << "  --db 路径           输出数据库 (默认 synthetic.db，已存在则追加)\n"
+              << "  --users N           用户数 (默认 10000)\n"
+              << "  --avg-friends F     平均好友数 (默认 20)\n"
+              << "  --groups G          群组数 (默认 500)\n"
+              << "  --max-group-size S  最大群规模 (默认 5000)\n"
+              << "  --messages M        消息数 (默认 1000000)\n"
+              << "  --days D            消息时间跨度天数 (默认 180)\n"
+              << "  --group-ratio R     群聊消息比例 (默认 0.3)\n"
+              << "  --cjk-ratio R       中文消息比例 (默认 0.6)\n"
+              << "  --batch B           每个事务的消息数 (默认 50000)\n"
+              << "  --threads T         内容合成线程数 (默认 CPU 核数)\n"
+              << "  --seed S            随机种子 (默认 20240601)\n"
+              << "  --end-time T        最后一条消息的 Unix 时间 (默认当前时间，固定后结果完全可复现)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    GenOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--db") && hasValue) opts.path = argv[++i];
+        else if (!strcmp(argv[i], "--users") && hasValue) opts.users = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--avg-friends") && hasValue) opts.avgFriends = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--groups") && hasValue) opts.groups = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-group-size") && hasValue) opts.maxGroupSize = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && hasValue) opts.messages = std::atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--days") && hasValue) opts.days = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--group-ratio") && hasValue) opts.groupRatio = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--cjk-ratio") && hasValue) opts.cjkRatio = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--batch") && hasValue) opts.batchSize = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && hasValue) opts.threads = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) opts.seed = std::strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--end-time") && hasValue) opts.endTime = std::atoll(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.users < 2 || opts.days < 1 || opts.batchSize < 1 || opts.messages < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opts.threads < 1) opts.threads = 1;
+    if (opts.minGroupSize > opts.users) opts.minGroupSize = opts.users;
+
+    // 借助 Database 执行 init.sql 建表，之后用独立连接批量写入
+    DatabaseOptions dbOpts;
+    dbOpts.path = opts.path;
+    dbOpts.warmup = false;
+    Database* db = Database::getInstance();
+    if (!db->initialize(dbOpts)) return 1;
+    db->close();
+
+    sqlite3* conn;
+    if (sqlite3_open(opts.path.c_str(), &conn) != SQLITE_OK) {
+        std::cerr << "无法打开数据库: " << sqlite3_errmsg(conn) << std::endl;
+        return 1;
+    }
+    // 批量导入期间关闭日志和同步，崩溃后需重新生成
+    exec(conn, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA locking_mode = EXCLUSIVE; "
+               "PRAGMA cache_size = -262144;");
+
+    auto start = std::chrono::steady_clock::now();
+    PowerLawSampler activity(opts.users, 1.0, deriveSeed(opts.seed, 0));
+    ActivityTimeline timeline(opts.endTime > 0 ? opts.endTime : (long long)time(NULL), opts.days);
+
+    World world;
+    world.opts = &opts;
+    world.activity = &activity;
+    world.timeline = &timeline;
+
+    insertUsers(opts, conn);
+    buildFriendGraph(world, opts, conn);
+    buildGroups(world, opts, conn);
+
+    std::vector<double> groupWeights;
+    for (const auto& m : world.members) groupWeights.push_back((double)m.size());
+    WeightedSampler groupPicker(groupWeights.empty() ? std::vector<double>(1, 1.0) : groupWeights);
+    world.groupPicker = &groupPicker;
+
+    std::cout << "用户/好友/群组生成完成，用时 " << secondsSince(start) << " 秒" << std::endl;
+
+    // 消息表的二级索引在导入后统一重建，比逐行维护快得多
+    std::vector<std::string> indexSql;
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(conn, "SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = 'messages' AND sql IS NOT NULL", -1, &stmt, NULL);
+    std::vector<std::string> indexNames;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        indexNames.push_back((const char*)sqlite3_column_text(stmt, 0));
+        indexSql.push_back((const char*)sqlite3_column_text(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+    for (const auto& name : indexNames) {
+        exec(conn, "DROP INDEX \"" + name + "\"");
+    }
+
+    // 多行 VALUES 摊薄每条语句的执行开销，批次尾部用单行语句补齐
+    std::string multiSql = "INSERT INTO messages (sender, receiver, content, is_group, timestamp) VALUES ";
+    for (int i = 0; i < kRowsPerInsert; ++i) {
+        multiSql += i == 0 ? "(?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?)";
+    }
+    sqlite3_stmt* multiStmt;
+    sqlite3_prepare_v2(conn, multiSql.c_str(), -1, &multiStmt, NULL);
+    sqlite3_prepare_v2(conn, "INSERT INTO messages (sender, receiver, content, is_group, timestamp) VALUES (?, ?, ?, ?, ?)", -1, &stmt, NULL);
+
+    auto msgStart = std::chrono::steady_clock::now();
+    long long nextBatch = 0;
+    long long written = 0;
+    long long contentBytes = 0;
+    std::deque<std::future<MessageBatch> > pending;
+    // 线程只创建一次，不再每个批次起一个线程
+    Scheduler pool;
+    pool.start(opts.threads);
+
+    // 保持 2T 个批次在途：工作线程合成，主线程按顺序写入
+    auto launch = [&]() {
+        while (nextBatch < opts.messages && (int)pending.size() < opts.threads * 2) {
+            long long first = nextBatch;
+            int count = (int)std::min<long long>(opts.batchSize, opts.messages - first);
+            // std::function 要求可复制，packaged_task 只能移动，放进 shared_ptr
+            std::shared_ptr<std::packaged_task<MessageBatch()> > task(
+                new std::packaged_task<MessageBatch()>(std::bind(synthesizeBatch, std::cref(world), first, count)));
+            pending.push_back(task->get_future());
+            pool.submit([task]() { (*task)(); });
+            nextBatch += count;
+        }
+    };
+
+    launch();
+    while (!pending.empty()) {
+        MessageBatch batch = pending.front().get();
+        pending.pop_front();
+        launch();
+
+        const char* base = batch.arena.data();
+        size_t total = batch.rows.size();
+        exec(conn, "BEGIN");
+        for (size_t i = 0; i < total; ) {
+            bool multi = total - i >= (size_t)kRowsPerInsert;
+            sqlite3_stmt* target = multi ? multiStmt : stmt;
+            int rows = multi ? kRowsPerInsert : 1;
+            for (int k = 0; k < rows; ++k, ++i) {
+                const MessageBatch::Row& row = batch.rows[i];
+                int p = k * 5;
+                sqlite3_bind_text(target, p + 1, base + row.sender, row.senderLen, SQLITE_STATIC);
+                sqlite3_bind_text(target, p + 2, base + row.receiver, row.receiverLen, SQLITE_STATIC);
+                sqlite3_bind_text(target, p + 3, base + row.content, row.contentLen, SQLITE_STATIC);
+                sqlite3_bind_int(target, p + 4, row.isGroup ? 1 : 0);
+                sqlite3_bind_text(target, p + 5, base + row.timestamp, 19, SQLITE_STATIC);
+                contentBytes += row.contentLen;
+            }
+            sqlite3_step(target);
+            sqlite3_reset(target);
+        }
+        exec(conn, "COMMIT");
+
+        long long before = written;
+        written += (long long)total;
+        if (written / 1000000 != before / 1000000 || written == opts.messages) {
+            double elapsed = secondsSince(msgStart);
+            printf("\r消息: %lld / %lld  (%.0f 条/秒)", written, opts.messages, elapsed > 0 ? written / elapsed : 0.0);
+            fflush(stdout);
+        }
+    }
+    sqlite3_finalize(multiStmt);
+    sqlite3_finalize(stmt);
+    std::cout << std::endl;
+    Scheduler::Stats poolStats = pool.stats();
+    pool.stop();
+    std::cout << "合成批次 " << poolStats.tasks << " 个，排队 p50 " << poolStats.queueP50 / 1000.0
+              << " ms，合成 p50/p99 " << poolStats.runP50 / 1000.0 << "/" << poolStats.runP99 / 1000.0
+              << " ms，窃取 " << poolStats.stolen << std::endl;
+
+    if (!indexSql.empty()) {
+        auto indexStart = std::chrono::steady_clock::now();
+        for (const auto& sql : indexSql) {
+            exec(conn, sql);
+        }
+        std::cout << "重建消息索引，用时 " << secondsSince(indexStart) << " 秒" << std::endl;
+    }
+    exec(conn, "ANALYZE");
+    sqlite3_close(conn);
+
+    std::cout << "生成完成: " << opts.users << " 用户, " << opts.groups << " 群组, "
+              << written << " 条消息 (平均 " << (written > 0 ? contentBytes / written : 0)
+              << " 字节/条)，总用时 " << secondsSince(start) << " 秒" << std::endl;
+    return 0;
+}
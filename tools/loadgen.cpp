@@ -0,0 +1,620 @@
+// 多客户端负载生成器：模拟 K 个同时在线的聊天会话
+//
+// 每个模拟用户是一个独立进程（与生产环境中每个登录用户一个 oicq 进程一致），
+// 通过真实的 Chat/Database 代码路径执行：
+//   send    - Chat::sendMessage
+//   poll    - interactiveChat 刷新线程的一次检查：data_version 变化检查 + 增量读取新消息
+//   recent  - Database::getRecentChats（打开最近聊天列表）
+//   history - Database::getMessages（打开聊天记录）
+// 结束后汇总吞吐量、尾延迟、SQLITE_BUSY 失败次数和锁等待次数。
+// 指定 --server 时改为通过 ChatClient 连接运行中的 oicqd，同样的四种操作换成对应请求
+// （poll 为按 id 增量的 HISTORY），用于对比服务端的 epoll 与 io_uring 后端。
+// 再加 --coroutines 时模拟用户不再各占一个进程，而是协程会话（session.h），
+// 由 --threads 个 epoll 事件循环线程驱动，可以在一台机器上模拟上万个在线用户
+//
+// 用法: ./oicq_loadgen [--db 路径] [--clients K] [--duration 秒] [--send-rate R]
+//                      [--poll-interval 秒] [--recent-rate R] [--history-rate R]
+//                      [--server 地址:端口|套接字路径 [--coroutines] [--threads T]] ...
+// 需在项目根目录运行（读取 database/init.sql 建表）
+
+#include "database.h"
+#include "chat.h"
+#include "client.h"
+#include "session.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+
+int main() {
+    std::cerr << "oicq_loadgen 依赖 fork()，仅支持 Linux/macOS" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum OpType { OP_SEND, OP_POLL, OP_RECENT, OP_HISTORY, OP_COUNT };
+static const char* const kOpNames[OP_COUNT] = { "send", "poll", "recent", "history" };
+
+struct LoadOptions {
+    std::string path;
+    int clients;
+    double duration;        // 秒
+    double sendRate;        // 每个用户每秒发送消息数
+    double pollInterval;    // 秒，与 interactiveChat 的刷新间隔一致
+    double recentRate;      // 每个用户每秒打开最近聊天次数
+    double historyRate;     // 每个用户每秒打开聊天记录次数
+    double groupRatio;      // 在群聊中活动的比例
+    std::string journalMode;
+    unsigned seed;
+    std::string server;     // 非空时连接 oicqd：含 '/' 为 Unix 套接字路径，否则为 地址:端口
+    bool coroutines;        // 服务端模式下用协程会话代替进程
+    int threads;            // 协程模式的事件循环线程数
+
+    LoadOptions()
+        : path("loadgen.db"), clients(8), duration(10.0), sendRate(1.0), pollInterval(3.0),
+          recentRate(0.1), historyRate(0.2), groupRatio(0.3), journalMode("WAL"), seed(1),
+          coroutines(false), threads(1) {}
+};
+
+struct OpStats {
+    long long count;
+    long long failures;
+    long long busyFailures;
+    bench::LatencyStats latency;
+
+    OpStats() : count(0), failures(0), busyFailures(0) {}
+};
+
+static const char* kGroupName = "loadgroup";
+
+static std::string clientName(int i) {
+    return "load" + std::to_string(i);
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t size) {
+    char* p = (char*)data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static DatabaseOptions databaseOptions(const LoadOptions& opts) {
+    DatabaseOptions dbOpts = DatabaseOptions::fromEnvironment();
+    dbOpts.path = opts.path;
+    dbOpts.journalMode = opts.journalMode;
+    dbOpts.warmup = false;
+    return dbOpts;
+}
+
+static bool connectServer(ChatClient& client, const LoadOptions& opts) {
+    return client.connect(opts.server);
+}
+
+// 服务端模式下通过 oicqd 建立同样的数据集；用户和群已存在时沿用
+static bool prepareServerDataset(const LoadOptions& opts) {
+    ChatClient client;
+    if (!connectServer(client, opts)) {
+        std::cerr << "无法连接 oicqd: " << opts.server << std::endl;
+        return false;
+    }
+    for (int i = 0; i < opts.clients; ++i) client.registerUser(clientName(i), "123");
+    for (int i = 0; i < opts.clients; ++i) {
+        if (!client.login(clientName(i), "123")) {
+            std::cerr << "登录失败: " << client.error() << std::endl;
+            return false;
+        }
+        if (i == 0) client.createGroup(kGroupName);
+        client.addFriend(clientName((i + 1) % opts.clients));
+        client.joinGroup(kGroupName);
+    }
+    client.quit();
+    return true;
+}
+
+// 创建模拟用户、好友关系（环形）和公共群组
+static bool prepareDataset(const LoadOptions& opts) {
+    Database* db = Database::getInstance();
+    if (!db->initialize(databaseOptions(opts))) return false;
+
+    db->createGroup(kGroupName, clientName(0));
+    for (int i = 0; i < opts.clients; ++i) {
+        db->createUser(clientName(i), "123");
+    }
+    for (int i = 0; i < opts.clients; ++i) {
+        db->addFriend(clientName(i), clientName((i + 1) % opts.clients));
+        db->joinGroup(clientName(i), kGroupName);
+    }
+    db->close();
+    return true;
+}
+
+static bool writeStats(int fd, const OpStats* stats, long long busyWaits) {
+    for (int op = 0; op < OP_COUNT; ++op) {
+        const OpStats& s = stats[op];
+        long long header[4] = { s.count, s.failures, s.busyFailures, (long long)s.latency.samples.size() };
+        if (!writeAll(fd, header, sizeof(header))) return false;
+        if (!s.latency.samples.empty() &&
+            !writeAll(fd, s.latency.samples.data(), s.latency.samples.size() * sizeof(double))) return false;
+    }
+    return writeAll(fd, &busyWaits, sizeof(busyWaits));
+}
+
+// 模拟用户主循环，结果写入 fd
+static int runClient(int index, const LoadOptions& opts, int fd) {
+    Database* db = Database::getInstance();
+    if (!db->initialize(databaseOptions(opts))) return 1;
+
+    std::string self = clientName(index);
+    std::string partner = clientName((index + 1) % opts.clients);
+    Chat chat(self);
+    // 增量读取的起点，私聊和群聊各一个
+    long long lastSeenId[2] = { db->getLastMessageId(self, partner, false),
+                                db->getLastMessageId(self, kGroupName, true) };
+
+    std::mt19937 rng(opts.seed * 7919 + index);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    const double rates[OP_COUNT] = {
+        opts.sendRate, opts.pollInterval > 0 ? 1.0 / opts.pollInterval : 0.0, opts.recentRate, opts.historyRate
+    };
+    // 轮询按固定间隔（随机相位），其它操作按泊松过程到达
+    auto nextInterval = [&](int op) {
+        if (op == OP_POLL) return opts.pollInterval * 1e6;
+        std::exponential_distribution<double> gap(rates[op]);
+        return gap(rng) * 1e6;
+    };
+
+    double start = bench::nowMicros();
+    double deadline = start + opts.duration * 1e6;
+    double due[OP_COUNT];
+    for (int op = 0; op < OP_COUNT; ++op) {
+        due[op] = rates[op] > 0 ? start + (op == OP_POLL ? coin(rng) * opts.pollInterval * 1e6 : nextInterval(op)) : deadline + 1;
+    }
+
+    OpStats stats[OP_COUNT];
+    int sequence = 0;
+
+    while (true) {
+        int op = (int)(std::min_element(due, due + OP_COUNT) - due);
+        if (due[op] >= deadline) break;
+
+        double now = bench::nowMicros();
+        if (due[op] > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds((long long)(due[op] - now)));
+        }
+
+        bool isGroup = coin(rng) < opts.groupRatio;
+        std::string target = isGroup ? std::string(kGroupName) : partner;
+        bool ok = true;
+
+        double t0 = bench::nowMicros();
+        switch (op) {
+            case OP_SEND:
+                ok = chat.sendMessage(target, "load message " + std::to_string(sequence++) + " 压力测试", isGroup);
+                break;
+            case OP_POLL: {
+                db->checkExternalChanges();
+                long long& lastId = lastSeenId[isGroup ? 1 : 0];
+                ok = db->visitMessagesSince(self, target, isGroup, lastId, [&](const MessageView& msg) {
+                    lastId = msg.id;
+                    return true;
+                });
+                break;
+            }
+            case OP_RECENT:
+                db->getRecentChats(self, 20, 0);
+                break;
+            case OP_HISTORY:
+                db->getMessages(self, target, isGroup);
+                break;
+        }
+        double elapsed = bench::nowMicros() - t0;
+
+        int code = db->lastErrorCode() & 0xff;
+        bool busy = code == SQLITE_BUSY || code == SQLITE_LOCKED;
+        OpStats& s = stats[op];
+        s.count++;
+        if (!ok || busy) s.failures++;
+        if (busy) s.busyFailures++;
+        s.latency.add(elapsed);
+
+        due[op] += nextInterval(op);
+    }
+
+    long long busyWaits = db->getBusyWaits();
+    db->close();
+    return writeStats(fd, stats, busyWaits) ? 0 : 1;
+}
+
+// 服务端模式的模拟用户：与 runClient 的到达过程相同，每个操作是一次请求往返
+static int runServerClient(int index, const LoadOptions& opts, int fd) {
+    ChatClient client;
+    std::string self = clientName(index);
+    std::string partner = clientName((index + 1) % opts.clients);
+    if (!connectServer(client, opts) || !client.login(self, "123")) return 1;
+
+    std::vector<Message> messages;
+    std::vector<Database::RecentChat> chats;
+    long long lastSeenId[2] = { 0, 0 };
+    client.history(partner, false, 0, messages);
+    if (!messages.empty()) lastSeenId[0] = messages.back().id;
+    client.history(kGroupName, true, 0, messages);
+    if (!messages.empty()) lastSeenId[1] = messages.back().id;
+
+    std::mt19937 rng(opts.seed * 7919 + index);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    const double rates[OP_COUNT] = {
+        opts.sendRate, opts.pollInterval > 0 ? 1.0 / opts.pollInterval : 0.0, opts.recentRate, opts.historyRate
+    };
+    auto nextInterval = [&](int op) {
+        if (op == OP_POLL) return opts.pollInterval * 1e6;
+        std::exponential_distribution<double> gap(rates[op]);
+        return gap(rng) * 1e6;
+    };
+
+    double start = bench::nowMicros();
+    double deadline = start + opts.duration * 1e6;
+    double due[OP_COUNT];
+    for (int op = 0; op < OP_COUNT; ++op) {
+        due[op] = rates[op] > 0 ? start + (op == OP_POLL ? coin(rng) * opts.pollInterval * 1e6 : nextInterval(op)) : deadline + 1;
+    }
+
+    OpStats stats[OP_COUNT];
+    int sequence = 0;
+    while (client.isConnected()) {
+        int op = (int)(std::min_element(due, due + OP_COUNT) - due);
+        if (due[op] >= deadline) break;
+
+        double now = bench::nowMicros();
+        if (due[op] > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds((long long)(due[op] - now)));
+        }
+
+        bool isGroup = coin(rng) < opts.groupRatio;
+        std::string target = isGroup ? std::string(kGroupName) : partner;
+        bool ok = true;
+
+        double t0 = bench::nowMicros();
+        switch (op) {
+            case OP_SEND:
+                ok = client.send(target, isGroup, "load message " + std::to_string(sequence++) + " 压力测试");
+                break;
+            case OP_POLL: {
+                long long& lastId = lastSeenId[isGroup ? 1 : 0];
+                ok = client.history(target, isGroup, lastId, messages);
+                if (ok && !messages.empty()) lastId = messages.back().id;
+                break;
+            }
+            case OP_RECENT:
+                ok = client.recent(20, 0, chats);
+                break;
+            case OP_HISTORY:
+                ok = client.history(target, isGroup, 0, messages);
+                break;
+        }
+        double elapsed = bench::nowMicros() - t0;
+
+        OpStats& s = stats[op];
+        s.count++;
+        if (!ok) s.failures++;
+        s.latency.add(elapsed);
+        due[op] += nextInterval(op);
+    }
+    client.quit();
+    return writeStats(fd, stats, 0) ? 0 : 1;
+}
+
+// 协程模式的模拟用户：与 runServerClient 的到达过程相同，等待定时和应答时挂起，
+// 同一线程上的所有会话共用一个事件循环。跨越挂起点的状态都是成员变量
+class LoadSession : public AsyncSession {
+private:
+    const LoadOptions& opts;
+    std::string self;
+    std::string partner;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> coin;
+    double rates[OP_COUNT];
+    double due[OP_COUNT];
+    double deadline;
+    long long lastSeenId[2];
+    int sequence;
+    int op;                 // 当前操作
+    bool isGroup;
+    double started;         // 当前请求的发出时刻
+    bool completed;         // 跑完了整个时长
+
+    double nextInterval(int type) {
+        if (type == OP_POLL) return opts.pollInterval * 1e6;
+        std::exponential_distribution<double> gap(rates[type]);
+        return gap(rng) * 1e6;
+    }
+
+    void schedule() {
+        double start = bench::nowMicros();
+        deadline = start + opts.duration * 1e6;
+        for (int type = 0; type < OP_COUNT; ++type) {
+            due[type] = rates[type] > 0
+                            ? start + (type == OP_POLL ? coin(rng) * opts.pollInterval * 1e6 : nextInterval(type))
+                            : deadline + 1;
+        }
+    }
+
+    // 发出当前操作的请求；switch 不能包住 CO_AWAIT，所以单独成函数
+    void issue() {
+        isGroup = coin(rng) < opts.groupRatio;
+        std::string target = isGroup ? std::string(kGroupName) : partner;
+        started = bench::nowMicros();
+        switch (op) {
+            case OP_SEND:
+                request(protocol::OP_SEND, target, "load message " + std::to_string(sequence++) + " 压力测试", isGroup);
+                break;
+            case OP_POLL:
+                request(protocol::OP_HISTORY, target, std::string(), isGroup, lastSeenId[isGroup ? 1 : 0]);
+                break;
+            case OP_RECENT:
+                request(protocol::OP_RECENT, std::string(), std::string(), false, 20, 0);
+                break;
+            case OP_HISTORY:
+                request(protocol::OP_HISTORY, target, std::string(), isGroup, 0);
+                break;
+        }
+    }
+
+    void record() {
+        double elapsed = bench::nowMicros() - started;
+        bool ok = replyOk();
+        if (op == OP_POLL && ok && !reply.messages.empty()) lastSeenId[isGroup ? 1 : 0] = reply.messages.back().id;
+        OpStats& s = stats[op];
+        s.count++;
+        if (!ok) s.failures++;
+        s.latency.add(elapsed);
+        due[op] += nextInterval(op);
+    }
+
+protected:
+    void resume() {
+        CO_BEGIN(co);
+        request(protocol::OP_LOGIN, self, "123");
+        CO_AWAIT(co, replyReady());
+        if (!replyOk()) CO_RETURN(co);
+        request(protocol::OP_HISTORY, partner, std::string(), false, 0);
+        CO_AWAIT(co, replyReady());
+        if (!reply.messages.empty()) lastSeenId[0] = reply.messages.back().id;
+        request(protocol::OP_HISTORY, kGroupName, std::string(), true, 0);
+        CO_AWAIT(co, replyReady());
+        if (!reply.messages.empty()) lastSeenId[1] = reply.messages.back().id;
+
+        schedule();
+        while (!isFailed()) {
+            op = (int)(std::min_element(due, due + OP_COUNT) - due);
+            if (due[op] >= deadline) break;
+            sleepUntil(due[op]);
+            CO_AWAIT(co, timerDue());
+            issue();
+            CO_AWAIT(co, replyReady());
+            record();
+        }
+        completed = !isFailed();
+        request(protocol::OP_QUIT);
+        CO_AWAIT(co, replyReady());
+        CO_END(co);
+    }
+
+public:
+    OpStats stats[OP_COUNT];
+
+    LoadSession(int index, const LoadOptions& options)
+        : opts(options), self(clientName(index)), partner(clientName((index + 1) % options.clients)),
+          rng(options.seed * 7919 + index), coin(0.0, 1.0), deadline(0), sequence(0), op(0), isGroup(false),
+          started(0), completed(false) {
+        rates[OP_SEND] = opts.sendRate;
+        rates[OP_POLL] = opts.pollInterval > 0 ? 1.0 / opts.pollInterval : 0.0;
+        rates[OP_RECENT] = opts.recentRate;
+        rates[OP_HISTORY] = opts.historyRate;
+        lastSeenId[0] = lastSeenId[1] = 0;
+    }
+
+    bool ok() const { return completed; }
+};
+
+// 协程模式：会话 i 交给第 i % threads 个事件循环，结束后汇总统计；返回未正常完成的会话数
+static int runCoroutineClients(const LoadOptions& opts, OpStats* total) {
+    std::vector<std::unique_ptr<LoadSession> > sessions;
+    for (int i = 0; i < opts.clients; ++i) sessions.emplace_back(new LoadSession(i, opts));
+
+    int loops = std::min(opts.threads, opts.clients);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < loops; ++t) {
+        threads.push_back(std::thread([&sessions, &opts, loops, t]() {
+            SessionLoop loop;
+            if (!loop.start()) return;
+            for (size_t i = t; i < sessions.size(); i += loops) loop.add(sessions[i].get(), opts.server);
+            loop.run();
+        }));
+    }
+    for (auto& thread : threads) thread.join();
+
+    int failed = 0;
+    for (const auto& session : sessions) {
+        if (!session->ok()) failed++;
+        for (int op = 0; op < OP_COUNT; ++op) {
+            const OpStats& s = session->stats[op];
+            total[op].count += s.count;
+            total[op].failures += s.failures;
+            total[op].latency.samples.insert(total[op].latency.samples.end(), s.latency.samples.begin(),
+                                             s.latency.samples.end());
+        }
+    }
+    return failed;
+}
+
+// 进程模式：每个模拟用户 fork 一个进程，经管道收回统计；返回未正常上报的用户数，fork 失败时为 -1
+static int runProcessClients(const LoadOptions& opts, bool viaServer, OpStats* total, long long& busyWaits) {
+    std::vector<pid_t> children;
+    std::vector<int> pipes;
+    for (int i = 0; i < opts.clients; ++i) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return -1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return -1;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            int rc = viaServer ? runServerClient(i, opts, fds[1]) : runClient(i, opts, fds[1]);
+            close(fds[1]);
+            _exit(rc);
+        }
+        close(fds[1]);
+        children.push_back(pid);
+        pipes.push_back(fds[0]);
+    }
+
+    int failedClients = 0;
+
+    for (size_t c = 0; c < children.size(); ++c) {
+        bool ok = true;
+        for (int op = 0; op < OP_COUNT && ok; ++op) {
+            long long header[4];
+            ok = readAll(pipes[c], header, sizeof(header));
+            if (!ok) break;
+            std::vector<double> samples((size_t)header[3]);
+            if (!samples.empty()) {
+                ok = readAll(pipes[c], samples.data(), samples.size() * sizeof(double));
+            }
+            total[op].count += header[0];
+            total[op].failures += header[1];
+            total[op].busyFailures += header[2];
+            total[op].latency.samples.insert(total[op].latency.samples.end(), samples.begin(), samples.end());
+        }
+        long long waits = 0;
+        ok = ok && readAll(pipes[c], &waits, sizeof(waits));
+        busyWaits += waits;
+        close(pipes[c]);
+
+        int status = 0;
+        waitpid(children[c], &status, 0);
+        if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failedClients++;
+        }
+    }
+    return failedClients;
+}
+
+static void usage(const char* prog) {
+    std::cerr << "用法: " << prog << " [选项]\n"
+              << "  --db 路径            数据库文件 (默认 loadgen.db)\n"
+              << "  --clients K          模拟用户数 (默认 8)\n"
+              << "  --duration 秒        运行时长 (默认 10)\n"
+              << "  --send-rate R        每用户每秒发送消息数 (默认 1)\n"
+              << "  --poll-interval 秒   刷新轮询间隔 (默认 3，0 关闭)\n"
+              << "  --recent-rate R      每用户每秒打开最近聊天次数 (默认 0.1)\n"
+              << "  --history-rate R     每用户每秒打开聊天记录次数 (默认 0.2)\n"
+              << "  --group-ratio R      群聊活动比例 (默认 0.3)\n"
+              << "  --journal 模式       日志模式 (默认 WAL，可对比 DELETE)\n"
+              << "  --seed S             随机种子 (默认 1)\n"
+              << "  --server 地址        连接运行中的 oicqd (host:port 或 Unix 套接字路径)，不直接访问数据库\n"
+              << "  --coroutines         与 --server 连用：模拟用户为协程会话而非进程\n"
+              << "  --threads T          协程模式的事件循环线程数 (默认 1)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--db") && hasValue) opts.path = argv[++i];
+        else if (!strcmp(argv[i], "--clients") && hasValue) opts.clients = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--duration") && hasValue) opts.duration = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--send-rate") && hasValue) opts.sendRate = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--poll-interval") && hasValue) opts.pollInterval = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--recent-rate") && hasValue) opts.recentRate = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--history-rate") && hasValue) opts.historyRate = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--group-ratio") && hasValue) opts.groupRatio = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--journal") && hasValue) opts.journalMode = argv[++i];
+        else if (!strcmp(argv[i], "--seed") && hasValue) opts.seed = (unsigned)std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--server") && hasValue) opts.server = argv[++i];
+        else if (!strcmp(argv[i], "--coroutines")) opts.coroutines = true;
+        else if (!strcmp(argv[i], "--threads") && hasValue) opts.threads = std::atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.clients < 2 || opts.duration <= 0 || opts.threads < 1 || (opts.coroutines && opts.server.empty())) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bool viaServer = !opts.server.empty();
+    if (!(viaServer ? prepareServerDataset(opts) : prepareDataset(opts))) return 1;
+
+    std::cout << "启动 " << opts.clients << " 个模拟用户，运行 " << opts.duration << " 秒 ("
+              << (viaServer ? "oicqd " + opts.server : opts.journalMode + " 模式") << ")..." << std::endl;
+
+    OpStats total[OP_COUNT];
+    long long busyWaits = 0;
+    int failedClients;
+    if (opts.coroutines) {
+        std::cout << "协程模式: " << std::min(opts.threads, opts.clients) << " 个事件循环线程，每个会话对象 "
+                  << sizeof(LoadSession) << " 字节" << std::endl;
+        failedClients = runCoroutineClients(opts, total);
+    } else {
+        failedClients = runProcessClients(opts, viaServer, total, busyWaits);
+        if (failedClients < 0) return 1;
+    }
+
+    printf("\n%-8s %9s %10s %10s %10s %10s %10s %8s %9s\n",
+           "op", "count", "ops/s", "p50(us)", "p99(us)", "p99.9(us)", "max(us)", "failed", "busy");
+    printf("------------------------------------------------------------------------------------------\n");
+    long long allOps = 0, allBusy = 0;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        OpStats& s = total[op];
+        printf("%-8s %9lld %10.1f %10.0f %10.0f %10.0f %10.0f %8lld %9lld\n",
+               kOpNames[op], s.count, s.count / opts.duration,
+               s.latency.percentile(50), s.latency.percentile(99), s.latency.percentile(99.9),
+               s.latency.percentile(100), s.failures, s.busyFailures);
+        allOps += s.count;
+        allBusy += s.busyFailures;
+    }
+    printf("------------------------------------------------------------------------------------------\n");
+    printf("总吞吐量: %.1f ops/s   SQLITE_BUSY 失败: %lld   锁等待重试: %lld\n",
+           allOps / opts.duration, allBusy, busyWaits);
+    if (failedClients > 0) {
+        printf("警告: %d 个模拟用户未能正常上报结果\n", failedClients);
+    }
+    return failedClients > 0 ? 1 : 0;
+}
+
+#endif
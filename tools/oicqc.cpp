@@ -0,0 +1,192 @@
+// oicqd 的命令行瘦客户端：不打开数据库，所有操作经套接字交给服务进程，
+// 当前会话的新消息由服务端推送，和标准输入一起 poll，不轮询
+//
+// 用法: ./oicqc [--host 地址] [--port 端口] [--unix 套接字路径]
+// 命令:
+//   /register 用户名 密码      /login 用户名 密码
+//   /friend 用户名             /create 群名          /join 群名
+//   /chat 目标 [g]             进入与好友（加 g 为群聊）的会话，显示最新一屏并订阅推送
+//   /recent [页码]             最近聊天列表，每页 20 条
+//   /quit                      退出
+//   其它输入作为消息发送到当前会话
+
+#include "client.h"
+#include "server.h"
+#include "timefmt.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+static const int kRecentPageSize = 20;
+
+struct ClientState {
+    ChatClient client;
+    TimeFormatter timeFormatter;
+    std::string username;
+    std::string target;
+    bool isGroup;
+};
+
+static void printMessage(ClientState& state, const Message& msg) {
+    char timeText[TimeFormatter::kBufferSize];
+    state.timeFormatter.refresh();
+    size_t len = state.timeFormatter.formatMessageTime(msg.timestamp.data(), msg.timestamp.size(), timeText);
+    std::cout << "[" << std::string(timeText, len) << "] "
+              << (!msg.isGroup && msg.sender == state.username ? "我" : msg.sender) << ": " << msg.content << std::endl;
+}
+
+static void report(ClientState& state, bool ok, const char* success) {
+    if (ok) std::cout << success << std::endl;
+    else std::cout << "失败: " << state.client.error() << std::endl;
+}
+
+static void showRecent(ClientState& state, int page) {
+    std::vector<Database::RecentChat> chats;
+    bool hasMore = false;
+    if (!state.client.recent(kRecentPageSize, page * kRecentPageSize, chats, &hasMore)) {
+        report(state, false, "");
+        return;
+    }
+    char timeText[TimeFormatter::kBufferSize];
+    state.timeFormatter.refresh();
+    for (const auto& chat : chats) {
+        size_t len = state.timeFormatter.formatListTime(chat.lastTime.data(), chat.lastTime.size(), timeText);
+        std::cout << (chat.isGroup ? "[群] " : "[友] ") << chat.name << "  " << std::string(timeText, len)
+                  << "  " << chat.lastMessage << std::endl;
+    }
+    if (chats.empty()) std::cout << "暂无聊天记录" << std::endl;
+    if (hasMore) std::cout << "下一页: /recent " << page + 1 << std::endl;
+}
+
+static void openChat(ClientState& state, const std::string& target, bool isGroup) {
+    std::vector<Message> messages;
+    if (!state.client.history(target, isGroup, 0, messages) || !state.client.watch(target, isGroup)) {
+        report(state, false, "");
+        return;
+    }
+    state.target = target;
+    state.isGroup = isGroup;
+    std::cout << "=== " << (isGroup ? "群聊 " : "与 ") << target << (isGroup ? "" : " 聊天") << " ===" << std::endl;
+    for (const auto& msg : messages) printMessage(state, msg);
+}
+
+// 处理一行输入，返回 false 表示退出
+static bool handleInput(ClientState& state, const std::string& line) {
+    if (line.empty()) return true;
+    if (line[0] != '/') {
+        if (state.target.empty()) {
+            std::cout << "请先用 /chat 进入会话" << std::endl;
+            return true;
+        }
+        if (!state.client.send(state.target, state.isGroup, line)) {
+            report(state, false, "");
+            return state.client.isConnected();
+        }
+        // 自己的消息服务端不推送，本地回显
+        std::cout << (state.isGroup ? state.username : std::string("我")) << ": " << line << std::endl;
+        return true;
+    }
+
+    std::istringstream in(line);
+    std::string command, arg1, arg2;
+    in >> command >> arg1 >> arg2;
+
+    if (command == "/quit") {
+        state.client.quit();
+        return false;
+    } else if (command == "/register") {
+        report(state, state.client.registerUser(arg1, arg2), "注册成功");
+    } else if (command == "/login") {
+        bool ok = state.client.login(arg1, arg2);
+        if (ok) {
+            state.username = arg1;
+            state.target.clear();
+        }
+        report(state, ok, "登录成功");
+    } else if (command == "/friend") {
+        report(state, state.client.addFriend(arg1), "已添加好友");
+    } else if (command == "/create") {
+        report(state, state.client.createGroup(arg1), "群组已创建");
+    } else if (command == "/join") {
+        report(state, state.client.joinGroup(arg1), "已加入群组");
+    } else if (command == "/chat" && !arg1.empty()) {
+        openChat(state, arg1, arg2 == "g");
+    } else if (command == "/recent") {
+        showRecent(state, arg1.empty() ? 0 : std::atoi(arg1.c_str()));
+    } else {
+        std::cout << "命令: /register /login /friend /create /join /chat 目标 [g] /recent [页码] /quit" << std::endl;
+    }
+    return state.client.isConnected();
+}
+
+int main(int argc, char* argv[]) {
+    ServerOptions opts = ServerOptions::fromEnvironment();
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--host") && i + 1 < argc) opts.host = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opts.port = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--unix") && i + 1 < argc) opts.unixPath = argv[++i];
+        else {
+            std::cerr << "用法: " << argv[0] << " [--host 地址] [--port 端口] [--unix 套接字路径]" << std::endl;
+            return 1;
+        }
+    }
+
+    ClientState state;
+    state.isGroup = false;
+    bool connected = opts.unixPath.empty() ? state.client.connectTcp(opts.host, opts.port)
+                                           : state.client.connectUnix(opts.unixPath);
+    if (!connected) {
+        std::cerr << state.client.error() << std::endl;
+        return 1;
+    }
+    std::cout << "已连接 oicqd，输入 /register 或 /login 开始" << std::endl;
+
+#ifndef _WIN32
+    // 按字节读取标准输入，避免 stdio 缓冲吞掉 poll 看不到的数据
+    std::string pending;
+    while (state.client.isConnected()) {
+        struct pollfd fds[2];
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = state.client.socketFd();
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0) continue;
+
+        if (fds[1].revents) {
+            Message msg;
+            while (state.client.readPush(msg, 0)) printMessage(state, msg);
+        }
+        if (fds[0].revents) {
+            char buffer[4096];
+            ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n <= 0) {
+                state.client.quit();
+                break;
+            }
+            pending.append(buffer, n);
+            size_t newline;
+            bool keep = true;
+            while (keep && (newline = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                keep = handleInput(state, line);
+            }
+            if (!keep) break;
+        }
+    }
+    if (!state.client.isConnected()) std::cout << "连接已关闭" << std::endl;
+#else
+    std::string line;
+    while (std::getline(std::cin, line) && handleInput(state, line)) {}
+#endif
+    return 0;
+}
@@ -0,0 +1,96 @@
+// oicq 聊天服务进程：持有唯一的数据库连接，通过 TCP / Unix 套接字为 oicqc 等瘦客户端提供
+// 登录、收发消息、历史记录、最近聊天和新消息推送，协议见 include/protocol.h
+//
+// 用法: ./oicqd [--db 路径] [--host 地址] [--port 端口] [--unix 套接字路径] [--max-clients N]
+//              [--io epoll|io_uring] [--message-log 路径] [--workers N]
+//       --host 传空串时只监听 Unix 套接字；监听参数也可通过 OICQ_SERVER_* 环境变量设置
+//       io_uring 不可用时退回 epoll；退出时打印请求数与 I/O 系统调用次数，便于对比两种后端
+// 需在项目根目录运行（读取 database/init.sql），SIGINT / SIGTERM 退出
+
+#include "database.h"
+#include "server.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static ChatServer* runningServer = nullptr;
+
+static void onSignal(int) {
+    if (runningServer) runningServer->stop();
+}
+
+static int usage(const char* argv0) {
+    std::cerr << "用法: " << argv0 << " [--db 路径] [--host 地址] [--port 端口] [--unix 套接字路径] [--max-clients N]"
+              << " [--io epoll|io_uring] [--message-log 路径] [--workers N]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    // 常驻进程，启动时预读一次热点页
+    DatabaseOptions defaults;
+    defaults.warmup = true;
+    DatabaseOptions dbOpts = DatabaseOptions::fromEnvironment(defaults);
+    ServerOptions opts = ServerOptions::fromEnvironment();
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) dbOpts.path = argv[++i];
+        else if (!strcmp(argv[i], "--host") && i + 1 < argc) opts.host = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opts.port = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--unix") && i + 1 < argc) opts.unixPath = argv[++i];
+        else if (!strcmp(argv[i], "--max-clients") && i + 1 < argc) opts.maxClients = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--io") && i + 1 < argc) opts.ioBackend = argv[++i];
+        else if (!strcmp(argv[i], "--message-log") && i + 1 < argc) opts.messageLogPath = argv[++i];
+        else if (!strcmp(argv[i], "--workers") && i + 1 < argc) opts.workers = std::atoi(argv[++i]);
+        else return usage(argv[0]);
+    }
+    if (opts.ioBackend != "epoll" && opts.ioBackend != "io_uring") return usage(argv[0]);
+    if (opts.workers < 0) return usage(argv[0]);
+
+    Database* db = Database::getInstance();
+    if (!db->initialize(dbOpts)) {
+        std::cerr << "无法打开数据库: " << dbOpts.path << std::endl;
+        return 1;
+    }
+
+    ChatServer server;
+    if (!server.start(opts)) {
+        std::cerr << "无法监听 " << opts.host << ":" << opts.port
+                  << (opts.unixPath.empty() ? "" : " / " + opts.unixPath) << std::endl;
+        db->close();
+        return 1;
+    }
+    if (!opts.host.empty()) std::cerr << "oicqd 监听 " << opts.host << ":" << server.tcpPort() << std::endl;
+    if (!opts.unixPath.empty()) std::cerr << "oicqd 监听 " << opts.unixPath << std::endl;
+    if (opts.ioBackend != server.ioBackend()) std::cerr << opts.ioBackend << " 不可用，改用 " << server.ioBackend() << std::endl;
+    else if (server.fixedBufferBytes() > 0) {
+        std::cerr << "I/O 后端 " << server.ioBackend() << "，固定缓冲区 " << server.fixedBufferBytes() / 1024 << " KiB"
+                  << std::endl;
+    } else {
+        std::cerr << "I/O 后端 " << server.ioBackend() << std::endl;
+    }
+    if (opts.workers > 0) std::cerr << "推送编码线程 " << opts.workers << " 个" << std::endl;
+
+    runningServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    server.run();
+    runningServer = nullptr;
+    db->close();
+    long long requests = server.requestCount();
+    long long calls = server.ioSyscallCount();
+    std::cerr << "oicqd 已退出：处理请求 " << requests << " 个，I/O 系统调用 " << calls << " 次";
+    if (requests > 0) std::cerr << "（每请求 " << (double)calls / requests << " 次）";
+    std::cerr << std::endl;
+    Scheduler::Stats pool = server.workerStats();
+    if (pool.tasks > 0) {
+        std::cerr << "推送编码任务 " << pool.tasks << " 个，排队 p50/p99 " << pool.queueP50 << "/" << pool.queueP99
+                  << " us，执行 p50/p99 " << pool.runP50 << "/" << pool.runP99 << " us，窃取 " << pool.stolen
+                  << "，亲和命中 " << pool.affinityHits << "/" << pool.affinityTasks << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+// 查询计划回归检查：对 Database 发出的每条语句执行 EXPLAIN QUERY PLAN，
+// 热点表 (messages / friendships / group_members) 上出现 SCAN 即判定失败；
+// 唯一的例外是按 rowid 倒序、LIMIT 常数的表尾读取。带 INDEXED BY 的语句还要求计划中有用该索引的 SEARCH
+//
+// 语句集合不是手工维护的：先在夹具库上调用 Database 的全部公开方法，
+// 由 QueryProfiler 收集实际执行过的 SQL，再逐条检查其计划。
+// 分两轮检查：未收集统计信息的新库，以及 ANALYZE 之后的库。
+//
+// 用法: ./oicq_plancheck [--db 路径] [--verbose]   (make check-plans)
+// 需在项目根目录运行（读取 database/init.sql 建表）
+
+#include "database.h"
+#include "seed.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// 需要保证走索引检索的热点表
+static const char* const kHotTables[] = { "messages", "friendships", "group_members", "group_inbox" };
+
+// 整条语句免检的片段；只用于一次性执行的语句，热点查询不能加在这里
+static const char* const kAllowedScans[] = {
+    // init.sql 中群成员计数的一次性补齐，仅在计数表为空时执行
+    "WHERE NOT EXISTS (SELECT 1 FROM group_member_counts)",
+};
+
+static bool isHotTable(const std::string& name) {
+    for (const char* table : kHotTables) {
+        if (name == table) return true;
+    }
+    return false;
+}
+
+static std::string upper(std::string s) {
+    for (auto& c : s) c = (char)std::toupper((unsigned char)c);
+    return s;
+}
+
+// 收集语句中热点表的名字及其别名（"messages m" / "messages AS m"）
+static std::set<std::string> hotTableNames(const std::string& sql) {
+    static const char* const keywords[] = {
+        "WHERE", "INNER", "LEFT", "JOIN", "ON", "GROUP", "ORDER", "LIMIT", "SET", "VALUES",
+        "INDEXED", "NOT", "USING", "UNION", "CROSS", "NATURAL", "OUTER"
+    };
+
+    std::vector<std::string> tokens;
+    std::string current;
+    for (char c : sql) {
+        if (std::isalnum((unsigned char)c) || c == '_') {
+            current += c;
+        } else {
+            if (!current.empty()) tokens.push_back(current);
+            current.clear();
+        }
+    }
+    if (!current.empty()) tokens.push_back(current);
+
+    std::set<std::string> names;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (!isHotTable(tokens[i])) continue;
+        names.insert(tokens[i]);
+
+        size_t j = i + 1;
+        if (j < tokens.size() && upper(tokens[j]) == "AS") ++j;
+        if (j >= tokens.size()) continue;
+        bool keyword = false;
+        for (const char* k : keywords) {
+            if (upper(tokens[j]) == k) keyword = true;
+        }
+        if (!keyword) names.insert(tokens[j]);
+    }
+    return names;
+}
+
+// 计划行中被扫描的对象："SCAN m" / "SCAN messages USING ..." / 旧版本的 "SCAN TABLE messages AS m"
+static std::string scannedName(const std::string& detail) {
+    if (detail.compare(0, 5, "SCAN ") != 0) return "";
+    std::string rest = detail.substr(5);
+    if (rest.compare(0, 6, "TABLE ") == 0) rest = rest.substr(6);
+    size_t end = rest.find(' ');
+    return end == std::string::npos ? rest : rest.substr(0, end);
+}
+
+// 读取 pos 处的标识符（可带双引号），pos 移到其后
+static std::string readIdentifier(const std::string& sql, size_t& pos) {
+    std::string name;
+    if (pos < sql.size() && sql[pos] == '"') {
+        size_t end = sql.find('"', pos + 1);
+        if (end == std::string::npos) return "";
+        name = sql.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        return name;
+    }
+    while (pos < sql.size() && (std::isalnum((unsigned char)sql[pos]) || sql[pos] == '_')) name += sql[pos++];
+    return name;
+}
+
+// 有界的表尾读取 "FROM 表 ORDER BY rowid|id DESC LIMIT 常数"（启动预读），计划中是不带索引的 "SCAN 表"；
+// 返回每个表出现的次数，每处只放行一行这样的 SCAN
+static std::map<std::string, int> boundedTailScans(const std::string& sql) {
+    static const char* const tails[] = { " ORDER BY rowid DESC LIMIT ", " ORDER BY id DESC LIMIT " };
+    std::map<std::string, int> tables;
+    for (size_t from = sql.find("FROM "); from != std::string::npos; from = sql.find("FROM ", from + 5)) {
+        size_t pos = from + 5;
+        std::string table = readIdentifier(sql, pos);
+        if (table.empty()) continue;
+        for (const char* tail : tails) {
+            size_t length = std::strlen(tail);
+            if (sql.compare(pos, length, tail) == 0 && pos + length < sql.size() &&
+                std::isdigit((unsigned char)sql[pos + length])) {
+                ++tables[table];
+            }
+        }
+    }
+    return tables;
+}
+
+// 语句中 INDEXED BY 指定的索引
+static std::vector<std::string> hintedIndexes(const std::string& sql) {
+    std::vector<std::string> indexes;
+    for (size_t at = sql.find("INDEXED BY "); at != std::string::npos; at = sql.find("INDEXED BY ", at + 11)) {
+        size_t pos = at + 11;
+        std::string index = readIdentifier(sql, pos);
+        if (!index.empty()) indexes.push_back(index);
+    }
+    return indexes;
+}
+
+struct PlanResult {
+    std::string sql;
+    std::vector<std::string> plan;
+    std::vector<std::string> violations;
+    bool allowed;
+};
+
+static PlanResult checkPlan(sqlite3* conn, const std::string& sql) {
+    PlanResult result;
+    result.sql = sql;
+    result.allowed = false;
+    for (const char* pattern : kAllowedScans) {
+        if (sql.find(pattern) != std::string::npos) result.allowed = true;
+    }
+
+    sqlite3_stmt* stmt;
+    std::string explain = "EXPLAIN QUERY PLAN " + sql;
+    if (sqlite3_prepare_v2(conn, explain.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        result.violations.push_back(std::string("无法分析: ") + sqlite3_errmsg(conn));
+        return result;
+    }
+
+    std::set<std::string> names = hotTableNames(sql);
+    std::map<std::string, int> bounded = boundedTailScans(sql);
+    std::vector<std::string> hints = hintedIndexes(sql);
+    std::vector<bool> searched(hints.size(), false);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* text = (const char*)sqlite3_column_text(stmt, 3);
+        std::string detail = text ? text : "";
+        result.plan.push_back(detail);
+
+        std::string scanned = scannedName(detail);
+        if (!scanned.empty() && names.count(scanned) && !result.allowed) {
+            // 表尾读取按 rowid 倒序，不使用任何索引；带 USING 的是索引全扫描，照样判定失败
+            if (detail.find(" USING ") == std::string::npos && bounded[scanned] > 0) --bounded[scanned];
+            else result.violations.push_back(detail);
+        }
+        for (size_t i = 0; i < hints.size(); ++i) {
+            if (detail.compare(0, 7, "SEARCH ") == 0 && detail.find(" INDEX " + hints[i] + " (") != std::string::npos) {
+                searched[i] = true;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    for (size_t i = 0; i < hints.size(); ++i) {
+        if (!searched[i]) result.violations.push_back("INDEXED BY " + hints[i] + " 没有对应的 SEARCH");
+    }
+    return result;
+}
+
+// 调用 Database 的全部公开方法，让每条语句至少执行一次
+static void exerciseDatabase(Database* db) {
+    std::string a = bench::userName(0);
+    std::string b = bench::userName(1);
+    std::string group = bench::groupName(0);
+
+    db->createUser("plan_user", "123");
+    db->userExists(a);
+    db->validateUser(a, "123");
+    db->getUserId(a);
+    db->verifySystemPassword("admin123");
+    db->addFriend("plan_user", a);
+    db->getFriends(a);
+    db->areFriends(a, b);
+    db->createGroup("plan_group", "plan_user");
+    db->joinGroup(a, "plan_group");
+    db->getUserGroups(a);
+    db->getGroupMembers(group);
+    db->getGroupMembers(group, bench::userName(3), 5);
+    db->getGroupMemberCount(group);
+    db->importGroupMembers("plan_group", { bench::userName(2), bench::userName(3) });
+    std::vector<Database::MembershipResult> results;
+    db->removeFromGroupBulk("plan_group", { bench::userName(3), "plan_nobody" }, results);
+    db->isGroupCreator(a, group);
+    db->isGroupMember(a, group);
+    // 有订阅者时写入消息才会触发通知查询
+    MessageNotifier& notifier = db->getNotifier();
+    MessageNotifier::Subscription* sub = notifier.subscribe(MessageNotifier::conversationKey(a, b, false), "");
+    db->saveMessage(a, b, "plan check", false);
+    db->saveMessage(a, group, "plan check", true);
+    // 夹具群达到写扩散阈值：上一条已切换为写扩散，之后加入、发言和删除都要维护收件箱
+    db->joinGroup("plan_user", group);
+    db->importGroupMembers(group, { bench::userName(30), bench::userName(31) });
+    db->saveMessage("plan_user", group, "plan check", true);
+    
+    // 另一个连接提交后增量读取
+    sqlite3* other;
+    if (sqlite3_open(db->getOptions().path.c_str(), &other) == SQLITE_OK) {
+        sqlite3_exec(other, "INSERT INTO messages (sender, receiver, content) VALUES ('user1', 'user0', 'plan check')", 0, 0, 0);
+    }
+    sqlite3_close(other);
+    db->checkExternalChanges();
+    notifier.unsubscribe(sub);
+    db->dataVersion();
+    db->getLastMessageId(a, b, false);
+    db->getLastMessageId(a, group, true);
+    db->visitMessagesSince(a, b, false, 0, [](const MessageView&) { return true; });
+    db->visitMessagesSince(a, group, true, 0, [](const MessageView&) { return true; });
+    db->getMessages(a, b, false);
+    db->getMessages(a, group, true);
+    // 会话缓存：首次读取整个窗口，写入后再次进入只增量读取
+    auto ignore = [](const MessageView&) { return true; };
+    db->visitConversation(a, b, false, ignore);
+    db->visitConversation(a, group, true, ignore);
+    db->saveMessage(b, a, "plan check", false);
+    db->visitConversation(a, b, false, ignore);
+    db->getRecentChats(a);
+    db->getRecentChats(a, 2, 1);
+    db->removeFromGroup(a, "plan_group");
+    db->removeFromGroup(a, group);
+    db->deleteUserData("plan_user");
+}
+
+static int runRound(const std::string& title, sqlite3* conn, const std::vector<std::string>& statements, bool verbose) {
+    int failures = 0;
+    std::cout << "\n========== " << title << " ==========" << std::endl;
+    for (const auto& sql : statements) {
+        PlanResult r = checkPlan(conn, sql);
+        bool ok = r.violations.empty();
+        if (!ok) failures++;
+
+        printf("[%s] %s\n", ok ? (r.allowed ? "SKIP" : " OK ") : "FAIL",
+               QueryProfiler::summarizeSql(sql, 100).c_str());
+        if (!ok || verbose) {
+            for (const auto& line : r.plan) {
+                printf("         %s\n", line.c_str());
+            }
+        }
+        for (const auto& v : r.violations) {
+            printf("         >>> 热点表未走索引: %s\n", v.c_str());
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = "plancheck.db";
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) path = argv[++i];
+        else if (!strcmp(argv[i], "--verbose")) verbose = true;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--db 路径] [--verbose]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::remove(path.c_str());
+    DatabaseOptions opts;
+    opts.path = path;
+    opts.profile = true;            // 从剖析器收集执行过的语句
+    opts.slowLogPath = "";
+    opts.warmup = true;             // 预读探测也要经过检查，且每个索引一条
+    opts.fanoutMinMembers = 10;     // 种子群 20 人走写扩散，plan_group 仍是读扩散
+
+    // 夹具：真实的 init.sql 模式 + 少量种子数据
+    Database* db = Database::getInstance();
+    if (!db->initialize(opts)) return 1;
+    db->close();
+    bench::SeedConfig seed;
+    seed.users = 200;
+    seed.groups = 10;
+    seed.messages = 5000;
+    if (!bench::seedDatabase(path, seed)) {
+        std::cerr << "生成夹具数据失败" << std::endl;
+        return 1;
+    }
+
+    if (!db->initialize(opts)) return 1;
+    exerciseDatabase(db);
+
+    std::vector<std::string> statements;
+    for (const auto& s : db->getProfiler().snapshot()) {
+        statements.push_back(s.sql);
+    }
+    std::sort(statements.begin(), statements.end());
+    db->close();
+
+    sqlite3* conn;
+    if (sqlite3_open(path.c_str(), &conn) != SQLITE_OK) return 1;
+
+    // 启动预读对每个索引发出一条 INDEXED BY 探测，上面的检查保证它们都按该索引 SEARCH；
+    // 这里再确认探测一条不少，新增的索引也被预读并检查
+    int indexes = 0, probes = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(conn, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index'", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) indexes = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    for (const auto& sql : statements) {
+        if (hintedIndexes(sql).size() == 1 && boundedTailScans(sql).size() == 1) ++probes;
+    }
+
+    int failures = runRound("无统计信息", conn, statements, verbose);
+    sqlite3_exec(conn, "ANALYZE", 0, 0, 0);
+    sqlite3_close(conn);
+    // 重新打开，使规划器加载 sqlite_stat1
+    sqlite3_open(path.c_str(), &conn);
+    failures += runRound("ANALYZE 之后", conn, statements, verbose);
+    sqlite3_close(conn);
+
+    std::cout << "\n预读探测 " << probes << " 条，索引 " << indexes << " 个" << std::endl;
+    if (probes != indexes) {
+        std::cout << ">>> 预读探测与索引数不符" << std::endl;
+        failures++;
+    }
+
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+
+    std::cout << "\n共检查 " << statements.size() << " 条语句，"
+              << (failures == 0 ? "全部通过" : std::to_string(failures) + " 处计划回退为全表扫描") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+// 二进制协议编解码的随机测试：
+//   1. 往返：随机请求、消息批次、最近聊天批次编码后再解码，逐字段比较（文本含任意字节）
+//   2. 变异：对合法帧翻转、截断、插入字节或改写长度前缀，再交给全部解码入口，
+//      要求不崩溃、返回的每个视图都落在输入缓冲区之内
+//   3. 纯随机字节
+// 输入拷贝到大小恰好的堆缓冲区，配合 -fsanitize=address 编译可发现越界读取。
+// 用 clang -fsanitize=fuzzer -DOICQ_LIBFUZZER 编译时改为 libFuzzer 入口，只做第 2、3 类检查
+//
+// 用法: ./oicq_protofuzz [--iterations N] [--seed S]
+// 发现问题时打印种子与迭代序号并返回非零
+
+#include "protocol.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace protocol;
+
+static bool inside(const TextView& view, const char* data, size_t size) {
+    if (view.size < 0) return false;
+    if (view.size == 0) return true;
+    return view.data >= data && view.data + view.size <= data + size;
+}
+
+// 用全部解码入口处理一段输入，返回 false 表示视图越界
+static bool decodeAll(const char* data, size_t size) {
+    const char* body;
+    size_t bodySize, frameSize;
+    while (size > 0) {
+        FrameStatus status = peekFrame(data, size, kMaxResponseBytes, body, bodySize, frameSize);
+        if (status != FRAME_OK) break;
+        if (body < data || body + bodySize > data + size || frameSize > size || bodySize == 0) return false;
+
+        Request request;
+        if (decodeRequest(body, bodySize, request)) {
+            if (!inside(request.text1, body, bodySize) || !inside(request.text2, body, bodySize)) return false;
+        }
+        MessageBatchReader messages(body + 1, bodySize - 1);
+        WireMessage msg;
+        while (messages.next(msg)) {
+            if (!inside(msg.sender, body, bodySize) || !inside(msg.receiver, body, bodySize) ||
+                !inside(msg.content, body, bodySize) || (msg.rawTime.data && !inside(msg.rawTime, body, bodySize))) {
+                return false;
+            }
+            toMessage(msg);
+        }
+        ChatBatchReader chats(body + 1, bodySize - 1);
+        WireChat chat;
+        while (chats.next(chat)) {
+            if (!inside(chat.name, body, bodySize) || !inside(chat.lastMessage, body, bodySize) ||
+                (chat.rawTime.data && !inside(chat.rawTime, body, bodySize))) {
+                return false;
+            }
+            timeText(chat.time, chat.rawTime);
+        }
+        data += frameSize;
+        size -= frameSize;
+    }
+    return true;
+}
+
+// 拷贝到恰好大小的堆缓冲区再解码，越界读取会落在分配之外
+static bool decodeExact(const std::string& input) {
+    std::vector<char> buffer(input.begin(), input.end());
+    return decodeAll(buffer.empty() ? nullptr : &buffer[0], buffer.size());
+}
+
+#ifdef OICQ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (!decodeAll((const char*)data, size)) std::abort();
+    return 0;
+}
+
+#else
+
+typedef std::mt19937_64 Rng;
+
+static size_t pick(Rng& rng, size_t n) {
+    return (size_t)(rng() % n);
+}
+
+static std::string randomText(Rng& rng) {
+    size_t len = pick(rng, 10) == 0 ? pick(rng, 3000) : pick(rng, 24);
+    std::string text(len, '\0');
+    for (size_t i = 0; i < len; ++i) text[i] = (char)pick(rng, 256);
+    return text;
+}
+
+static std::string randomTimestamp(Rng& rng) {
+    switch (pick(rng, 10)) {
+        case 0: return "2024-02-30 10:00:00";       // 不存在的日期，按原文传输
+        case 1: return randomText(rng);
+        case 2: return "";
+        default: {
+            char buffer[20];
+            // 1970 到 2100 年之间
+            formatTimestamp((long long)pick(rng, 4102444800ULL), buffer);
+            return std::string(buffer, 19);
+        }
+    }
+}
+
+static const Opcode kRequestOps[] = {
+    OP_PING, OP_REGISTER, OP_LOGIN, OP_FRIEND, OP_CREATE_GROUP, OP_JOIN_GROUP,
+    OP_SEND, OP_HISTORY, OP_RECENT, OP_WATCH, OP_UNWATCH, OP_QUIT,
+};
+
+static long long randomNumber(Rng& rng) {
+    switch (pick(rng, 4)) {
+        case 0: return 0;
+        case 1: return (long long)rng();                 // 含负数和极值
+        default: return (long long)pick(rng, 1000000);
+    }
+}
+
+static bool sameText(const TextView& view, const std::string& text) {
+    return view == text;
+}
+
+static bool checkRequest(Rng& rng, std::vector<std::string>& corpus) {
+    Opcode op = kRequestOps[pick(rng, sizeof(kRequestOps) / sizeof(kRequestOps[0]))];
+    std::string text1 = randomText(rng), text2 = randomText(rng);
+    Request request;
+    request.op = op;
+    request.text1 = textOf(text1);
+    request.text2 = textOf(text2);
+    request.isGroup = pick(rng, 2) == 1;
+    request.number1 = randomNumber(rng);
+    request.number2 = randomNumber(rng);
+
+    std::string frame;
+    encodeRequest(frame, request);
+    corpus.push_back(frame);
+
+    const char* body;
+    size_t bodySize, frameSize;
+    Request decoded;
+    if (peekFrame(frame.data(), frame.size(), kMaxResponseBytes, body, bodySize, frameSize) != FRAME_OK ||
+        frameSize != frame.size() || !decodeRequest(body, bodySize, decoded) || decoded.op != op) {
+        return false;
+    }
+    switch (op) {
+        case OP_REGISTER:
+        case OP_LOGIN:
+            return sameText(decoded.text1, text1) && sameText(decoded.text2, text2);
+        case OP_FRIEND:
+        case OP_CREATE_GROUP:
+        case OP_JOIN_GROUP:
+            return sameText(decoded.text1, text1);
+        case OP_SEND:
+            return sameText(decoded.text1, text1) && decoded.isGroup == request.isGroup && sameText(decoded.text2, text2);
+        case OP_HISTORY:
+            return sameText(decoded.text1, text1) && decoded.isGroup == request.isGroup &&
+                   decoded.number1 == request.number1;
+        case OP_RECENT:
+            return decoded.number1 == request.number1 && decoded.number2 == request.number2;
+        case OP_WATCH:
+            return sameText(decoded.text1, text1) && decoded.isGroup == request.isGroup;
+        default:
+            return true;
+    }
+}
+
+static bool checkMessages(Rng& rng, std::vector<std::string>& corpus) {
+    // 小名字池让“同上一条”标志经常出现
+    std::vector<std::string> names;
+    for (int i = 0; i < 4; ++i) names.push_back(randomText(rng));
+    std::vector<Message> messages(pick(rng, 40));
+    int id = (int)pick(rng, 1000000);
+    for (auto& msg : messages) {
+        id += pick(rng, 8) == 0 ? -(int)pick(rng, 1000) : (int)pick(rng, 5);
+        msg.id = id;
+        msg.sender = names[pick(rng, names.size())];
+        msg.receiver = names[pick(rng, names.size())];
+        msg.content = randomText(rng);
+        msg.timestamp = randomTimestamp(rng);
+        msg.isGroup = pick(rng, 2) == 1;
+    }
+    bool more = pick(rng, 2) == 1;
+
+    std::string frame;
+    MessageBatchWriter writer(frame, pick(rng, 2) ? OP_MESSAGES : OP_PUSH);
+    for (const auto& msg : messages) writer.add(viewOf(msg));
+    writer.finish(more);
+    corpus.push_back(frame);
+
+    const char* body;
+    size_t bodySize, frameSize;
+    if (peekFrame(frame.data(), frame.size(), kMaxResponseBytes, body, bodySize, frameSize) != FRAME_OK ||
+        frameSize != frame.size()) {
+        return false;
+    }
+    MessageBatchReader reader(body + 1, bodySize - 1);
+    WireMessage wire;
+    size_t count = 0;
+    while (reader.next(wire)) {
+        if (count >= messages.size()) return false;
+        Message decoded = toMessage(wire);
+        const Message& expected = messages[count++];
+        if (decoded.id != expected.id || decoded.sender != expected.sender || decoded.receiver != expected.receiver ||
+            decoded.content != expected.content || decoded.timestamp != expected.timestamp ||
+            decoded.isGroup != expected.isGroup) {
+            return false;
+        }
+    }
+    return reader.ok() && count == messages.size() && reader.hasMore() == more;
+}
+
+static bool checkChats(Rng& rng, std::vector<std::string>& corpus) {
+    struct Chat {
+        std::string name, lastTime, lastMessage;
+        bool isGroup;
+    };
+    std::vector<Chat> chats(pick(rng, 30));
+    for (auto& chat : chats) {
+        chat.name = randomText(rng);
+        chat.lastTime = randomTimestamp(rng);
+        chat.lastMessage = randomText(rng);
+        chat.isGroup = pick(rng, 2) == 1;
+    }
+    bool more = pick(rng, 2) == 1;
+
+    std::string frame;
+    ChatBatchWriter writer(frame, more);
+    for (const auto& chat : chats) {
+        writer.add(textOf(chat.name), chat.isGroup, textOf(chat.lastTime), textOf(chat.lastMessage));
+    }
+    writer.finish();
+    corpus.push_back(frame);
+
+    const char* body;
+    size_t bodySize, frameSize;
+    if (peekFrame(frame.data(), frame.size(), kMaxResponseBytes, body, bodySize, frameSize) != FRAME_OK) return false;
+    ChatBatchReader reader(body + 1, bodySize - 1);
+    WireChat wire;
+    size_t count = 0;
+    while (reader.next(wire)) {
+        if (count >= chats.size()) return false;
+        const Chat& expected = chats[count++];
+        if (!(wire.name == expected.name) || !(wire.lastMessage == expected.lastMessage) ||
+            timeText(wire.time, wire.rawTime) != expected.lastTime || wire.isGroup != expected.isGroup) {
+            return false;
+        }
+    }
+    return reader.ok() && count == chats.size() && reader.hasMore() == more;
+}
+
+static bool checkTimestamp(Rng& rng) {
+    // 0000 年到 9999 年
+    long long seconds = -62167219200LL + (long long)pick(rng, 315537897600ULL);
+    char text[20];
+    formatTimestamp(seconds, text);
+    long long parsed;
+    return parseTimestamp(text, 19, parsed) && parsed == seconds;
+}
+
+static std::string mutate(Rng& rng, const std::string& input) {
+    std::string data = input;
+    int rounds = 1 + (int)pick(rng, 4);
+    for (int r = 0; r < rounds; ++r) {
+        switch (pick(rng, 5)) {
+            case 0:
+                if (!data.empty()) data[pick(rng, data.size())] ^= (char)(1 << pick(rng, 8));
+                break;
+            case 1:
+                if (!data.empty()) data.resize(pick(rng, data.size()));
+                break;
+            case 2:
+                data.insert(pick(rng, data.size() + 1), 1, (char)pick(rng, 256));
+                break;
+            case 3: {
+                // 改写长度前缀，让正文长度与实际不符
+                std::string prefix;
+                putVarint(prefix, pick(rng, data.size() + 16));
+                size_t old = 0;
+                while (old < data.size() && (data[old] & 0x80)) ++old;
+                data.replace(0, old < data.size() ? old + 1 : old, prefix);
+                break;
+            }
+            default:
+                if (!data.empty()) data[pick(rng, data.size())] = (char)pick(rng, 256);
+        }
+    }
+    return data;
+}
+
+int main(int argc, char* argv[]) {
+    long long iterations = 20000;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "用法: " << argv[0] << " [--iterations N] [--seed S]" << std::endl;
+            return 1;
+        }
+    }
+
+    Rng rng(seed);
+    std::vector<std::string> corpus;
+    long long mutated = 0;
+    for (long long i = 0; i < iterations; ++i) {
+        const char* failed = nullptr;
+        corpus.clear();
+        if (!checkRequest(rng, corpus)) failed = "请求往返";
+        else if (!checkMessages(rng, corpus)) failed = "消息批次往返";
+        else if (!checkChats(rng, corpus)) failed = "最近聊天批次往返";
+        else if (!checkTimestamp(rng)) failed = "时间往返";
+
+        // 多个合法帧拼接后变异，覆盖帧边界
+        std::string stream;
+        for (const auto& frame : corpus) stream += frame;
+        for (int m = 0; m < 4 && !failed; ++m, ++mutated) {
+            if (!decodeExact(mutate(rng, corpus[pick(rng, corpus.size())])) || !decodeExact(mutate(rng, stream))) {
+                failed = "变异输入越界";
+            }
+        }
+        std::string noise(pick(rng, 64), '\0');
+        for (auto& c : noise) c = (char)pick(rng, 256);
+        if (!failed && !decodeExact(noise)) failed = "随机输入越界";
+
+        if (failed) {
+            std::fprintf(stderr, "失败: %s (seed %llu, 第 %lld 次)\n", failed, seed, i);
+            return 1;
+        }
+    }
+    std::printf("%lld 次往返、%lld 个变异输入，全部通过\n", iterations, mutated * 2);
+    return 0;
+}
+
+#endif
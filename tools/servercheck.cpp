@@ -0,0 +1,416 @@
+// oicqd 回环自检：在临时数据库上启动 ChatServer（TCP 随机端口 + Unix 套接字），
+// 用多个 ChatClient 走一遍注册、登录、加好友、建群、收发、推送、历史、最近聊天和错误处理，
+// 然后多个客户端并发发送并核对落库条数和消息日志，最后让一批连接同时订阅群聊，检查经工作线程编码的推送
+// 以及绕过 oicqd 直接写库的消息，
+// 再在单个线程上用几百个协程会话（session.h）订阅同一群聊，检查每个会话都收到推送。
+// epoll 与 io_uring 两种后端各跑一遍
+// （内核不支持 io_uring 时跳过），任一检查失败时返回非零
+//
+// 用法: ./oicq_servercheck [--clients N] [--messages M] [--io epoll|io_uring]
+// 需在项目根目录运行（读取 database/init.sql）
+
+#include "client.h"
+#include "database.h"
+#include "server.h"
+#include "session.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static int failures = 0;
+
+// 同时订阅群聊的连接数，不少于服务端把推送编码分给工作线程的门槛
+static const int kFanoutWatchers = 40;
+// 在同一个事件循环线程上订阅群聊的协程会话数
+static const int kCoroutineWatchers = 200;
+// 绕过 oicqd 直接写库的提交次数，以及每次提交写入的群消息条数
+static const int kExternalCommits = 5;
+static const int kExternalRows = 4;
+
+static void check(bool ok, const std::string& name) {
+    std::printf("%-5s %s\n", ok ? "ok" : "FAIL", name.c_str());
+    if (!ok) ++failures;
+}
+
+static bool waitPush(ChatClient& client, const std::string& content, bool isGroup) {
+    Message msg;
+    while (client.readPush(msg, 2000)) {
+        if (msg.content == content && msg.isGroup == isGroup) return true;
+    }
+    return false;
+}
+
+#ifndef _WIN32
+// 读取 timeoutMs 内到达的全部字节
+static std::string recvFor(int fd, int timeoutMs) {
+    std::string data;
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    char buffer[4096];
+    while (poll(&pfd, 1, timeoutMs) > 0) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        data.append(buffer, n);
+    }
+    return data;
+}
+#endif
+
+static void removeDatabase(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+#ifndef _WIN32
+
+// 协程扇出检查的订阅者：登录并订阅 team，等到推送或超时后退出
+class WatchSession : public AsyncSession {
+private:
+    std::string name;
+    std::atomic<int>& watching;
+
+protected:
+    void resume() {
+        CO_BEGIN(co);
+        request(protocol::OP_LOGIN, name, "pw");
+        CO_AWAIT(co, replyReady());
+        if (!replyOk()) CO_RETURN(co);
+        request(protocol::OP_WATCH, "team", std::string(), true);
+        CO_AWAIT(co, replyReady());
+        if (!replyOk()) CO_RETURN(co);
+        ++watching;
+
+        sleepUntil(nowMicros() + 5e6);
+        CO_AWAIT(co, pushReady() || timerDue());
+        for (const auto& msg : pushes) {
+            if (msg.isGroup && msg.content == "coroutine fanout") received = true;
+        }
+        request(protocol::OP_QUIT);
+        CO_AWAIT(co, replyReady());
+        CO_END(co);
+    }
+
+public:
+    bool received;
+
+    WatchSession(const std::string& user, std::atomic<int>& counter)
+        : name(user), watching(counter), received(false) {}
+};
+
+// 在指定 I/O 后端上跑一遍全部检查；后端不可用时跳过
+static bool runSuite(const std::string& backend, int clients, int messages) {
+    std::string path = "servercheck.db";
+    std::string socketPath = "/tmp/oicq_servercheck_" + std::to_string(getpid()) + ".sock";
+    std::string logPath = "servercheck_messages.log";
+    removeDatabase(path);
+    std::remove(logPath.c_str());
+
+    DatabaseOptions dbOpts = DatabaseOptions::fromEnvironment();
+    dbOpts.path = path;
+    dbOpts.shmRing = false;
+    dbOpts.prefetchCount = 0;
+    dbOpts.slowLogPath = "";
+    Database* db = Database::getInstance();
+    if (!db->initialize(dbOpts)) return false;
+
+    ServerOptions opts;
+    opts.host = "127.0.0.1";
+    opts.port = 0;
+    opts.unixPath = socketPath;
+    opts.ioBackend = backend;
+    opts.messageLogPath = logPath;
+    opts.workers = 2;
+    ChatServer server;
+    if (!server.start(opts)) {
+        std::cerr << "无法启动服务" << std::endl;
+        db->close();
+        return false;
+    }
+    if (backend != server.ioBackend()) {
+        std::printf("跳过 %s：当前内核不可用\n", backend.c_str());
+        server.stop();
+        db->close();
+        removeDatabase(path);
+        std::remove(logPath.c_str());
+        return true;
+    }
+    std::printf("== %s ==\n", server.ioBackend());
+    std::thread loop([&server]() { server.run(); });
+    int port = server.tcpPort();
+
+    ChatClient alice, bob;
+    check(alice.connectTcp("127.0.0.1", port) && alice.ping(), "TCP 连接 + PING");
+    check(bob.connectUnix(socketPath) && bob.ping(), "Unix 套接字连接 + PING");
+
+    check(!alice.send("bob", false, "hi"), "未登录时 SEND 被拒绝");
+    check(alice.registerUser("alice", "pw") && bob.registerUser("bob", "pw"), "REGISTER");
+    check(!alice.registerUser("alice", "pw"), "重复 REGISTER 被拒绝");
+    check(!alice.login("alice", "wrong"), "错误密码 LOGIN 被拒绝");
+    check(alice.login("alice", "pw") && bob.login("bob", "pw"), "LOGIN");
+    check(!alice.send("bob", false, "hi"), "非好友 SEND 被拒绝");
+    check(alice.addFriend("bob"), "FRIEND");
+
+    // 私聊：bob 订阅后 alice 发送，bob 收到推送
+    check(bob.watch("alice", false), "WATCH 私聊");
+    std::string tricky = "制表\t换行\n反斜杠\\ 结束";
+    check(alice.send("bob", false, "hello bob"), "SEND 私聊");
+    check(waitPush(bob, "hello bob", false), "私聊 PUSH 到达");
+    check(alice.send("bob", false, tricky) && waitPush(bob, tricky, false), "特殊字符往返");
+
+    std::vector<Message> history;
+    check(bob.history("alice", false, 0, history) && history.size() == 2 && history[1].content == tricky,
+          "HISTORY 最新一屏");
+    check(bob.history("alice", false, history[0].id, history) && history.size() == 1, "HISTORY 增量");
+
+    // 另一个连接（如另一个 oicq 进程的 deleteUserData）删除消息后，缓存的窗口不能再返回它
+    sqlite3* other = nullptr;
+    bool deleted = sqlite3_open(path.c_str(), &other) == SQLITE_OK &&
+                   sqlite3_exec(other, "DELETE FROM messages WHERE content = 'hello bob'", 0, 0, 0) == SQLITE_OK &&
+                   sqlite3_changes(other) == 1;
+    sqlite3_close(other);
+    check(deleted && bob.history("alice", false, 0, history) && history.size() == 1 && history[0].content == tricky,
+          "其它连接删除的消息不再从缓存返回");
+
+    // 群聊
+    check(alice.createGroup("team") && bob.joinGroup("team"), "CREATEGROUP + JOINGROUP");
+    check(bob.watch("team", true), "WATCH 群聊");
+    check(alice.send("team", true, "hello team") && waitPush(bob, "hello team", true), "群聊 PUSH 到达");
+    check(!alice.watch("nogroup", true), "非成员 WATCH 被拒绝");
+
+    std::vector<Database::RecentChat> chats;
+    bool hasMore = true;
+    check(bob.recent(20, 0, chats, &hasMore) && chats.size() == 2 && !hasMore, "RECENT");
+    check(bob.recent(1, 0, chats, &hasMore) && chats.size() == 1 && hasMore, "RECENT 分页");
+
+    // 写完 SEND 立即关闭：请求帧和 FIN 一起到达，服务端仍要处理完已收到的帧再关闭
+    {
+        ChatClient closer;
+        bool sent = closer.connectTcp("127.0.0.1", port) && closer.login("alice", "pw");
+        protocol::Request request;
+        std::string target = "team", content = "sent before close";
+        request.op = protocol::OP_SEND;
+        request.text1 = protocol::textOf(target);
+        request.text2 = protocol::textOf(content);
+        request.isGroup = true;
+        request.number1 = request.number2 = 0;
+        std::string frame;
+        protocol::encodeRequest(frame, request);
+        sent = sent && send(closer.socketFd(), frame.data(), frame.size(), MSG_NOSIGNAL) == (ssize_t)frame.size();
+        closer.disconnect();
+        check(sent && waitPush(bob, content, true), "关闭前发出的 SEND 仍被处理");
+    }
+
+    // 协议错误：未知操作码返回 ERR，连接仍可用；长度前缀超过上限时断开连接。
+    // 直接读写套接字，绕开 ChatClient 的请求/应答配对
+    ChatClient raw;
+    check(raw.connectTcp("127.0.0.1", port), "第三个连接");
+    {
+        const char junk[] = { 0x01, 0x7F, 0x01, protocol::OP_PING };
+        ssize_t sent = send(raw.socketFd(), junk, sizeof(junk), MSG_NOSIGNAL);
+        std::string reply = recvFor(raw.socketFd(), 500);
+        const char* body;
+        size_t size, frameSize;
+        bool isErr = protocol::peekFrame(reply.data(), reply.size(), protocol::kMaxResponseBytes,
+                                         body, size, frameSize) == protocol::FRAME_OK &&
+                     (uint8_t)body[0] == protocol::OP_ERR;
+        check(isErr, "未知操作码返回 ERR");
+        check(isErr && reply.size() == frameSize + 2 && (uint8_t)reply[frameSize + 1] == protocol::OP_PONG,
+              "未知操作码后连接仍可用");
+        const unsigned char huge[] = { 0x80, 0x80, 0x40, protocol::OP_PING };
+        sent = send(raw.socketFd(), huge, sizeof(huge), MSG_NOSIGNAL);
+        (void)sent;
+        char byte;
+        check(recv(raw.socketFd(), &byte, 1, 0) == 0, "超长帧断开连接");
+    }
+
+    // 并发：每个客户端各自登录并向 team 群发送 messages 条
+    std::vector<std::string> names;
+    for (int i = 0; i < clients; ++i) {
+        names.push_back("load" + std::to_string(i));
+        ChatClient setup;
+        setup.connectTcp("127.0.0.1", port);
+        setup.registerUser(names.back(), "pw");
+        setup.login(names.back(), "pw");
+        setup.joinGroup("team");
+        setup.quit();
+    }
+    std::atomic<int> sentOk(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < clients; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            ChatClient c;
+            if (!c.connectTcp("127.0.0.1", port) || !c.login(names[i], "pw")) return;
+            for (int m = 0; m < messages; ++m) {
+                if (c.send("team", true, "load " + std::to_string(m))) ++sentOk;
+            }
+            c.quit();
+        }));
+    }
+    int pushed = 0;
+    Message msg;
+    while (pushed < clients * messages && bob.readPush(msg, 2000)) {
+        if (msg.isGroup && msg.content.compare(0, 5, "load ") == 0) ++pushed;
+    }
+    for (auto& w : workers) w.join();
+    check(sentOk == clients * messages, std::to_string(clients) + " 个客户端并发 SEND");
+    check(pushed == clients * messages, "并发消息全部推送给订阅者");
+
+    // 扇出：一条群消息同时唤醒全部订阅者，PUSH 帧由工作线程编码，每个连接都应收到且只收到自己的帧
+    std::vector<std::unique_ptr<ChatClient> > watchers;
+    int watching = 0;
+    for (int i = 0; i < kFanoutWatchers; ++i) {
+        watchers.push_back(std::unique_ptr<ChatClient>(new ChatClient()));
+        ChatClient& w = *watchers.back();
+        if (w.connectTcp("127.0.0.1", port) && w.login(names[i % clients], "pw") && w.watch("team", true)) ++watching;
+    }
+    check(watching == kFanoutWatchers, std::to_string(kFanoutWatchers) + " 个连接订阅群聊");
+    check(alice.send("team", true, "fanout"), "扇出 SEND");
+    int received = 0;
+    for (auto& w : watchers) {
+        if (waitPush(*w, "fanout", true)) ++received;
+    }
+    check(received == kFanoutWatchers, "扇出推送全部到达");
+    check(server.workerStats().tasks >= (unsigned long long)kFanoutWatchers, "推送帧由工作线程编码");
+
+    // 外部写入：另一个连接每次提交多条群消息，同时 alice 经服务端发送。一次唤醒积累多条通知，
+    // 其中还有本进程消息的重复通知；每个订阅者应按 id 顺序各收到一次，之后连接仍可用
+    std::atomic<int> externalRows(0);
+    std::thread external([&path, &externalRows]() {
+        sqlite3* writer = nullptr;
+        if (sqlite3_open(path.c_str(), &writer) == SQLITE_OK) {
+            sqlite3_busy_timeout(writer, 2000);
+            for (int b = 0; b < kExternalCommits; ++b) {
+                std::string sql = "BEGIN;";
+                for (int r = 0; r < kExternalRows; ++r) {
+                    sql += "INSERT INTO messages (sender, receiver, content, is_group) VALUES "
+                           "('bob', 'team', 'external " + std::to_string(b * kExternalRows + r) + "', 1);";
+                }
+                sql += "COMMIT;";
+                if (sqlite3_exec(writer, sql.c_str(), 0, 0, 0) == SQLITE_OK) externalRows += kExternalRows;
+                else sqlite3_exec(writer, "ROLLBACK", 0, 0, 0);
+            }
+        }
+        sqlite3_close(writer);
+    });
+    int ownSent = 0;
+    for (int i = 0; i < kExternalCommits; ++i) {
+        if (alice.send("team", true, "own " + std::to_string(i))) ++ownSent;
+    }
+    external.join();
+    int expected = externalRows + ownSent;
+    check(externalRows == kExternalCommits * kExternalRows && ownSent == kExternalCommits, "外部写入与 SEND 交错提交");
+    int exact = 0;
+    for (auto& w : watchers) {
+        int got = 0, lastId = 0;
+        bool ordered = true;
+        while (got < expected && w->readPush(msg, 2000)) {
+            if (!msg.isGroup) continue;
+            if (msg.content.compare(0, 9, "external ") != 0 && msg.content.compare(0, 4, "own ") != 0) continue;
+            if (msg.id <= lastId) ordered = false;
+            lastId = msg.id;
+            ++got;
+        }
+        if (ordered && got == expected && !w->readPush(msg, 100) && w->ping()) ++exact;
+    }
+    check(exact == kFanoutWatchers, "外部写入的消息逐条推送一次，连接仍可用");
+    for (auto& w : watchers) w->quit();
+
+    // 协程会话：全部连接由一个线程上的事件循环驱动，挂起等待推送时不占线程
+    std::atomic<int> coWatching(0);
+    std::vector<std::unique_ptr<WatchSession> > coSessions;
+    SessionLoop coLoop;
+    bool coStarted = coLoop.start();
+    for (int i = 0; coStarted && i < kCoroutineWatchers; ++i) {
+        coSessions.push_back(std::unique_ptr<WatchSession>(new WatchSession(names[i % clients], coWatching)));
+        coLoop.add(coSessions.back().get(), "127.0.0.1:" + std::to_string(port));
+    }
+    std::thread coThread([&coLoop]() { coLoop.run(); });
+    for (int wait = 0; wait < 500 && coWatching < kCoroutineWatchers; ++wait) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    check(coWatching == kCoroutineWatchers, std::to_string(kCoroutineWatchers) + " 个协程会话在单线程上订阅群聊");
+    check(alice.send("team", true, "coroutine fanout"), "协程扇出 SEND");
+    coThread.join();
+    int coReceived = 0;
+    for (auto& session : coSessions) {
+        if (session->received && session->isDone()) ++coReceived;
+    }
+    check(coReceived == kCoroutineWatchers, "协程会话全部收到推送");
+
+    alice.quit();
+    bob.quit();
+    server.stop();
+    loop.join();
+    check(server.sessionCount() == 0, "停止后连接全部关闭");
+
+    long long stored = 0;
+    db->visitMessagesSince("bob", "team", true, 0, [&](const MessageView&) {
+        ++stored;
+        return true;
+    });
+    check(stored == 4 + clients * messages + kExternalCommits * (kExternalRows + 1), "并发消息全部落库");
+
+    // 每条成功发送的消息一行，特殊字符转义后仍为一行
+    FILE* log = std::fopen(logPath.c_str(), "r");
+    long long lines = 0;
+    int c;
+    while (log && (c = std::fgetc(log)) != EOF) {
+        if (c == '\n') ++lines;
+    }
+    if (log) std::fclose(log);
+    check(lines == 6 + kExternalCommits + clients * messages, "消息日志逐条写出");
+
+    db->close();
+    removeDatabase(path);
+    std::remove(logPath.c_str());
+    return true;
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+    int clients = 16;
+    int messages = 50;
+    std::vector<std::string> backends;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--clients") && i + 1 < argc) clients = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && i + 1 < argc) messages = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--io") && i + 1 < argc) backends.push_back(argv[++i]);
+        else {
+            std::cerr << "用法: " << argv[0] << " [--clients N] [--messages M] [--io epoll|io_uring]" << std::endl;
+            return 1;
+        }
+    }
+    if (clients < 1) clients = 1;
+    if (messages < 1) messages = 1;
+    if (backends.empty()) {
+        backends.push_back("epoll");
+        backends.push_back("io_uring");
+    }
+
+#ifdef _WIN32
+    std::cerr << "当前平台不支持 oicqd" << std::endl;
+    return 1;
+#else
+    for (const auto& backend : backends) {
+        if (!runSuite(backend, clients, messages)) return 1;
+    }
+    std::printf("%s\n", failures == 0 ? "全部通过" : "存在失败项");
+    return failures == 0 ? 0 : 1;
+#endif
+}